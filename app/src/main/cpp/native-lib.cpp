@@ -2,7 +2,9 @@
  * native-lib.cpp - The Cortex (Privileged Sanctum)
  * 
  * JNI bridge hosting llama.cpp for Jamba-Reasoning-3B inference.
- * Uses Jinja chat templates for prompt formatting.
+ * Uses Jinja chat templates for prompt formatting. Only marshals Java
+ * values: the work lives in sentinel_core behind native_api.hpp, which
+ * also builds and runs on desktop Linux.
  * 
  * Security Architecture:
  *   1. Input Sanitization (regex-based control token stripping)
@@ -16,26 +18,76 @@
 #include <jni.h>
 
 // Standard library headers (C++23)
+#include <algorithm>
+#include <array>
 #include <expected>
-#include <format>
-#include <fstream>
-#include <shared_mutex>
-#include <sstream>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <vector>
 
-// llama.cpp headers
-#include "llama.h"
-
-// Sentinel module shim (header-based until NDK supports modules)
-#include "sentinel.hpp"
-
-#include "native_inference.hpp"
+#include "native_adapter.hpp"
+#include "native_api.hpp"
+#include "native_embedding.hpp"
+#include "native_flight.hpp"
+#include "native_jni.hpp"
 #include "native_logging.hpp"
-#include "native_state.hpp"
-#include "native_utils.hpp"
+#include "native_macro.hpp"
+#include "native_metrics.hpp"
+#include "native_profiler.hpp"
+#include "native_residency.hpp"
+#include "native_resolver.hpp"
+#include "native_router.hpp"
+#include "native_semantic.hpp"
+#include "native_trace.hpp"
+#include "native_workload.hpp"
+#include "native_engine.hpp"
 
 using namespace sentinel_native;
 
+namespace {
+
+bool init_engine(JNIEnv* env, Engine& engine, jstring jModelPath, jstring jGrammarPath) {
+    auto model_path = jstring_to_string(env, jModelPath);
+    auto grammar_path = jstring_to_string(env, jGrammarPath);
+    return sentinel_native::init_engine(engine, model_path, grammar_path);
+}
+
+/**
+ * Run one string-screen request on `engine`. A null `grammar_path` uses the
+ * engine's own grammar; an empty one disables grammar. A null `stage` uses
+ * the engine's default adapter stage.
+ */
+jstring infer_on(
+    JNIEnv* env,
+    Engine& engine,
+    jstring jUserQuery,
+    jstring jScreenContext,
+    jstring jGrammarPath,
+    PromptMode mode,
+    jstring jStage = nullptr
+) {
+    std::unique_lock lock(engine.mutex);
+    ArenaScope arena(engine.arena);
+
+    auto user_query = jstring_to_string(env, jUserQuery, arena.resource());
+    auto screen_context = jstring_to_string(env, jScreenContext, arena.resource());
+    auto stage = jStage ? jstring_to_string(env, jStage, arena.resource()) : std::pmr::string(arena.resource());
+    auto grammar_path = jGrammarPath ? jstring_to_string(env, jGrammarPath, arena.resource())
+                                     : std::pmr::string(arena.resource());
+
+    return string_to_jstring(env, infer_locked(engine, {
+        .user_query = user_query,
+        .screen_context = screen_context,
+        .mode = mode,
+        .grammar_path = jGrammarPath ? std::optional<std::string_view>(grammar_path) : std::nullopt,
+        .stage = stage,
+    }, arena.resource()), arena.resource());
+}
+
+} // namespace
+
 // ============================================================================
 // JNI Exports
 // ============================================================================
@@ -51,104 +103,8 @@ Java_com_mazzlabs_sentinel_core_NativeBridge_initModel(
     jstring jModelPath,
     jstring jGrammarPath
 ) {
-    std::unique_lock lock(g_model_mutex);
-    
-    g_state.reset();
-    
-    auto model_path = jstring_to_string(env, jModelPath);
-    auto grammar_path = jstring_to_string(env, jGrammarPath);
-    
-    LOGI("Initializing model: %s", model_path.c_str());
-    
-    // Initialize llama backend
-    llama_backend_init();
-    
-    // Load model using new API
-    llama_model_params model_params = llama_model_default_params();
-    model_params.n_gpu_layers = 99;  // Offload as many layers as possible to GPU
-    
-    g_state.model = llama_model_load_from_file(model_path.c_str(), model_params);
-    if (!g_state.model) {
-        LOGE("Failed to load model from: %s", model_path.c_str());
-        return JNI_FALSE;
-    }
-    
-    // Get vocab from model
-    g_state.vocab = llama_model_get_vocab(g_state.model);
-    if (!g_state.vocab) {
-        LOGE("Failed to get vocab from model");
-        g_state.reset();
-        return JNI_FALSE;
-    }
-    
-    LOGI("Model loaded successfully");
-
-    // Load grammar file if provided
-    if (!grammar_path.empty()) {
-        std::ifstream grammar_file(grammar_path);
-        if (grammar_file.is_open()) {
-            std::stringstream buffer;
-            buffer << grammar_file.rdbuf();
-            g_state.grammar_text = buffer.str();
-            LOGI("Grammar loaded: %zu bytes", g_state.grammar_text.size());
-        } else {
-            LOGW("Grammar file not found: %s", grammar_path.c_str());
-        }
-    }
-    
-    // Try to get the model's chat template
-    const char* tmpl = llama_model_chat_template(g_state.model, nullptr);
-    if (tmpl) {
-        g_state.chat_template = tmpl;
-        LOGI("Using model's chat template");
-    } else {
-        LOGI("Model has no chat template, will use fallback");
-    }
-    
-    // Create context using new API
-    llama_context_params ctx_params = llama_context_default_params();
-    ctx_params.n_ctx = g_state.n_ctx;
-    ctx_params.n_batch = 512;
-    ctx_params.n_ubatch = 512;
-    
-    g_state.ctx = llama_init_from_model(g_state.model, ctx_params);
-    if (!g_state.ctx) {
-        LOGE("Failed to create context");
-        g_state.reset();
-        return JNI_FALSE;
-    }
-    
-    LOGI("Context created successfully");
-    
-    // Create sampler chain (no grammar - just temp + top-p + dist)
-    llama_sampler_chain_params sparams = llama_sampler_chain_default_params();
-    g_state.sampler = llama_sampler_chain_init(sparams);
-    
-    // Add temperature and top-p sampling
-    llama_sampler_chain_add(g_state.sampler, 
-        llama_sampler_init_temp(g_state.temperature));
-    llama_sampler_chain_add(g_state.sampler, 
-        llama_sampler_init_top_p(g_state.top_p, 1));
-
-    // Add grammar constraint if available
-    if (!g_state.grammar_text.empty()) {
-        auto grammar_sampler = llama_sampler_init_grammar(
-            g_state.vocab,
-            g_state.grammar_text.c_str(),
-            "root"
-        );
-        if (grammar_sampler) {
-            llama_sampler_chain_add(g_state.sampler, grammar_sampler);
-            LOGI("Grammar sampler added to chain");
-        } else {
-            LOGW("Failed to create grammar sampler");
-        }
-    }
-    llama_sampler_chain_add(g_state.sampler, 
-        llama_sampler_init_dist(42));  // Random seed
-    
-    LOGI("Model initialization complete (chat template mode)");
-    return JNI_TRUE;
+    TraceSpan span("jni.init_model");
+    return init_engine(env, default_engine(), jModelPath, jGrammarPath) ? JNI_TRUE : JNI_FALSE;
 }
 
 /**
@@ -161,118 +117,250 @@ Java_com_mazzlabs_sentinel_core_NativeBridge_infer(
     jstring jUserQuery,
     jstring jScreenContext
 ) {
-    std::unique_lock lock(g_model_mutex);
-    
-    if (!g_state.is_ready()) {
-        LOGE("Model not ready for inference");
-        return string_to_jstring(env, R"({"action":"NONE","reasoning":"Model not loaded"})");
-    }
-    
-    auto user_query = jstring_to_string(env, jUserQuery);
-    auto screen_context = jstring_to_string(env, jScreenContext);
-    
-    LOGD("User query: %s", user_query.c_str());
-    LOGD("Screen context length: %zu", screen_context.size());
-    
-    // Check for injection attempts
-    if (sentinel::contains_injection(user_query)) {
-        return string_to_jstring(env, R"({"action":"none","reasoning":"blocked"})");
+    TraceSpan span("jni.infer");
+    return infer_on(env, default_engine(), jUserQuery, jScreenContext, nullptr, PromptMode::Agent);
+}
+
+/**
+ * Run grammar-constrained inference and write the raw UTF-8 result into a
+ * caller-provided direct ByteBuffer, skipping jstring creation entirely.
+ * Returns bytes written, or -(bytes required) if the buffer is too small;
+ * the result is then kept for copyLastResult instead of being discarded.
+ */
+JNIEXPORT jint JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_inferToBuffer(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jUserQuery,
+    jstring jScreenContext,
+    jobject jOutBuffer
+) {
+    TraceSpan span("jni.infer_to_buffer");
+    Engine& engine = default_engine();
+    std::unique_lock lock(engine.mutex);
+    ArenaScope arena(engine.arena);
+
+    auto user_query = jstring_to_string(env, jUserQuery, arena.resource());
+    auto screen_context = jstring_to_string(env, jScreenContext, arena.resource());
+
+    engine.pending_result.clear();
+    auto result = infer_locked(engine, {
+        .user_query = user_query,
+        .screen_context = screen_context,
+    }, arena.resource());
+
+    const jint written = write_utf8_to_buffer(env, jOutBuffer, result);
+    if (written < 0 && written != OUTPUT_INVALID_BUFFER) {
+        engine.pending_result.assign(result);
     }
-    
-    // Sanitize inputs
-    auto safe_query = sentinel::sanitize(user_query, 2048);
-    auto safe_context = sentinel::sanitize(screen_context, 32000);
-    
-    // Build system prompt with context
-    std::string system_prompt = R"(You are an Android accessibility agent. Analyze the screen and respond with a JSON action.
-
-Available actions:
-- CLICK: {"action":"CLICK","target":"element_id","reasoning":"why"}
-- TYPE: {"action":"TYPE","target":"element_id","text":"what to type","reasoning":"why"}
-- SCROLL: {"action":"SCROLL","direction":"up|down|left|right","reasoning":"why"}
-- BACK: {"action":"BACK","reasoning":"why"}
-- NONE: {"action":"NONE","reasoning":"why nothing needed"}
-
-Current screen context:
-)" + safe_context + R"(
-
-Respond ONLY with valid JSON. No markdown, no explanation outside JSON.)";
-
-    // Apply chat template
-    auto prompt = apply_chat_template(system_prompt, safe_query);
-    
-    LOGD("Final prompt length: %zu", prompt.size());
-    
-    // Run inference
-    auto result = run_inference(prompt, g_state.grammar_text);
-    
-    if (result) {
-        LOGI("Inference result: %s", result.value().c_str());
-        return string_to_jstring(env, *result);
-    } else {
-        LOGE("Inference failed: %s", result.error().c_str());
-        return string_to_jstring(env, 
-            std::format(R"({{"action":"NONE","reasoning":"{}"}})", result.error()));
+    return written;
+}
+
+/**
+ * Copy the result inferToBuffer could not fit into a larger direct buffer,
+ * without running inference again. The result is released once copied.
+ * Returns bytes written, -(bytes required) if the buffer is still too
+ * small, or 0 if no result is pending.
+ */
+JNIEXPORT jint JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_copyLastResult(
+    JNIEnv* env,
+    jobject /* this */,
+    jobject jOutBuffer
+) {
+    TraceSpan span("jni.copy_last_result");
+    Engine& engine = default_engine();
+    std::unique_lock lock(engine.mutex);
+
+    const jint written = write_utf8_to_buffer(env, jOutBuffer, engine.pending_result);
+    if (written >= 0) {
+        engine.pending_result = std::string();
     }
+    return written;
 }
 
 /**
- * Run inference with a per-call grammar path
+ * Run grammar-constrained inference on a packed accessibility snapshot
+ * (see native_snapshot.hpp). The screen is rendered and tokenized natively
+ * straight out of the direct buffer.
  */
 JNIEXPORT jstring JNICALL
-Java_com_mazzlabs_sentinel_core_NativeBridge_inferWithGrammar(
+Java_com_mazzlabs_sentinel_core_NativeBridge_inferWithSnapshot(
     JNIEnv* env,
     jobject /* this */,
     jstring jUserQuery,
-    jstring jScreenContext,
-    jstring jGrammarPath
+    jobject jSnapshot,
+    jint jLength
 ) {
-    std::unique_lock lock(g_model_mutex);
+    TraceSpan span("jni.infer_with_snapshot");
+    Engine& engine = default_engine();
+    std::unique_lock lock(engine.mutex);
+    ArenaScope arena(engine.arena);
 
-    if (!g_state.is_ready()) {
-        LOGE("Model not ready for inference");
-        return string_to_jstring(env, R"({"action":"NONE","reasoning":"Model not loaded"})");
+    auto user_query = jstring_to_string(env, jUserQuery, arena.resource());
+
+    const auto snapshot = direct_buffer_bytes(env, jSnapshot, jLength);
+    if (!snapshot) {
+        LOGE("Snapshot is not a direct buffer or length is out of range");
+        return string_to_jstring(env, R"({"action":"NONE","reasoning":"Invalid snapshot buffer"})");
     }
 
-    auto user_query = jstring_to_string(env, jUserQuery);
-    auto screen_context = jstring_to_string(env, jScreenContext);
-    auto grammar_path = jstring_to_string(env, jGrammarPath);
+    return string_to_jstring(env, infer_snapshot_locked(
+        engine, user_query, *snapshot, arena.resource()
+    ), arena.resource());
+}
 
-    LOGD("User query: %s", user_query.c_str());
-    LOGD("Screen context length: %zu", screen_context.size());
+/**
+ * Start incremental screen ingestion (see native_screen.hpp). Only queues
+ * the reset for the worker, so it never waits for a running request.
+ * Batches are pruned against jQuery as they arrive.
+ */
+JNIEXPORT void JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_beginScreen(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jQuery
+) {
+    TraceSpan span("jni.begin_screen");
+    std::array<std::byte, 4096> buffer;
+    std::pmr::monotonic_buffer_resource scratch(buffer.data(), buffer.size());
+    auto query = jstring_to_string(env, jQuery, &scratch);
+    begin_screen(default_engine(), query);
+}
 
-    if (sentinel::contains_injection(user_query)) {
-        return string_to_jstring(env, R"({"action":"none","reasoning":"blocked"})");
+/**
+ * Queue a packed snapshot batch for background tokenization and prefill.
+ * The bytes are copied, so the caller may reuse the buffer immediately.
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_appendElements(
+    JNIEnv* env,
+    jobject /* this */,
+    jobject jBatch,
+    jint jLength
+) {
+    TraceSpan span("jni.append_elements");
+    const auto batch = direct_buffer_bytes(env, jBatch, jLength);
+    if (!batch) {
+        LOGE("Element batch is not a direct buffer or length is out of range");
+        return JNI_FALSE;
     }
 
-    auto safe_query = sentinel::sanitize(user_query, 2048);
-    auto safe_context = sentinel::sanitize(screen_context, 32000);
+    return append_screen(default_engine(), *batch) ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * Wait for the streamed screen to be prefilled
+ * @return prompt tokens prefilled so far, or -1 on failure
+ */
+JNIEXPORT jint JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_endScreen(
+    JNIEnv* /* env */,
+    jobject /* this */
+) {
+    TraceSpan span("jni.end_screen");
+    return end_screen(default_engine());
+}
+
+/**
+ * Run grammar-constrained inference against the screen ingested by the
+ * last beginScreen/appendElements/endScreen sequence
+ */
+JNIEXPORT jstring JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_inferStreamed(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jUserQuery
+) {
+    TraceSpan span("jni.infer_streamed");
+    Engine& engine = default_engine();
+    std::unique_lock lock(engine.mutex);
+    ArenaScope arena(engine.arena);
+
+    auto user_query = jstring_to_string(env, jUserQuery, arena.resource());
 
-    std::string system_prompt = safe_context;
+    return string_to_jstring(env, infer_streamed_locked(engine, user_query, arena.resource()), arena.resource());
+}
 
-    auto prompt = apply_chat_template(system_prompt, safe_query);
+/**
+ * Replace the element set used by resolveTarget with a packed snapshot
+ * @return number of elements loaded, or -1 if the snapshot is invalid
+ */
+JNIEXPORT jint JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_loadTargetElements(
+    JNIEnv* env,
+    jobject /* this */,
+    jobject jSnapshot,
+    jint jLength
+) {
+    TraceSpan span("jni.load_target_elements");
+    const auto snapshot = direct_buffer_bytes(env, jSnapshot, jLength);
+    if (!snapshot) {
+        LOGE("Snapshot is not a direct buffer or length is out of range");
+        return -1;
+    }
+
+    return load_target_elements(*snapshot);
+}
 
-    std::string grammar_text;
-    if (!grammar_path.empty()) {
-        std::ifstream grammar_file(grammar_path);
-        if (grammar_file.is_open()) {
-            std::stringstream buffer;
-            buffer << grammar_file.rdbuf();
-            grammar_text = buffer.str();
-        } else {
-            LOGW("Grammar file not found: %s", grammar_path.c_str());
-        }
+/**
+ * Resolve a model-produced target string against the loaded elements
+ * @param jOutIds Receives matching element ids, best first
+ * @param jOutScores Receives the score of each match (0.5..1.0)
+ * @return number of matches written
+ */
+JNIEXPORT jint JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_resolveTarget(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jTarget,
+    jintArray jOutIds,
+    jfloatArray jOutScores
+) {
+    TraceSpan span("jni.resolve_target");
+    if (!jOutIds || !jOutScores) {
+        return 0;
     }
 
-    auto result = run_inference(prompt, grammar_text);
+    std::array<std::byte, 1024> buffer;
+    std::pmr::monotonic_buffer_resource scratch(buffer.data(), buffer.size());
+    auto target = jstring_to_string(env, jTarget, &scratch);
+
+    constexpr std::size_t MAX_MATCHES = 16;
+    std::array<TargetMatch, MAX_MATCHES> matches;
+    const auto capacity = static_cast<std::size_t>(
+        std::min(env->GetArrayLength(jOutIds), env->GetArrayLength(jOutScores)));
 
-    if (result) {
-        return string_to_jstring(env, *result);
-    } else {
-        LOGE("Inference failed: %s", result.error().c_str());
-        return string_to_jstring(env,
-            std::format(R"({{"action":"NONE","reasoning":"{}"}})", result.error()));
+    std::size_t n = 0;
+    {
+        std::lock_guard lock(g_resolver_mutex);
+        n = g_target_resolver.resolve(target, std::span(matches).first(std::min(capacity, MAX_MATCHES)));
     }
+
+    std::array<jint, MAX_MATCHES> ids;
+    std::array<jfloat, MAX_MATCHES> scores;
+    for (std::size_t i = 0; i < n; ++i) {
+        ids[i] = matches[i].id;
+        scores[i] = matches[i].score;
+    }
+    env->SetIntArrayRegion(jOutIds, 0, static_cast<jsize>(n), ids.data());
+    env->SetFloatArrayRegion(jOutScores, 0, static_cast<jsize>(n), scores.data());
+    return static_cast<jint>(n);
+}
+
+/**
+ * Run inference with a per-call grammar path
+ */
+JNIEXPORT jstring JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_inferWithGrammar(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jUserQuery,
+    jstring jScreenContext,
+    jstring jGrammarPath
+) {
+    TraceSpan span("jni.infer_with_grammar");
+    return infer_on(env, default_engine(), jUserQuery, jScreenContext, jGrammarPath, PromptMode::Passthrough);
 }
 
 /**
@@ -286,128 +374,634 @@ Java_com_mazzlabs_sentinel_core_NativeBridge_inferWithoutGrammar(
     jstring jUserQuery,
     jstring jScreenContext
 ) {
-    std::unique_lock lock(g_model_mutex);
+    TraceSpan span("jni.infer_without_grammar");
+    // nullptr grammar = no grammar constraint
+    Engine& engine = default_engine();
+    std::unique_lock lock(engine.mutex);
+    ArenaScope arena(engine.arena);
+
+    auto user_query = jstring_to_string(env, jUserQuery, arena.resource());
+    auto screen_context = jstring_to_string(env, jScreenContext, arena.resource());
+
+    return string_to_jstring(env, infer_locked(engine, {
+        .user_query = user_query,
+        .screen_context = screen_context,
+        .grammar_path = std::string_view(),
+    }, arena.resource()), arena.resource());
+}
 
-    if (!g_state.is_ready()) {
-        LOGE("Model not ready for inference");
-        return string_to_jstring(env, R"({"action":"NONE","reasoning":"Model not loaded"})");
-    }
+/**
+ * Release the model. It stays resident while the residency budget allows,
+ * so a later initModel with the same path is instant; otherwise it is
+ * unloaded now.
+ */
+JNIEXPORT void JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_releaseModel(
+    JNIEnv* /* env */,
+    jobject /* this */
+) {
+    TraceSpan span("jni.release_model");
+    Engine& engine = default_engine();
+    std::unique_lock lock(engine.mutex);
+
+    // The backend stays initialized: handle engines may still be running
+    LOGI("Releasing model resources");
+    residency().release(engine);
+}
+
+/**
+ * Check if model is ready
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_isModelReady(
+    JNIEnv* /* env */,
+    jobject /* this */
+) {
+    TraceSpan span("jni.is_model_ready");
+    Engine& engine = default_engine();
+    std::shared_lock lock(engine.mutex);
+    return engine.is_available() ? JNI_TRUE : JNI_FALSE;
+}
 
-    auto user_query = jstring_to_string(env, jUserQuery);
-    auto screen_context = jstring_to_string(env, jScreenContext);
+/**
+ * Get model metadata
+ */
+JNIEXPORT jstring JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_getModelInfo(
+    JNIEnv* env,
+    jobject /* this */
+) {
+    TraceSpan span("jni.get_model_info");
+    return string_to_jstring(env, model_info_json(default_engine()));
+}
 
-    LOGD("User query (no grammar): %s", user_query.c_str());
-    LOGD("Screen context length: %zu", screen_context.size());
+/**
+ * Set inference parameters
+ */
+JNIEXPORT void JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_setInferenceParams(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jfloat temperature,
+    jfloat topP,
+    jint maxTokens
+) {
+    TraceSpan span("jni.set_inference_params");
+    set_params(default_engine(), temperature, topP, maxTokens);
+}
 
-    if (sentinel::contains_injection(user_query)) {
-        return string_to_jstring(env, R"({"action":"none","reasoning":"blocked"})");
+/**
+ * Select how screen elements are encoded into prompts
+ * @param level 0 = verbose, 1 = compact, 2 = dense (see ScreenEncoding)
+ * @param grid Position raster per axis for compact/dense, 0 to omit positions
+ */
+JNIEXPORT void JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_setScreenEncoding(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jint level,
+    jint grid,
+    jint screenWidth,
+    jint screenHeight
+) {
+    TraceSpan span("jni.set_screen_encoding");
+    set_screen_encoding(default_engine(), level, grid, screenWidth, screenHeight);
+}
+
+/**
+ * Start a macro task: the following snapshot/streamed requests for `query`
+ * are its steps (see native_macro.hpp)
+ */
+JNIEXPORT void JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_beginMacroTask(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jQuery
+) {
+    TraceSpan span("jni.begin_macro_task");
+    std::array<std::byte, 4096> buffer;
+    std::pmr::monotonic_buffer_resource scratch(buffer.data(), buffer.size());
+    auto query = jstring_to_string(env, jQuery, &scratch);
+    begin_macro_task(query);
+}
+
+/**
+ * Finish the current macro task. Success stores its steps for replay;
+ * failure of a replayed task invalidates the macro.
+ */
+JNIEXPORT void JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_endMacroTask(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jboolean success
+) {
+    TraceSpan span("jni.end_macro_task");
+    g_macro_cache.end_task(success == JNI_TRUE);
+}
+
+/**
+ * Enable or disable macro replay and recording; `clear` drops stored macros
+ */
+JNIEXPORT void JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_setMacroCache(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jboolean enabled,
+    jboolean clear
+) {
+    TraceSpan span("jni.set_macro_cache");
+    g_macro_cache.set_enabled(enabled == JNI_TRUE);
+    if (clear == JNI_TRUE) {
+        g_macro_cache.clear();
     }
+}
+
+/**
+ * Macro cache counters as JSON
+ */
+JNIEXPORT jstring JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_getMacroStats(
+    JNIEnv* env,
+    jobject /* this */
+) {
+    TraceSpan span("jni.get_macro_stats");
+    return string_to_jstring(env, macro_stats_json());
+}
+
+/**
+ * Load the model the semantic cache embeds queries with. Passing the main
+ * model's path shares its weights; the cache stays inactive until this succeeds.
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_loadEmbeddingModel(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jModelPath
+) {
+    TraceSpan span("jni.load_embedding_model");
+    return init_engine(env, embedding_engine(), jModelPath, nullptr) ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * Configure the semantic cache (see native_semantic.hpp)
+ * @param threshold Cosine similarity needed for a hit
+ * @param capacity Entries kept; changing it clears the cache
+ */
+JNIEXPORT void JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_setSemanticCache(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jboolean enabled,
+    jfloat threshold,
+    jint capacity
+) {
+    TraceSpan span("jni.set_semantic_cache");
+    g_semantic_cache.set_enabled(enabled == JNI_TRUE);
+    g_semantic_cache.configure(std::clamp(threshold, 0.0f, 1.0f),
+                               static_cast<std::size_t>(std::max<jint>(capacity, 1)));
+}
 
-    auto safe_query = sentinel::sanitize(user_query, 2048);
-    auto safe_context = sentinel::sanitize(screen_context, 32000);
+/**
+ * The last semantic cache hit produced a wrong action: drop it and count it
+ */
+JNIEXPORT void JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_reportCacheFalsePositive(
+    JNIEnv* /* env */,
+    jobject /* this */
+) {
+    TraceSpan span("jni.report_cache_false_positive");
+    g_semantic_cache.report_false_positive();
+}
+
+/**
+ * Semantic cache counters as JSON
+ */
+JNIEXPORT jstring JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_getSemanticCacheStats(
+    JNIEnv* env,
+    jobject /* this */
+) {
+    TraceSpan span("jni.get_semantic_cache_stats");
+    return string_to_jstring(env, semantic_stats_json());
+}
 
-    std::string system_prompt = R"(You are an Android accessibility agent. Analyze the screen and respond with a JSON action.
+/**
+ * Per-phase latency percentiles, throughput and the last `lastN` requests
+ * as JSON (see native_metrics.hpp)
+ */
+JNIEXPORT jstring JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_getMetrics(
+    JNIEnv* env,
+    jobject /* this */,
+    jint lastN
+) {
+    TraceSpan span("jni.get_metrics");
+    return string_to_jstring(env, g_metrics.to_json(static_cast<std::size_t>(std::max<jint>(lastN, 0))));
+}
 
-Available actions:
-- CLICK: {"action":"CLICK","target":"element_id","reasoning":"why"}
-- TYPE: {"action":"TYPE","target":"element_id","text":"what to type","reasoning":"why"}
-- SCROLL: {"action":"SCROLL","direction":"up|down|left|right","reasoning":"why"}
-- BACK: {"action":"BACK","reasoning":"why"}
-- NONE: {"action":"NONE","reasoning":"why nothing needed"}
+/**
+ * Clear metrics histograms, counters and recorded requests
+ */
+JNIEXPORT void JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_resetMetrics(
+    JNIEnv* /* env */,
+    jobject /* this */
+) {
+    TraceSpan span("jni.reset_metrics");
+    g_metrics.reset();
+}
 
-Current screen context:
-)" + safe_context + R"(
+/**
+ * The flight recorder's last requests as JSON (see native_flight.hpp):
+ * timings, token counts, response source, error code and grammar id only,
+ * never query, screen or output text
+ */
+JNIEXPORT jstring JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_dumpFlightRecorder(
+    JNIEnv* env,
+    jobject /* this */
+) {
+    TraceSpan span("jni.dump_flight_recorder");
+    return string_to_jstring(env, g_flight_recorder.to_json());
+}
 
-Respond ONLY with valid JSON. No markdown, no explanation outside JSON.)";
+/**
+ * Start or stop recording trace spans (see native_trace.hpp). The span
+ * buffer is allocated on first enable and kept.
+ */
+JNIEXPORT void JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_setTracing(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jboolean enabled,
+    jboolean clear
+) {
+    TraceSpan span("jni.set_tracing");
+    g_tracer.set_enabled(enabled == JNI_TRUE);
+    if (clear == JNI_TRUE) {
+        g_tracer.clear();
+    }
+}
 
-    auto prompt = apply_chat_template(system_prompt, safe_query);
+/**
+ * Write the recorded spans to `path` as Chrome trace-event JSON
+ * (Perfetto UI / chrome://tracing). Recording may continue meanwhile.
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_dumpTrace(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jPath
+) {
+    TraceSpan span("jni.dump_trace");
+    auto path = jstring_to_string(env, jPath);
+    return dump_trace(path) ? JNI_TRUE : JNI_FALSE;
+}
 
-    LOGD("Final prompt length: %zu", prompt.size());
+/**
+ * Start recording every infer/inferWithSnapshot request to `path` for
+ * sentinel-replay (see native_workload.hpp). Replaces any recording in
+ * progress. With `redact`, query and screen text are replaced by
+ * same-shape stand-ins before they are written.
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_startWorkloadRecording(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jPath,
+    jboolean redact
+) {
+    TraceSpan span("jni.start_workload_recording");
+    auto path = jstring_to_string(env, jPath);
+    return g_workload_recorder.start(path, redact == JNI_TRUE) ? JNI_TRUE : JNI_FALSE;
+}
 
-    // Run inference WITHOUT grammar (empty string = no grammar constraint)
-    auto result = run_inference(prompt, "");
+/**
+ * Stop recording and close the file
+ * @return Requests recorded
+ */
+JNIEXPORT jint JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_stopWorkloadRecording(
+    JNIEnv* /* env */,
+    jobject /* this */
+) {
+    TraceSpan span("jni.stop_workload_recording");
+    return static_cast<jint>(g_workload_recorder.stop());
+}
 
-    if (result) {
-        LOGI("Inference result (no grammar): %s", result.value().c_str());
-        return string_to_jstring(env, *result);
-    } else {
-        LOGE("Inference failed: %s", result.error().c_str());
-        return string_to_jstring(env,
-            std::format(R"({{"action":"NONE","reasoning":"{}"}})", result.error()));
+/**
+ * Turn op-level profiling of the default engine on or off (see
+ * native_profiler.hpp). Either change recreates its context on the next
+ * request, dropping the KV cache.
+ * @param reset Clear the accumulated profile
+ */
+JNIEXPORT void JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_setOpProfiling(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jboolean enabled,
+    jboolean reset
+) {
+    TraceSpan span("jni.set_op_profiling");
+    Engine& engine = default_engine();
+    std::unique_lock lock(engine.mutex);
+    engine.set_profile_ops(enabled == JNI_TRUE);
+    if (reset == JNI_TRUE) {
+        g_op_profiler.reset();
     }
 }
 
 /**
- * Release model resources
+ * Accumulated time and bytes per ggml op type and per layer as JSON
+ */
+JNIEXPORT jstring JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_getOpProfile(
+    JNIEnv* env,
+    jobject /* this */
+) {
+    TraceSpan span("jni.get_op_profile");
+    return string_to_jstring(env, op_profile_json(g_op_profiler.snapshot()));
+}
+
+/**
+ * Load the fast-path router's logistic model (see native_router.hpp).
+ * Built-in exact phrases route even without one.
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_loadRouterModel(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jPath
+) {
+    TraceSpan span("jni.load_router_model");
+    auto path = jstring_to_string(env, jPath);
+    return load_router_model(path) ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * Enable or disable the fast path and set the model's confidence threshold
  */
 JNIEXPORT void JNICALL
-Java_com_mazzlabs_sentinel_core_NativeBridge_releaseModel(
+Java_com_mazzlabs_sentinel_core_NativeBridge_setRouterParams(
     JNIEnv* /* env */,
+    jobject /* this */,
+    jboolean enabled,
+    jfloat threshold
+) {
+    TraceSpan span("jni.set_router_params");
+    g_intent_router.set_enabled(enabled == JNI_TRUE);
+    g_intent_router.set_threshold(std::clamp(threshold, 0.0f, 1.0f));
+}
+
+/**
+ * Router counters and hit rate as JSON
+ */
+JNIEXPORT jstring JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_getRouterStats(
+    JNIEnv* env,
     jobject /* this */
 ) {
-    std::unique_lock lock(g_model_mutex);
+    TraceSpan span("jni.get_router_stats");
+    return string_to_jstring(env, router_stats_json());
+}
 
-    LOGI("Releasing model resources");
-    g_state.reset();
-    llama_backend_free();
+/**
+ * Register a LoRA adapter for the loaded model under `name`
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_loadAdapter(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jName,
+    jstring jPath
+) {
+    TraceSpan span("jni.load_adapter");
+    Engine& engine = default_engine();
+    std::unique_lock lock(engine.mutex);
+
+    auto name = jstring_to_string(env, jName);
+    auto path = jstring_to_string(env, jPath);
+    return register_adapter(engine, name, std::string(path)) ? JNI_TRUE : JNI_FALSE;
 }
 
 /**
- * Check if model is ready
+ * Define a pipeline stage as a set of registered adapters with scales
  */
 JNIEXPORT jboolean JNICALL
-Java_com_mazzlabs_sentinel_core_NativeBridge_isModelReady(
+Java_com_mazzlabs_sentinel_core_NativeBridge_defineStage(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jStage,
+    jobjectArray jAdapterNames,
+    jfloatArray jScales
+) {
+    TraceSpan span("jni.define_stage");
+    const jsize count = jAdapterNames ? env->GetArrayLength(jAdapterNames) : 0;
+    if (count > 0 && (!jScales || env->GetArrayLength(jScales) < count)) {
+        return JNI_FALSE;
+    }
+
+    std::vector<jfloat> scales(static_cast<size_t>(count));
+    if (count > 0) {
+        env->GetFloatArrayRegion(jScales, 0, count, scales.data());
+    }
+
+    std::vector<AdapterBinding> adapters;
+    adapters.reserve(static_cast<size_t>(count));
+    for (jsize i = 0; i < count; ++i) {
+        auto jName = static_cast<jstring>(env->GetObjectArrayElement(jAdapterNames, i));
+        adapters.push_back({.name = std::string(jstring_to_string(env, jName)), .scale = scales[i]});
+        env->DeleteLocalRef(jName);
+    }
+
+    auto stage = jstring_to_string(env, jStage);
+
+    Engine& engine = default_engine();
+    std::unique_lock lock(engine.mutex);
+    return define_stage(engine, stage, adapters) ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * Select the adapter stage used by calls that name none ("" = base model)
+ */
+JNIEXPORT jboolean JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_setDefaultStage(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jStage
+) {
+    TraceSpan span("jni.set_default_stage");
+    auto stage = jstring_to_string(env, jStage);
+
+    Engine& engine = default_engine();
+    std::unique_lock lock(engine.mutex);
+    return set_default_stage(engine, stage) ? JNI_TRUE : JNI_FALSE;
+}
+
+/**
+ * Passthrough inference with the adapters of `stage` for this call only
+ */
+JNIEXPORT jstring JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_inferStage(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jStage,
+    jstring jUserQuery,
+    jstring jScreenContext,
+    jstring jGrammarPath
+) {
+    TraceSpan span("jni.infer_stage");
+    return infer_on(env, default_engine(), jUserQuery, jScreenContext, jGrammarPath, PromptMode::Passthrough, jStage);
+}
+
+/**
+ * Set the byte budget for resident models (weights + KV), 0 = unlimited.
+ * Takes effect on the next load or release.
+ */
+JNIEXPORT void JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_setMemoryBudget(
     JNIEnv* /* env */,
+    jobject /* this */,
+    jlong bytes
+) {
+    TraceSpan span("jni.set_memory_budget");
+    residency().set_budget(static_cast<uint64_t>(std::max<jlong>(bytes, 0)));
+}
+
+/**
+ * Residency counters as JSON
+ */
+JNIEXPORT jstring JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_getResidencyStats(
+    JNIEnv* env,
     jobject /* this */
 ) {
-    std::shared_lock lock(g_model_mutex);
-    return g_state.is_ready() ? JNI_TRUE : JNI_FALSE;
+    TraceSpan span("jni.get_residency_stats");
+    return string_to_jstring(env, residency_stats_json());
 }
 
 /**
- * Get model metadata
+ * Native memory breakdown as JSON: process RSS and heap, per engine the
+ * weights (mapped vs resident pages), KV cache, compute buffers and
+ * engine caches, the process-wide caches, and peak heap growth per
+ * request. Reads /proc/self/smaps; meant for diagnostics, not polling.
  */
 JNIEXPORT jstring JNICALL
-Java_com_mazzlabs_sentinel_core_NativeBridge_getModelInfo(
+Java_com_mazzlabs_sentinel_core_NativeBridge_getMemoryStats(
     JNIEnv* env,
     jobject /* this */
 ) {
-    std::shared_lock lock(g_model_mutex);
-    
-    if (!g_state.model || !g_state.vocab) {
-        return string_to_jstring(env, R"({"loaded":false})");
+    TraceSpan span("jni.get_memory_stats");
+    return string_to_jstring(env, memory_stats_json());
+}
+
+/**
+ * Shed native memory for an onTrimMemory `level` (see native_pressure.hpp);
+ * 0 lifts earlier context shrinking. Never waits for a request in flight,
+ * so it is safe on the main thread.
+ * @return JSON: step taken, engines handled and skipped, heap and RSS before/after
+ */
+JNIEXPORT jstring JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_onMemoryPressure(
+    JNIEnv* env,
+    jobject /* this */,
+    jint level
+) {
+    TraceSpan span("jni.on_memory_pressure");
+    return string_to_jstring(env, memory_pressure_json(level));
+}
+
+/**
+ * Create an independent engine. Engines loading the same file share its
+ * weights; each has its own context, sampler and KV cache.
+ * @return opaque handle, or 0 on failure
+ */
+JNIEXPORT jlong JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_createEngine(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jModelPath,
+    jstring jGrammarPath
+) {
+    TraceSpan span("jni.create_engine");
+    auto engine = std::make_shared<Engine>();
+    if (!init_engine(env, *engine, jModelPath, jGrammarPath)) {
+        return 0;
     }
-    
-    auto n_vocab = llama_vocab_n_tokens(g_state.vocab);
-    auto n_ctx_train = llama_model_n_ctx_train(g_state.model);
-    
-    auto info = std::format(
-        R"({{"loaded":true,"n_vocab":{},"n_ctx_train":{},"n_ctx":{}}})",
-        n_vocab, n_ctx_train, g_state.n_ctx
-    );
-    
-    return string_to_jstring(env, info);
+    return static_cast<jlong>(register_engine(std::move(engine)));
 }
 
 /**
- * Set inference parameters
+ * Unregister an engine; it is freed once in-flight calls on it finish
  */
 JNIEXPORT void JNICALL
-Java_com_mazzlabs_sentinel_core_NativeBridge_setInferenceParams(
+Java_com_mazzlabs_sentinel_core_NativeBridge_destroyEngine(
     JNIEnv* /* env */,
     jobject /* this */,
+    jlong jHandle
+) {
+    TraceSpan span("jni.destroy_engine");
+    if (!unregister_engine(static_cast<EngineHandle>(jHandle))) {
+        LOGW("destroyEngine: unknown handle %lld", static_cast<long long>(jHandle));
+    }
+}
+
+/**
+ * Run agent-mode inference on an engine created by createEngine
+ */
+JNIEXPORT jstring JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_inferEngine(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong jHandle,
+    jstring jUserQuery,
+    jstring jScreenContext
+) {
+    TraceSpan span("jni.infer_engine");
+    auto engine = find_engine(static_cast<EngineHandle>(jHandle));
+    if (!engine) {
+        return string_to_jstring(env, R"({"action":"NONE","reasoning":"Unknown engine"})");
+    }
+    return infer_on(env, *engine, jUserQuery, jScreenContext, nullptr, PromptMode::Agent);
+}
+
+/**
+ * Run passthrough inference on an engine with a per-call grammar path
+ * (empty path = unconstrained)
+ */
+JNIEXPORT jstring JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_inferEngineWithGrammar(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong jHandle,
+    jstring jUserQuery,
+    jstring jScreenContext,
+    jstring jGrammarPath
+) {
+    TraceSpan span("jni.infer_engine_with_grammar");
+    auto engine = find_engine(static_cast<EngineHandle>(jHandle));
+    if (!engine) {
+        return string_to_jstring(env, R"({"action":"NONE","reasoning":"Unknown engine"})");
+    }
+    return infer_on(env, *engine, jUserQuery, jScreenContext, jGrammarPath, PromptMode::Passthrough);
+}
+
+/**
+ * Set sampling parameters of one engine
+ */
+JNIEXPORT void JNICALL
+Java_com_mazzlabs_sentinel_core_NativeBridge_setEngineParams(
+    JNIEnv* /* env */,
+    jobject /* this */,
+    jlong jHandle,
     jfloat temperature,
     jfloat topP,
     jint maxTokens
 ) {
-    std::unique_lock lock(g_model_mutex);
-    
-    g_state.temperature = temperature;
-    g_state.top_p = topP;
-    g_state.max_tokens = maxTokens;
-    
-    LOGI("Inference params updated: temp=%.2f, top_p=%.2f, max_tokens=%d",
-         temperature, topP, maxTokens);
+    TraceSpan span("jni.set_engine_params");
+    if (auto engine = find_engine(static_cast<EngineHandle>(jHandle))) {
+        set_params(*engine, temperature, topP, maxTokens);
+    }
 }
 
 } // extern "C"
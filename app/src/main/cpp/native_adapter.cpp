@@ -0,0 +1,108 @@
+#include "native_adapter.hpp"
+
+#include "native_kv.hpp"
+#include "native_logging.hpp"
+#include "native_residency.hpp"
+
+namespace sentinel_native {
+
+[[nodiscard]] bool register_adapter(Engine& engine, std::string_view name, const std::string& path) {
+    if (name.empty() || path.empty()) {
+        return false;
+    }
+
+    if (engine.weights) {
+        const uint64_t before = engine.weights->adapter_bytes();
+        if (!engine.weights->adapter(path)) {
+            return false;
+        }
+        if (engine.weights->adapter_bytes() != before) {
+            residency().loaded(engine);
+        }
+    }
+
+    engine.adapter_paths.insert_or_assign(std::string(name), path);
+    LOGI("Adapter registered: %.*s", static_cast<int>(name.size()), name.data());
+    return true;
+}
+
+[[nodiscard]] bool define_stage(Engine& engine, std::string_view stage, std::span<const AdapterBinding> adapters) {
+    if (stage.empty()) {
+        return false;
+    }
+    for (const AdapterBinding& binding : adapters) {
+        if (!engine.adapter_paths.contains(binding.name)) {
+            LOGE("Stage %.*s: unknown adapter %s",
+                 static_cast<int>(stage.size()), stage.data(), binding.name.c_str());
+            return false;
+        }
+    }
+
+    engine.stages.insert_or_assign(std::string(stage), std::vector(adapters.begin(), adapters.end()));
+    return true;
+}
+
+[[nodiscard]] bool set_default_stage(Engine& engine, std::string_view stage) {
+    if (!stage.empty() && !engine.stages.contains(stage)) {
+        return false;
+    }
+    engine.default_stage = stage;
+    return true;
+}
+
+[[nodiscard]] bool apply_stage(Engine& engine, std::string_view stage) {
+    if (!engine.is_ready()) {
+        return false;
+    }
+    if (stage.empty()) {
+        stage = engine.default_stage;
+    }
+
+    // Adapters load lazily (e.g. after an eviction), growing the footprint
+    const uint64_t adapter_bytes = engine.weights->adapter_bytes();
+    std::vector<std::pair<llama_adapter_lora*, float>> wanted;
+    if (!stage.empty()) {
+        auto it = engine.stages.find(stage);
+        if (it == engine.stages.end()) {
+            LOGE("Unknown stage: %.*s", static_cast<int>(stage.size()), stage.data());
+            return false;
+        }
+        wanted.reserve(it->second.size());
+        for (const AdapterBinding& binding : it->second) {
+            auto path = engine.adapter_paths.find(binding.name);
+            llama_adapter_lora* lora = path != engine.adapter_paths.end()
+                ? engine.weights->adapter(path->second) : nullptr;
+            if (!lora) {
+                return false;
+            }
+            wanted.emplace_back(lora, binding.scale);
+        }
+    }
+
+    if (engine.weights->adapter_bytes() != adapter_bytes) {
+        residency().loaded(engine);
+    }
+    if (wanted == engine.applied_adapters) {
+        return true;
+    }
+
+    llama_clear_adapter_lora(engine.ctx);
+    for (const auto& [lora, scale] : wanted) {
+        if (llama_set_adapter_lora(engine.ctx, lora, scale) != 0) {
+            LOGE("Failed to set LoRA adapter");
+            llama_clear_adapter_lora(engine.ctx);
+            engine.applied_adapters.clear();
+            invalidate_kv(engine);
+            return false;
+        }
+    }
+    engine.applied_adapters = std::move(wanted);
+    // Cached keys/values were computed under the previous adapter set
+    invalidate_kv(engine);
+
+    LOGD("Adapter stage applied: %.*s (%zu adapters)",
+         static_cast<int>(stage.size()), stage.data(), engine.applied_adapters.size());
+    return true;
+}
+
+} // namespace sentinel_native
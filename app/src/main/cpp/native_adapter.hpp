@@ -0,0 +1,39 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "native_engine.hpp"
+
+namespace sentinel_native {
+
+/**
+ * Per-stage LoRA adapters.
+ *
+ * Adapters are registered by name and grouped into stages ("intent",
+ * "risk", ...), each a set of adapters with scales. A request names its
+ * stage; apply_stage swaps the adapter set on the context with
+ * llama_set_adapter_lora, so the base weights stay loaded once. The KV
+ * cache is only dropped when the set actually changes, since cached keys
+ * and values depend on it; consecutive requests of one stage keep their
+ * shared prefix.
+ *
+ * All functions require the engine mutex held exclusively.
+ */
+
+// Register (or replace) adapter `name`. Loads it now if the model is
+// resident, so a bad file fails here rather than at the next request.
+[[nodiscard]] bool register_adapter(Engine& engine, std::string_view name, const std::string& path);
+
+// Define `stage` as the given adapters; every name must be registered.
+// An empty set makes the stage run on the base model.
+[[nodiscard]] bool define_stage(Engine& engine, std::string_view stage, std::span<const AdapterBinding> adapters);
+
+// Make `stage` the adapter set of requests that name none; "" = base model
+[[nodiscard]] bool set_default_stage(Engine& engine, std::string_view stage);
+
+// Put the adapters of `stage` (default stage if empty) on the context
+[[nodiscard]] bool apply_stage(Engine& engine, std::string_view stage);
+
+} // namespace sentinel_native
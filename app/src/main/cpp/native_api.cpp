@@ -0,0 +1,370 @@
+#include "native_api.hpp"
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+
+#include "llama.h"
+#include "sentinel.hpp"
+
+#include "native_arena.hpp"
+#include "native_flight.hpp"
+#include "native_logging.hpp"
+#include "native_macro.hpp"
+#include "native_memory.hpp"
+#include "native_metrics.hpp"
+#include "native_pressure.hpp"
+#include "native_residency.hpp"
+#include "native_resolver.hpp"
+#include "native_router.hpp"
+#include "native_screen.hpp"
+#include "native_semantic.hpp"
+#include "native_snapshot.hpp"
+#include "native_trace.hpp"
+#include "native_utils.hpp"
+#include "native_workload.hpp"
+
+namespace sentinel_native {
+
+namespace {
+
+// Workload record of a request on `engine`, sampling params included
+[[nodiscard]] WorkloadRecord workload_record(
+    const Engine& engine,
+    WorkloadKind kind,
+    std::string_view user_query,
+    std::string_view screen
+) {
+    WorkloadRecord record;
+    record.kind = kind;
+    record.temperature = engine.temperature;
+    record.top_p = engine.top_p;
+    record.max_tokens = engine.max_tokens;
+    record.query = user_query;
+    record.screen = screen;
+    return record;
+}
+
+} // namespace
+
+bool init_engine(Engine& engine, std::string_view model_path, std::string_view grammar_path) {
+    std::unique_lock lock(engine.mutex);
+
+    LOGI("Initializing model: %.*s", static_cast<int>(model_path.size()), model_path.data());
+
+    std::string grammar;
+    if (!grammar_path.empty()) {
+        grammar = load_grammar_cached(grammar_path);
+        if (!grammar.empty()) {
+            LOGI("Grammar loaded: %zu bytes", grammar.size());
+        }
+    }
+
+    if (!engine.load(std::string(model_path), grammar)) {
+        return false;
+    }
+
+    LOGI("Model initialization complete (chat template mode)");
+    return true;
+}
+
+void set_params(Engine& engine, float temperature, float top_p, int32_t max_tokens) {
+    std::unique_lock lock(engine.mutex);
+
+    engine.temperature = temperature;
+    engine.top_p = top_p;
+    engine.max_tokens = max_tokens;
+
+    LOGI("Inference params updated: temp=%.2f, top_p=%.2f, max_tokens=%d",
+         temperature, top_p, max_tokens);
+}
+
+void set_screen_encoding(Engine& engine, int32_t level, int32_t grid, int32_t screen_width, int32_t screen_height) {
+    std::unique_lock lock(engine.mutex);
+
+    engine.screen_encoding = {
+        .level = static_cast<ScreenEncoding>(std::clamp<int32_t>(level, 0, 2)),
+        .grid = std::max<int32_t>(grid, 0),
+        .screen_width = screen_width,
+        .screen_height = screen_height,
+    };
+
+    LOGI("Screen encoding updated: level=%d, grid=%d, screen=%dx%d",
+         level, grid, screen_width, screen_height);
+}
+
+[[nodiscard]] std::pmr::string infer_locked(Engine& engine, const InferCall& call, std::pmr::memory_resource* mr) {
+    const std::string* grammar_text = &engine.grammar_text;
+    if (call.grammar_path) {
+        grammar_text = call.grammar_path->empty() ? nullptr : &load_grammar_cached(*call.grammar_path);
+    }
+
+    // While recording, the request's metrics must outlive handle_request
+    std::optional<RequestScope> scope;
+    if (g_workload_recorder.recording()) {
+        scope.emplace(engine);
+    }
+
+    std::pmr::string result = handle_request(engine, {
+        .user_query = call.user_query,
+        .screen_context = call.screen_context,
+        .mode = call.mode,
+        .grammar_text = grammar_text,
+        .stage = call.stage,
+    }, mr);
+
+    if (const RequestMetrics* metrics = scope ? scope->close() : nullptr) {
+        WorkloadRecord record = workload_record(engine, WorkloadKind::Text, call.user_query, call.screen_context);
+        record.mode = call.mode;
+        if (call.grammar_path) {
+            record.grammar = call.grammar_path->empty() ? WorkloadGrammar::None : WorkloadGrammar::Path;
+            record.grammar_path = *call.grammar_path;
+        }
+        record.stage = call.stage;
+        g_workload_recorder.record(std::move(record), *metrics);
+    }
+    return result;
+}
+
+[[nodiscard]] std::string infer(Engine& engine, const InferCall& call) {
+    std::unique_lock lock(engine.mutex);
+    ArenaScope arena(engine.arena);
+    return std::string(infer_locked(engine, call, arena.resource()));
+}
+
+[[nodiscard]] std::pmr::string infer_snapshot_locked(
+    Engine& engine,
+    std::string_view user_query,
+    std::span<const std::byte> snapshot,
+    std::pmr::memory_resource* mr
+) {
+    auto parsed = ScreenSnapshot::parse(snapshot);
+    if (!parsed) {
+        LOGE("Snapshot rejected: %s", parsed.error().c_str());
+        std::pmr::string error(mr);
+        std::format_to(std::back_inserter(error), R"({{"action":"NONE","reasoning":"{}"}})", parsed.error());
+        return error;
+    }
+
+    std::optional<RequestScope> scope;
+    if (g_workload_recorder.recording()) {
+        scope.emplace(engine);
+    }
+
+    std::pmr::string result = handle_snapshot_request(engine, user_query, *parsed, engine.grammar_text, mr);
+
+    if (const RequestMetrics* metrics = scope ? scope->close() : nullptr) {
+        const std::string_view packed(reinterpret_cast<const char*>(snapshot.data()), snapshot.size());
+        g_workload_recorder.record(workload_record(engine, WorkloadKind::Snapshot, user_query, packed), *metrics);
+    }
+    return result;
+}
+
+[[nodiscard]] std::string infer_snapshot(Engine& engine, std::string_view user_query, std::span<const std::byte> snapshot) {
+    std::unique_lock lock(engine.mutex);
+    ArenaScope arena(engine.arena);
+    return std::string(infer_snapshot_locked(engine, user_query, snapshot, arena.resource()));
+}
+
+void begin_screen(Engine& engine, std::string_view query) {
+    engine.screen_stream().begin(query);
+}
+
+[[nodiscard]] bool append_screen(Engine& engine, std::span<const std::byte> batch) {
+    return engine.screen_stream().append(batch);
+}
+
+[[nodiscard]] int32_t end_screen(Engine& engine) {
+    auto result = engine.screen_stream().end();
+    if (!result) {
+        LOGE("Screen stream failed: %s", result.error().c_str());
+        return -1;
+    }
+    return static_cast<int32_t>(*result);
+}
+
+[[nodiscard]] std::pmr::string infer_streamed_locked(
+    Engine& engine,
+    std::string_view user_query,
+    std::pmr::memory_resource* mr
+) {
+    std::optional<RequestScope> scope;
+    if (g_workload_recorder.recording()) {
+        scope.emplace(engine);
+    }
+
+    std::pmr::string result = handle_streamed_request(engine, user_query, engine.grammar_text, mr);
+
+    if (const RequestMetrics* metrics = scope ? scope->close() : nullptr) {
+        // A stream begun before the recording has no batches to replay
+        if (auto batches = engine.screen_stream().recorded_batches()) {
+            g_workload_recorder.record(workload_record(engine, WorkloadKind::Streamed, user_query, *batches), *metrics);
+        }
+    }
+    return result;
+}
+
+[[nodiscard]] std::string infer_streamed(Engine& engine, std::string_view user_query) {
+    std::unique_lock lock(engine.mutex);
+    ArenaScope arena(engine.arena);
+    return std::string(infer_streamed_locked(engine, user_query, arena.resource()));
+}
+
+[[nodiscard]] int32_t load_target_elements(std::span<const std::byte> snapshot) {
+    auto parsed = ScreenSnapshot::parse(snapshot);
+    if (!parsed) {
+        LOGE("Snapshot rejected: %s", parsed.error().c_str());
+        return -1;
+    }
+
+    std::lock_guard lock(g_resolver_mutex);
+    g_target_resolver.load(*parsed);
+    return static_cast<int32_t>(g_target_resolver.size());
+}
+
+void begin_macro_task(std::string_view query) {
+    std::array<std::byte, 4096> buffer;
+    std::pmr::monotonic_buffer_resource scratch(buffer.data(), buffer.size());
+
+    std::pmr::string safe_query(&scratch);
+    sentinel::sanitize_into(query, safe_query, 2048);
+    g_macro_cache.begin_task(safe_query);
+}
+
+bool load_router_model(std::string_view path) {
+    std::string error;
+    if (!g_intent_router.load_model(std::string(path), error)) {
+        LOGE("Router model rejected: %s", error.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool dump_trace(std::string_view path) {
+    const std::string file(path);
+    std::ofstream out{file, std::ios::binary | std::ios::trunc};
+    if (!out) {
+        LOGE("Cannot write trace to %s", file.c_str());
+        return false;
+    }
+    const std::string json = g_tracer.to_json();
+    out.write(json.data(), static_cast<std::streamsize>(json.size()));
+    return static_cast<bool>(out);
+}
+
+[[nodiscard]] std::string model_info_json(Engine& engine) {
+    std::shared_lock lock(engine.mutex);
+
+    if (!engine.is_available()) {
+        return R"({"loaded":false})";
+    }
+    if (!engine.is_ready()) {
+        return R"({"loaded":true,"resident":false})";
+    }
+
+    auto n_vocab = llama_vocab_n_tokens(engine.vocab);
+    auto n_ctx_train = llama_model_n_ctx_train(engine.model);
+
+    return std::format(
+        R"({{"loaded":true,"resident":true,"n_vocab":{},"n_ctx_train":{},"n_ctx":{},"weights_bytes":{},"kv_bytes":{},"context_bytes":{}}})",
+        n_vocab, n_ctx_train, engine.n_ctx, llama_model_size(engine.model),
+        kv_cache_bytes(engine.model, engine.n_ctx), engine.context_heap_bytes
+    );
+}
+
+[[nodiscard]] std::string macro_stats_json() {
+    const MacroStats stats = g_macro_cache.stats();
+    return std::format(
+        R"({{"lookups":{},"hits":{},"drifts":{},"failures":{},"recorded":{},"size":{}}})",
+        stats.lookups, stats.hits, stats.drifts, stats.failures, stats.recorded, stats.size);
+}
+
+[[nodiscard]] std::string semantic_stats_json() {
+    const SemanticStats stats = g_semantic_cache.stats();
+    return std::format(
+        R"({{"lookups":{},"hits":{},"misses":{},"inserts":{},"evictions":{},"false_positives":{},"size":{},"threshold":{:.3f}}})",
+        stats.lookups, stats.hits, stats.misses, stats.inserts, stats.evictions, stats.false_positives,
+        stats.size, stats.threshold);
+}
+
+[[nodiscard]] std::string router_stats_json() {
+    const RouterStats stats = g_intent_router.stats();
+    const uint64_t hits = stats.exact_hits + stats.model_hits;
+
+    std::string by_intent;
+    for (std::size_t i = 1; i < ROUTE_INTENTS; ++i) {
+        if (i > 1) by_intent += ',';
+        by_intent += std::format(R"("{}":{})", route_intent_name(static_cast<RouteIntent>(i)), stats.by_intent[i]);
+    }
+
+    return std::format(
+        R"({{"queries":{},"exact_hits":{},"model_hits":{},"hit_rate":{:.4f},"model_loaded":{},"by_intent":{{{}}}}})",
+        stats.queries, stats.exact_hits, stats.model_hits,
+        stats.queries ? static_cast<double>(hits) / static_cast<double>(stats.queries) : 0.0,
+        g_intent_router.has_model(), by_intent);
+}
+
+[[nodiscard]] std::string residency_stats_json() {
+    const ResidencyStats stats = residency().stats();
+    return std::format(
+        R"({{"budget_bytes":{},"resident_bytes":{},"engines":{},"resident_engines":{},"evictions":{},"reloads":{}}})",
+        stats.budget_bytes, stats.resident_bytes, stats.engines, stats.resident_engines,
+        stats.evictions, stats.reloads);
+}
+
+[[nodiscard]] std::string memory_stats_json() {
+    std::string out;
+    out.reserve(2048);
+    auto it = std::back_inserter(out);
+
+    std::format_to(it, R"({{"process":{{"rss_bytes":{},"heap_bytes":{}}},"engines":[)",
+        process_rss_bytes(), heap_allocated_bytes());
+    bool first = true;
+    std::string model;
+    for (const EngineMemory& m : residency().memory()) {
+        model.clear();
+        append_json_escaped(m.model_path, model);
+        std::format_to(it,
+            R"({}{{"model":"{}","resident":{},"busy":{},"n_ctx":{},"weights_bytes":{},"adapter_bytes":{},)"
+            R"("mapped_bytes":{},"mapped_resident_bytes":{},"kv_bytes":{},"context_bytes":{},"compute_bytes":{},)"
+            R"("checkpoint_bytes":{},"token_cache_bytes":{},"layout_bytes":{},"arena_bytes":{}}})",
+            first ? "" : ",", model, m.resident, m.busy, m.n_ctx, m.weights_bytes,
+            m.adapter_bytes, m.mapped_bytes, m.mapped_resident_bytes, m.kv_bytes, m.context_bytes,
+            m.compute_bytes, m.checkpoint_bytes, m.token_cache_bytes, m.layout_bytes, m.arena_bytes);
+        first = false;
+    }
+
+    std::size_t resolver_bytes;
+    {
+        std::lock_guard lock(g_resolver_mutex);
+        resolver_bytes = g_target_resolver.memory_bytes();
+    }
+    std::format_to(it,
+        R"(],"caches":{{"macro_bytes":{},"semantic_bytes":{},"router_bytes":{},"grammar_bytes":{},)"
+        R"("resolver_bytes":{},"trace_bytes":{},"flight_bytes":{}}},"requests":)",
+        g_macro_cache.memory_bytes(), g_semantic_cache.memory_bytes(), g_intent_router.memory_bytes(),
+        grammar_cache_bytes(), resolver_bytes, g_tracer.memory_bytes(), sizeof(g_flight_recorder));
+    // Peak heap growth per request lives with the other request metrics
+    out += g_metrics.memory_json();
+    out += '}';
+    return out;
+}
+
+[[nodiscard]] std::string memory_pressure_json(int32_t trim_level) {
+    const auto step = pressure_step(trim_level);
+    if (!step) {
+        return R"({"step":"ignored"})";
+    }
+    const PressureReport report = relieve_memory_pressure(*step);
+    return std::format(
+        R"({{"step":"{}","engines":{},"busy":{},"heap_before":{},"heap_after":{},"rss_before":{},"rss_after":{}}})",
+        pressure_step_name(report.step), report.engines, report.busy, report.heap_before, report.heap_after,
+        report.rss_before, report.rss_after);
+}
+
+} // namespace sentinel_native
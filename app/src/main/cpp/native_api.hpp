@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "native_engine.hpp"
+#include "native_request.hpp"
+
+namespace sentinel_native {
+
+/**
+ * Plain C++ entry points of sentinel_core: the operations NativeBridge
+ * exposes, minus JNI. native-lib.cpp only marshals Java values into these;
+ * host tools call them directly. Functions lock the engine themselves
+ * unless named *_locked, whose caller holds engine.mutex exclusively.
+ * Inference results and stats are JSON, as NativeBridge returns them.
+ */
+
+// Load a model into `engine`; an empty grammar path loads no grammar
+bool init_engine(Engine& engine, std::string_view model_path, std::string_view grammar_path);
+
+void set_params(Engine& engine, float temperature, float top_p, int32_t max_tokens);
+
+// level 0 = verbose, 1 = compact, 2 = dense (clamped); grid 0 omits positions
+void set_screen_encoding(Engine& engine, int32_t level, int32_t grid, int32_t screen_width, int32_t screen_height);
+
+struct InferCall {
+    std::string_view user_query;
+    std::string_view screen_context;
+    PromptMode mode = PromptMode::Agent;
+    // Unset = the engine's own grammar, empty = no grammar, else a .gbnf path
+    std::optional<std::string_view> grammar_path = std::nullopt;
+    std::string_view stage = {};  // empty = the engine's default stage
+};
+
+[[nodiscard]] std::pmr::string infer_locked(
+    Engine& engine,
+    const InferCall& call,
+    std::pmr::memory_resource* mr = std::pmr::get_default_resource()
+);
+
+// Locks the engine and runs the request in its arena
+[[nodiscard]] std::string infer(Engine& engine, const InferCall& call);
+
+/**
+ * Agent-mode inference on a packed accessibility snapshot (see
+ * native_snapshot.hpp) with the engine's grammar. A malformed snapshot
+ * yields a NONE action with the parse error as reasoning.
+ */
+[[nodiscard]] std::pmr::string infer_snapshot_locked(
+    Engine& engine,
+    std::string_view user_query,
+    std::span<const std::byte> snapshot,
+    std::pmr::memory_resource* mr = std::pmr::get_default_resource()
+);
+
+[[nodiscard]] std::string infer_snapshot(Engine& engine, std::string_view user_query, std::span<const std::byte> snapshot);
+
+// Incremental screen ingestion on the engine's ScreenStream (see
+// native_screen.hpp). begin_screen and append_screen never wait for the
+// engine; batches are pruned against `query` (empty = unranked), and
+// end_screen returns the screen's prompt tokens or -1.
+void begin_screen(Engine& engine, std::string_view query);
+[[nodiscard]] bool append_screen(Engine& engine, std::span<const std::byte> batch);
+[[nodiscard]] int32_t end_screen(Engine& engine);
+
+/**
+ * Agent-mode inference on the screen streamed by the last begin_screen,
+ * append_screen, end_screen sequence, with the engine's grammar
+ */
+[[nodiscard]] std::pmr::string infer_streamed_locked(
+    Engine& engine,
+    std::string_view user_query,
+    std::pmr::memory_resource* mr = std::pmr::get_default_resource()
+);
+
+[[nodiscard]] std::string infer_streamed(Engine& engine, std::string_view user_query);
+
+// Replace the resolveTarget element set; -1 if the snapshot is invalid
+[[nodiscard]] int32_t load_target_elements(std::span<const std::byte> snapshot);
+
+// Sanitizes the query like a request does before keying the macro cache
+void begin_macro_task(std::string_view query);
+
+bool load_router_model(std::string_view path);
+
+// Recorded trace spans as Chrome trace-event JSON
+bool dump_trace(std::string_view path);
+
+// Shared lock on the engine
+[[nodiscard]] std::string model_info_json(Engine& engine);
+
+[[nodiscard]] std::string macro_stats_json();
+[[nodiscard]] std::string semantic_stats_json();
+[[nodiscard]] std::string router_stats_json();
+[[nodiscard]] std::string residency_stats_json();
+
+// Reads /proc/self/smaps; diagnostics, not polling
+[[nodiscard]] std::string memory_stats_json();
+
+// Apply the pressure step for an onTrimMemory level and report it
+[[nodiscard]] std::string memory_pressure_json(int32_t trim_level);
+
+} // namespace sentinel_native
@@ -0,0 +1,61 @@
+#include "native_arena.hpp"
+
+#include <new>
+
+#include "native_logging.hpp"
+
+namespace sentinel_native {
+
+void* RequestArena::SpillCounter::do_allocate(std::size_t size, std::size_t align) {
+    bytes += size;
+    return ::operator new(size, std::align_val_t{align});
+}
+
+void RequestArena::SpillCounter::do_deallocate(void* p, std::size_t size, std::size_t align) {
+    ::operator delete(p, size, std::align_val_t{align});
+}
+
+bool RequestArena::SpillCounter::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+RequestArena::RequestArena(std::size_t initial_capacity)
+    : buffer_(std::make_unique_for_overwrite<std::byte[]>(initial_capacity)),
+      capacity_(initial_capacity) {
+    pool_.emplace(buffer_.get(), capacity_, &spill_);
+}
+
+void RequestArena::reset() {
+    // Returns spilled chunks to the heap and rewinds to the start of buffer_
+    pool_->release();
+
+    if (spill_.bytes == 0) {
+        return;
+    }
+
+    // The monotonic pool keeps its initial buffer pointer, so it has to be
+    // rebuilt around the larger block.
+    const std::size_t grown = capacity_ + spill_.bytes + spill_.bytes / 2;
+    LOGD("Request arena spilled %zu bytes, growing %zu -> %zu", spill_.bytes, capacity_, grown);
+
+    pool_.reset();
+    buffer_ = std::make_unique_for_overwrite<std::byte[]>(grown);
+    capacity_ = grown;
+    spill_.bytes = 0;
+    pool_.emplace(buffer_.get(), capacity_, &spill_);
+}
+
+void RequestArena::shrink() {
+    pool_->release();
+    if (capacity_ <= DEFAULT_CAPACITY) {
+        return;
+    }
+
+    pool_.reset();
+    buffer_ = std::make_unique_for_overwrite<std::byte[]>(DEFAULT_CAPACITY);
+    capacity_ = DEFAULT_CAPACITY;
+    spill_.bytes = 0;
+    pool_.emplace(buffer_.get(), capacity_, &spill_);
+}
+
+} // namespace sentinel_native
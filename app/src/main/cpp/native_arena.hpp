@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+namespace sentinel_native {
+
+/**
+ * Per-request monotonic arena.
+ *
+ * Every short-lived buffer of a request (decoded JNI strings, sanitized
+ * copies, system prompt, chat template output, tokens, response) is carved
+ * out of one preallocated block and dropped wholesale by reset(). Requests
+ * that outgrow the block spill to the heap; the next reset() grows the block
+ * to the observed high-water mark so steady-state requests never allocate.
+ */
+class RequestArena {
+public:
+    static constexpr std::size_t DEFAULT_CAPACITY = 256 * 1024;
+
+    explicit RequestArena(std::size_t initial_capacity = DEFAULT_CAPACITY);
+
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    [[nodiscard]] std::pmr::memory_resource* resource() noexcept { return &*pool_; }
+
+    // Invalidates everything allocated since the previous reset
+    void reset();
+
+    // Drop a grown block back to DEFAULT_CAPACITY. Only between requests.
+    void shrink();
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return capacity_; }
+    [[nodiscard]] std::size_t spilled_bytes() const noexcept { return spill_.bytes; }
+
+private:
+    // Upstream for the monotonic pool: counts how far a request overflowed
+    struct SpillCounter final : std::pmr::memory_resource {
+        std::size_t bytes = 0;
+
+        void* do_allocate(std::size_t size, std::size_t align) override;
+        void do_deallocate(void* p, std::size_t size, std::size_t align) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+    std::unique_ptr<std::byte[]> buffer_;
+    std::size_t capacity_;
+    SpillCounter spill_;
+    std::optional<std::pmr::monotonic_buffer_resource> pool_;
+};
+
+// Resets the arena when the request scope ends. Declare before any
+// arena-backed locals so it is destroyed after them.
+class ArenaScope {
+public:
+    explicit ArenaScope(RequestArena& arena) noexcept : arena_(arena) {}
+    ~ArenaScope() { arena_.reset(); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    [[nodiscard]] std::pmr::memory_resource* resource() noexcept { return arena_.resource(); }
+
+private:
+    RequestArena& arena_;
+};
+
+} // namespace sentinel_native
@@ -0,0 +1,76 @@
+#include "native_embedding.hpp"
+
+#include <cmath>
+#include <mutex>
+
+#include "native_logging.hpp"
+#include "native_residency.hpp"
+#include "native_trace.hpp"
+#include "native_utils.hpp"
+
+namespace sentinel_native {
+
+[[nodiscard]] Engine& embedding_engine() {
+    static Engine engine;
+    static std::once_flag configured;
+    std::call_once(configured, [] {
+        engine.embeddings = true;
+        engine.n_ctx = EMBEDDING_N_CTX;
+        engine.n_batch = EMBEDDING_N_CTX;
+    });
+    return engine;
+}
+
+[[nodiscard]] bool embed_text(Engine& engine, std::string_view text, std::vector<float>& out) {
+    if (!residency().ensure_resident(engine)) {
+        return false;
+    }
+
+    auto tokens = tokenize(engine.vocab, text, true, false);
+    if (tokens.empty()) {
+        return false;
+    }
+    if (tokens.size() > static_cast<std::size_t>(engine.n_batch)) {
+        tokens.resize(static_cast<std::size_t>(engine.n_batch));
+    }
+
+    // Every query starts from an empty memory; nothing is reused
+    if (auto mem = llama_get_memory(engine.ctx)) {
+        llama_memory_clear(mem, true);
+    }
+    engine.kv_tokens.clear();
+
+    TraceSpan span("embed", 0, static_cast<int64_t>(tokens.size()));
+    if (llama_decode(engine.ctx, llama_batch_get_one(tokens.data(), static_cast<int32_t>(tokens.size()))) != 0) {
+        LOGE("Embedding decode failed");
+        return false;
+    }
+
+    const float* pooled = llama_get_embeddings_seq(engine.ctx, 0);
+    if (!pooled) {
+        // Pooling unsupported by the model: last token's hidden state
+        pooled = llama_get_embeddings_ith(engine.ctx, -1);
+    }
+    if (!pooled) {
+        LOGE("Model produced no embeddings");
+        return false;
+    }
+
+    const auto n_embd = static_cast<std::size_t>(llama_model_n_embd(engine.model));
+    out.assign(pooled, pooled + n_embd);
+
+    double norm = 0.0;
+    for (float v : out) {
+        norm += static_cast<double>(v) * v;
+    }
+    if (norm <= 0.0) {
+        return false;
+    }
+    const auto inv = static_cast<float>(1.0 / std::sqrt(norm));
+    for (float& v : out) {
+        v *= inv;
+    }
+    return true;
+}
+
+} // namespace sentinel_native
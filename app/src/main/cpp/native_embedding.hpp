@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "native_engine.hpp"
+
+namespace sentinel_native {
+
+/**
+ * Query embeddings.
+ *
+ * The embedding engine is an ordinary Engine whose context pools hidden
+ * states instead of producing logits. Loading the main model's path into it
+ * shares the weights (acquire_weights), so it only costs a small context;
+ * a dedicated embedding model works the same way. It is tracked by the
+ * residency manager like any other engine.
+ */
+[[nodiscard]] Engine& embedding_engine();
+
+// Context length of the embedding engine; queries are truncated to it
+inline constexpr int32_t EMBEDDING_N_CTX = 512;
+
+/**
+ * L2-normalized mean-pooled embedding of `text` into `out`.
+ * Caller must hold engine.mutex exclusively. Reloads an evicted engine.
+ * @return false if the engine has no model or decoding fails
+ */
+[[nodiscard]] bool embed_text(Engine& engine, std::string_view text, std::vector<float>& out);
+
+} // namespace sentinel_native
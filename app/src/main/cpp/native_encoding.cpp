@@ -0,0 +1,161 @@
+#include "native_encoding.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+
+namespace sentinel_native {
+
+namespace {
+
+void append_int(int32_t value, std::pmr::string& out) {
+    char buf[16];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, end);
+}
+
+[[nodiscard]] int32_t quantize(int32_t centre, int32_t extent, int32_t grid) noexcept {
+    const int64_t cell = static_cast<int64_t>(centre) * grid / extent;
+    return static_cast<int32_t>(std::clamp<int64_t>(cell, 0, grid - 1));
+}
+
+} // namespace
+
+ScreenEncoder::ScreenEncoder(std::pmr::memory_resource* mr)
+    : header_(mr), line_(mr), label_(mr), labels_(mr), run_(mr) {
+    reset({});
+}
+
+void ScreenEncoder::reset(const ScreenEncodingOptions& options) {
+    options_ = options;
+    count_ = 0;
+    labels_.clear();
+    run_.clear();
+    run_length_ = 0;
+
+    header_.clear();
+    if (options_.level == ScreenEncoding::Verbose) {
+        header_ = SCREEN_LIST_HEADER;
+        return;
+    }
+    header_ = "UI elements (id:flags label; c=click e=edit s=scroll; =N same label as N";
+    if (options_.level == ScreenEncoding::Dense) {
+        header_ += "; A-B: rows A..B are similar";
+    }
+    if (options_.positions()) {
+        header_ += "; @col,row on a ";
+        append_int(options_.grid, header_);
+        header_ += 'x';
+        append_int(options_.grid, header_);
+        header_ += " grid";
+    }
+    header_ += "):\n";
+}
+
+void ScreenEncoder::append_prefix(const SnapshotElement& element, std::pmr::string& out) const {
+    out += ':';
+    if (element.flags & SNAPSHOT_FLAG_CLICKABLE) out += 'c';
+    if (element.flags & SNAPSHOT_FLAG_EDITABLE) out += 'e';
+    if (element.flags & SNAPSHOT_FLAG_SCROLLABLE) out += 's';
+
+    if (options_.positions()) {
+        out += '@';
+        append_int(quantize(element.left / 2 + element.right / 2, options_.screen_width, options_.grid), out);
+        out += ',';
+        append_int(quantize(element.top / 2 + element.bottom / 2, options_.screen_height, options_.grid), out);
+    }
+    out += ' ';
+}
+
+void ScreenEncoder::render(const SnapshotElement& element, std::pmr::string& out) {
+    if (options_.level == ScreenEncoding::Verbose) {
+        render_element_line(element, out);
+        return;
+    }
+
+    append_int(element.id, out);
+    append_prefix(element, out);
+
+    label_.clear();
+    append_label(element.label, label_);
+    if (label_.size() >= DEDUPE_MIN_LABEL_BYTES) {
+        auto [it, inserted] = labels_.try_emplace(label_, element.id);
+        if (!inserted) {
+            out += '=';
+            append_int(it->second, out);
+            out += '\n';
+            return;
+        }
+    }
+    out += label_;
+    out += '\n';
+}
+
+void ScreenEncoder::render_run(std::pmr::string& out) {
+    const Pending& first = run_.front();
+    const Pending& last = run_.back();
+
+    append_int(first.element.id, out);
+    out += '-';
+    append_int(last.element.id, out);
+    append_prefix(first.element, out);
+    append_int(static_cast<int32_t>(run_length_), out);
+    out += " similar: ";
+    append_label(first.label, out);
+    out += " .. ";
+    append_label(last.label, out);
+    out += '\n';
+}
+
+[[nodiscard]] bool ScreenEncoder::extends_run(const SnapshotElement& element) const noexcept {
+    if (run_.empty()) {
+        return false;
+    }
+    const SnapshotElement& prev = run_.back().element;
+    // Siblings in a list: consecutive ids, same flags and size, on one axis
+    return element.id == prev.id + 1 &&
+           element.flags == prev.flags &&
+           element.right - element.left == prev.right - prev.left &&
+           element.bottom - element.top == prev.bottom - prev.top &&
+           (element.left == prev.left || element.top == prev.top);
+}
+
+void ScreenEncoder::push_run(const SnapshotElement& element) {
+    ++run_length_;
+    if (run_.size() < DENSE_MIN_RUN) {
+        run_.push_back({element, std::pmr::string(element.label, run_.get_allocator())});
+    } else {
+        run_.back().element = element;
+        run_.back().label.assign(element.label);
+    }
+}
+
+void render_snapshot(
+    const ScreenSnapshot& snapshot,
+    std::span<const uint32_t> selected,
+    const ScreenEncodingOptions& options,
+    std::pmr::string& out
+) {
+    out.clear();
+    if (selected.empty()) {
+        out = SCREEN_EMPTY_TEXT;
+        return;
+    }
+
+    ScreenEncoder encoder(out.get_allocator().resource());
+    encoder.reset(options);
+
+    std::pmr::string deferred(out.get_allocator());
+    auto sink = [&](std::string_view line, bool volatile_line) {
+        (volatile_line ? deferred : out) += line;
+    };
+
+    out += encoder.header();
+    for (uint32_t i : selected) {
+        encoder.add(snapshot.element(i), sink);
+    }
+    encoder.finish(sink);
+    out += deferred;
+}
+
+} // namespace sentinel_native
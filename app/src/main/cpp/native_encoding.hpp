@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "native_snapshot.hpp"
+
+namespace sentinel_native {
+
+/**
+ * How screen elements are written into the prompt. Levels are cumulative:
+ *
+ *   Verbose  "  12. [click|edit] Label"       (ElementRegistry.toPromptString)
+ *   Compact  "12:ce Label", repeated labels as "14:c =12"
+ *   Dense    Compact, plus runs of structurally identical siblings
+ *            collapsed to "20-27:c 8 similar: First .. Last"
+ *
+ * With grid > 0 and a known screen size, Compact/Dense lines also carry the
+ * element centre quantized to a grid x grid raster ("12:c@3,7 Label").
+ */
+enum class ScreenEncoding : int32_t {
+    Verbose = 0,
+    Compact = 1,
+    Dense = 2,
+};
+
+struct ScreenEncodingOptions {
+    ScreenEncoding level = ScreenEncoding::Verbose;
+    int32_t grid = 0;
+    int32_t screen_width = 0;
+    int32_t screen_height = 0;
+
+    [[nodiscard]] constexpr bool positions() const noexcept {
+        return level != ScreenEncoding::Verbose && grid > 0 && screen_width > 0 && screen_height > 0;
+    }
+};
+
+// Shortest run of siblings Dense collapses into one line
+inline constexpr std::size_t DENSE_MIN_RUN = 4;
+// Labels shorter than this are cheaper to repeat than to reference
+inline constexpr std::size_t DEDUPE_MIN_LABEL_BYTES = 8;
+
+/**
+ * Stateful encoder for one screen. Elements are fed in document order with
+ * add(); complete lines go to sink(std::string_view line, bool is_volatile).
+ * Dense holds back a possible sibling run until it breaks, so finish() must
+ * be called after the last element.
+ */
+class ScreenEncoder {
+public:
+    explicit ScreenEncoder(std::pmr::memory_resource* mr = std::pmr::get_default_resource());
+
+    // Start a new screen
+    void reset(const ScreenEncodingOptions& options);
+
+    // List header line, explaining the notation for non-verbose levels
+    [[nodiscard]] std::string_view header() const noexcept { return header_; }
+
+    // Interactive elements added since reset()
+    [[nodiscard]] std::size_t count() const noexcept { return count_; }
+
+    template <typename Sink>
+    void add(const SnapshotElement& element, Sink&& sink) {
+        ++count_;
+        const bool volatile_line = is_volatile(element);
+        if (options_.level != ScreenEncoding::Dense) {
+            line_.clear();
+            render(element, line_);
+            sink(std::string_view(line_), volatile_line);
+            return;
+        }
+
+        if (!volatile_line && extends_run(element)) {
+            push_run(element);
+            return;
+        }
+        flush_run(sink);
+        if (volatile_line) {
+            line_.clear();
+            render(element, line_);
+            sink(std::string_view(line_), true);
+        } else {
+            push_run(element);
+        }
+    }
+
+    template <typename Sink>
+    void finish(Sink&& sink) {
+        flush_run(sink);
+    }
+
+private:
+    struct Pending {
+        SnapshotElement element;
+        std::pmr::string label;  // owned copy; element.label is rebound on use
+    };
+
+    void render(const SnapshotElement& element, std::pmr::string& out);
+    void render_run(std::pmr::string& out);
+    void append_prefix(const SnapshotElement& element, std::pmr::string& out) const;
+    [[nodiscard]] bool extends_run(const SnapshotElement& element) const noexcept;
+    void push_run(const SnapshotElement& element);
+
+    template <typename Sink>
+    void flush_run(Sink&& sink) {
+        if (run_length_ >= DENSE_MIN_RUN) {
+            line_.clear();
+            render_run(line_);
+            sink(std::string_view(line_), false);
+        } else {
+            for (auto& pending : run_) {
+                auto element = pending.element;
+                element.label = pending.label;
+                line_.clear();
+                render(element, line_);
+                sink(std::string_view(line_), false);
+            }
+        }
+        run_.clear();
+        run_length_ = 0;
+    }
+
+    ScreenEncodingOptions options_;
+    std::pmr::string header_;
+    std::pmr::string line_;
+    std::pmr::string label_;
+    std::size_t count_ = 0;
+
+    // First id seen with each sanitized label (Compact and Dense)
+    std::pmr::unordered_map<std::pmr::string, int32_t> labels_;
+
+    // Current sibling run (Dense): up to DENSE_MIN_RUN elements; once the
+    // run is longer the last slot holds the latest one
+    std::pmr::vector<Pending> run_;
+    std::size_t run_length_ = 0;
+};
+
+/**
+ * Full screen text for the chosen element indices (see rank_elements),
+ * volatile lines last.
+ */
+void render_snapshot(
+    const ScreenSnapshot& snapshot,
+    std::span<const uint32_t> selected,
+    const ScreenEncodingOptions& options,
+    std::pmr::string& out
+);
+
+} // namespace sentinel_native
@@ -0,0 +1,329 @@
+#include "native_engine.hpp"
+
+#include <filesystem>
+#include <mutex>
+
+#include "native_logging.hpp"
+#include "native_memory.hpp"
+#include "native_profiler.hpp"
+#include "native_residency.hpp"
+#include "native_screen.hpp"
+
+namespace sentinel_native {
+
+namespace {
+
+std::once_flag g_backend_once;
+
+std::mutex g_weights_mutex;
+StringMap<std::weak_ptr<ModelWeights>> g_weights;
+
+std::mutex g_engines_mutex;
+std::unordered_map<EngineHandle, std::shared_ptr<Engine>> g_engines;
+EngineHandle g_next_handle = 1;
+
+} // namespace
+
+ModelWeights::~ModelWeights() {
+    if (model) {
+        LOGI("Freeing model weights: %s", path.c_str());
+        llama_model_free(model);
+    }
+}
+
+[[nodiscard]] std::shared_ptr<ModelWeights> acquire_weights(const std::string& path) {
+    std::call_once(g_backend_once, [] { llama_backend_init(); });
+
+    // Held across the load so two engines asking for one file load it once
+    std::lock_guard lock(g_weights_mutex);
+    if (auto it = g_weights.find(path); it != g_weights.end()) {
+        if (auto shared = it->second.lock()) {
+            LOGI("Sharing loaded weights: %s", path.c_str());
+            return shared;
+        }
+    }
+
+    llama_model_params model_params = llama_model_default_params();
+    model_params.n_gpu_layers = 99;  // Offload as many layers as possible to GPU
+
+    auto weights = std::make_shared<ModelWeights>();
+    weights->path = path;
+    weights->model = llama_model_load_from_file(path.c_str(), model_params);
+    if (!weights->model) {
+        LOGE("Failed to load model from: %s", path.c_str());
+        return nullptr;
+    }
+
+    weights->vocab = llama_model_get_vocab(weights->model);
+    if (!weights->vocab) {
+        LOGE("Failed to get vocab from model");
+        return nullptr;
+    }
+
+    if (const char* tmpl = llama_model_chat_template(weights->model, nullptr)) {
+        weights->chat_template = tmpl;
+        LOGI("Using model's chat template");
+    } else {
+        LOGI("Model has no chat template, will use fallback");
+    }
+
+    weights->recurrent = llama_model_is_recurrent(weights->model) || llama_model_is_hybrid(weights->model);
+
+    g_weights.insert_or_assign(path, weights);
+    LOGI("Model loaded successfully");
+    return weights;
+}
+
+[[nodiscard]] llama_adapter_lora* ModelWeights::adapter(const std::string& adapter_path) {
+    std::lock_guard lock(adapters_mutex_);
+    if (auto it = adapters_.find(adapter_path); it != adapters_.end()) {
+        return it->second;
+    }
+
+    llama_adapter_lora* lora = llama_adapter_lora_init(model, adapter_path.c_str());
+    if (!lora) {
+        LOGE("Failed to load LoRA adapter: %s", adapter_path.c_str());
+        return nullptr;
+    }
+
+    std::error_code ec;
+    const auto file_bytes = std::filesystem::file_size(adapter_path, ec);
+    adapter_bytes_ += ec ? 0 : file_bytes;
+    adapters_.emplace(adapter_path, lora);
+    LOGI("LoRA adapter loaded: %s", adapter_path.c_str());
+    return lora;
+}
+
+[[nodiscard]] uint64_t ModelWeights::adapter_bytes() const {
+    std::lock_guard lock(adapters_mutex_);
+    return adapter_bytes_;
+}
+
+Engine::Engine() {
+    residency().track(*this);
+}
+
+Engine::~Engine() {
+    residency().untrack(*this);
+    screen_stream_.reset();
+    reset();
+}
+
+[[nodiscard]] bool Engine::load(const std::string& path, const std::string& grammar) {
+    if (is_ready() && weights->path == path) {
+        // Still resident (e.g. released but within budget): keep the context
+        // and its KV cache, only the grammar may have changed
+        released = false;
+        grammar_text = grammar;
+        if (sampler) {
+            llama_sampler_free(sampler);
+            sampler = nullptr;
+        }
+        build_sampler();
+        residency().loaded(*this);
+        LOGI("Model still resident, reusing context");
+        return true;
+    }
+
+    // Context released under memory pressure: weights, vocab and the
+    // tokenizer caches are still valid, only the context is rebuilt
+    const bool keep_weights = weights && !ctx && weights->path == path;
+    if (!keep_weights) {
+        release_context();
+        if (path != model_path) {
+            // Adapters are trained against one base model
+            adapter_paths.clear();
+            stages.clear();
+            default_stage.clear();
+        }
+        residency().make_room(*this, path);
+
+        weights = acquire_weights(path);
+        if (!weights) {
+            reset();
+            return false;
+        }
+        model = weights->model;
+        vocab = weights->vocab;
+        chat_template = weights->chat_template;
+        token_cache.reset(vocab);
+    }
+    grammar_text = grammar;
+
+    if (!create_context()) {
+        reset();
+        return false;
+    }
+
+    needs_checkpoints = weights->recurrent;
+    if (needs_checkpoints) {
+        LOGI("Recurrent layers present, prefix reuse will use state checkpoints");
+    }
+
+    if (sampler) {
+        llama_sampler_free(sampler);
+        sampler = nullptr;
+    }
+    build_sampler();
+
+    model_path = path;
+    released = false;
+    residency().loaded(*this);
+    return true;
+}
+
+[[nodiscard]] bool Engine::create_context() {
+    llama_context_params ctx_params = llama_context_default_params();
+    ctx_params.n_ctx = n_ctx;
+    ctx_params.n_batch = n_batch;
+    ctx_params.n_ubatch = n_batch;
+    if (n_threads > 0) {
+        ctx_params.n_threads = n_threads;
+        ctx_params.n_threads_batch = n_threads;
+    }
+    if (embeddings) {
+        ctx_params.embeddings = true;
+        ctx_params.pooling_type = LLAMA_POOLING_TYPE_MEAN;
+    }
+    if (profile_ops) {
+        ctx_params.cb_eval = &OpProfiler::eval_callback;
+        ctx_params.cb_eval_user_data = &g_op_profiler;
+    }
+
+    // Other threads allocating meanwhile skew this; residency takes the
+    // larger of it and the KV estimate
+    const uint64_t heap_before = heap_allocated_bytes();
+    ctx = llama_init_from_model(model, ctx_params);
+    const uint64_t heap_after = heap_allocated_bytes();
+    context_heap_bytes = heap_after > heap_before ? heap_after - heap_before : 0;
+    if (!ctx) {
+        LOGE("Failed to create context");
+        return false;
+    }
+
+    kv_tokens.reserve(static_cast<size_t>(n_ctx));
+    LOGI("Context created successfully");
+    return true;
+}
+
+void Engine::build_sampler() {
+    // Create sampler chain (no grammar - just temp + top-p + dist)
+    llama_sampler_chain_params sparams = llama_sampler_chain_default_params();
+    sampler = llama_sampler_chain_init(sparams);
+
+    // Add temperature and top-p sampling
+    llama_sampler_chain_add(sampler, llama_sampler_init_temp(temperature));
+    llama_sampler_chain_add(sampler, llama_sampler_init_top_p(top_p, 1));
+
+    // Add grammar constraint if available
+    if (!grammar_text.empty()) {
+        auto grammar_sampler = llama_sampler_init_grammar(vocab, grammar_text.c_str(), "root");
+        if (grammar_sampler) {
+            llama_sampler_chain_add(sampler, grammar_sampler);
+            LOGI("Grammar sampler added to chain");
+        } else {
+            LOGW("Failed to create grammar sampler");
+        }
+    }
+    llama_sampler_chain_add(sampler, llama_sampler_init_dist(42));  // Random seed
+}
+
+void Engine::unload() noexcept {
+    if (sampler) {
+        llama_sampler_free(sampler);
+        sampler = nullptr;
+    }
+    if (ctx) {
+        llama_free(ctx);
+        ctx = nullptr;
+    }
+    context_heap_bytes = 0;
+    model = nullptr;
+    vocab = nullptr;
+    weights.reset();
+    chat_template.clear();
+    agent_layout.reset();
+    token_cache.reset(nullptr);
+    kv_tokens.clear();
+    checkpoints.clear();
+    needs_checkpoints = false;
+    applied_adapters.clear();
+    ++model_generation;
+}
+
+void Engine::release_context() noexcept {
+    const bool was_resident = ctx != nullptr;
+    unload();
+    if (was_resident) {
+        residency().unloaded(*this);
+    }
+}
+
+void Engine::reset() noexcept {
+    release_context();
+    grammar_text.clear();
+    model_path.clear();
+    released = false;
+    adapter_paths.clear();
+    stages.clear();
+    default_stage.clear();
+}
+
+void Engine::release_compute() noexcept {
+    if (ctx) {
+        llama_free(ctx);
+        ctx = nullptr;
+    }
+    context_heap_bytes = 0;
+    kv_tokens.clear();
+    checkpoints.clear();
+    applied_adapters.clear();
+}
+
+void Engine::set_profile_ops(bool enabled) noexcept {
+    if (enabled == profile_ops) {
+        return;
+    }
+    profile_ops = enabled;
+    release_context();
+}
+
+[[nodiscard]] ScreenStream& Engine::screen_stream() {
+    std::call_once(screen_stream_once_, [this] { screen_stream_ = std::make_unique<ScreenStream>(*this); });
+    return *screen_stream_;
+}
+
+[[nodiscard]] EngineHandle register_engine(std::shared_ptr<Engine> engine) {
+    std::lock_guard lock(g_engines_mutex);
+    const EngineHandle handle = g_next_handle++;
+    g_engines.emplace(handle, std::move(engine));
+    return handle;
+}
+
+[[nodiscard]] std::shared_ptr<Engine> find_engine(EngineHandle handle) {
+    std::lock_guard lock(g_engines_mutex);
+    auto it = g_engines.find(handle);
+    return it != g_engines.end() ? it->second : nullptr;
+}
+
+bool unregister_engine(EngineHandle handle) {
+    std::shared_ptr<Engine> engine;
+    {
+        std::lock_guard lock(g_engines_mutex);
+        auto it = g_engines.find(handle);
+        if (it == g_engines.end()) {
+            return false;
+        }
+        engine = std::move(it->second);
+        g_engines.erase(it);
+    }
+    // Destroyed here, outside the table lock, unless a call still holds it
+    return true;
+}
+
+[[nodiscard]] Engine& default_engine() {
+    static Engine engine;
+    return engine;
+}
+
+} // namespace sentinel_native
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "llama.h"
+#include "native_arena.hpp"
+#include "native_encoding.hpp"
+#include "native_kv.hpp"
+#include "native_prompt.hpp"
+
+namespace sentinel_native {
+
+class ScreenStream;
+struct RequestMetrics;
+
+// Lets string-keyed maps be probed with string_view / pmr::string keys
+struct StringHash {
+    using is_transparent = void;
+    [[nodiscard]] std::size_t operator()(std::string_view s) const noexcept {
+        return std::hash<std::string_view>{}(s);
+    }
+};
+
+template <typename V>
+using StringMap = std::unordered_map<std::string, V, StringHash, std::equal_to<>>;
+
+/**
+ * Weights, vocab and chat template of one GGUF file. Every engine that
+ * loads the same path shares one instance; the weights are freed when the
+ * last engine lets go.
+ */
+struct ModelWeights {
+    std::string path;
+    llama_model* model = nullptr;
+    const llama_vocab* vocab = nullptr;
+    std::string chat_template;
+    bool recurrent = false;  // recurrent or hybrid: prefix reuse needs checkpoints
+
+    ModelWeights() = default;
+    ModelWeights(const ModelWeights&) = delete;
+    ModelWeights& operator=(const ModelWeights&) = delete;
+    ~ModelWeights();
+
+    // LoRA adapter at `adapter_path`, loaded on first use and shared by every
+    // engine on these weights. Freed together with the model.
+    [[nodiscard]] llama_adapter_lora* adapter(const std::string& adapter_path);
+
+    // Bytes of adapter files loaded so far
+    [[nodiscard]] uint64_t adapter_bytes() const;
+
+private:
+    mutable std::mutex adapters_mutex_;
+    StringMap<llama_adapter_lora*> adapters_;
+    uint64_t adapter_bytes_ = 0;
+};
+
+struct AdapterBinding {
+    std::string name;
+    float scale = 1.0f;
+};
+
+// Load `path`, or share the weights another engine already holds
+[[nodiscard]] std::shared_ptr<ModelWeights> acquire_weights(const std::string& path);
+
+/**
+ * One inference engine: a context over shared weights plus everything
+ * derived from it. Engines are independent; each request locks only its
+ * own engine's mutex, so a router model and the main model can run side by
+ * side.
+ */
+struct Engine {
+    // Held exclusively for a whole request, shared for read-only queries
+    std::shared_mutex mutex;
+
+    std::shared_ptr<ModelWeights> weights;
+    llama_model* model = nullptr;        // weights->model, cached
+    const llama_vocab* vocab = nullptr;  // weights->vocab, cached
+    llama_context* ctx = nullptr;
+    llama_sampler* sampler = nullptr;
+    // Heap growth across context creation: KV cache plus compute and
+    // output buffers (see native_memory.hpp). 0 while no context exists.
+    uint64_t context_heap_bytes = 0;
+    std::string chat_template;
+    std::string grammar_text;
+
+    // Last loaded model, kept across eviction so the engine can reload
+    std::string model_path;
+    // Set by releaseModel; the residency manager may still keep it loaded
+    bool released = false;
+
+    // LoRA adapters by name, and the adapter set of each stage. Survive
+    // eviction; dropped when a different model is loaded.
+    StringMap<std::string> adapter_paths;
+    StringMap<std::vector<AdapterBinding>> stages;
+    std::string default_stage;  // used by requests that name no stage; "" = base model
+    // What is set on ctx right now; the KV cache was computed with it
+    std::vector<std::pair<llama_adapter_lora*, float>> applied_adapters;
+
+    float temperature = 0.3f;
+    float top_p = 0.9f;
+    int32_t max_tokens = 256;
+    int32_t n_ctx = 4096;
+    // n_ctx before memory pressure shrank the context, 0 if not shrunk
+    int32_t unshrunk_n_ctx = 0;
+    int32_t n_batch = 512;
+    // Decode and batch threads, 0 = llama.cpp's default. Applied at context creation.
+    int32_t n_threads = 0;
+    // Context produces mean-pooled embeddings instead of logits (see native_embedding.hpp)
+    bool embeddings = false;
+    // Context reports every graph node to g_op_profiler (see native_profiler.hpp)
+    bool profile_ops = false;
+    ScreenEncodingOptions screen_encoding;
+
+    // Tokens currently held in the KV cache for sequence 0, in position
+    // order. Lets prefill() decode only the part of a prompt not yet cached.
+    std::vector<llama_token> kv_tokens;
+
+    // Recurrent/hybrid models can't truncate their memory, so prefix reuse
+    // restores saved states instead (ascending by n_tokens)
+    bool needs_checkpoints = false;
+    std::vector<StateCheckpoint> checkpoints;
+
+    // Bumped on every reset so long-lived readers (screen streams) can tell
+    // their cached tokens belong to a previous model
+    uint64_t model_generation = 0;
+
+    // Breakdown of the request in flight (see native_metrics.hpp), else null
+    RequestMetrics* metrics = nullptr;
+
+    // Request-scoped scratch memory; outlives model reloads
+    RequestArena arena;
+
+    // Result of the last inferToBuffer call that did not fit the caller's
+    // buffer, held for copyLastResult. Replaced by the next inferToBuffer.
+    std::string pending_result;
+
+    // Tokenizer-dependent caches, dropped whenever the model changes
+    std::optional<PromptLayout> agent_layout;
+    TokenSpanCache token_cache;
+
+    Engine();
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
+    ~Engine();
+
+    /**
+     * Replace the loaded model with `path` (weights shared with other
+     * engines where possible) and create a fresh context and sampler. If
+     * `path` is still resident only the grammar and sampler are replaced.
+     * Caller must hold mutex exclusively.
+     */
+    [[nodiscard]] bool load(const std::string& path, const std::string& grammar);
+
+    // Resident: weights and context in memory
+    [[nodiscard]] constexpr bool is_ready() const noexcept {
+        return model != nullptr && ctx != nullptr && vocab != nullptr;
+    }
+
+    // Serviceable: resident, or evicted and reloadable on the next request
+    [[nodiscard]] bool is_available() const noexcept {
+        return !model_path.empty() && !released;
+    }
+
+    // Free context and sampler and drop the weights share, keeping
+    // model_path and settings for a reload. Used by eviction.
+    void unload() noexcept;
+
+    // unload() and forget the model entirely
+    void reset() noexcept;
+
+    // Memory pressure steps (see native_pressure.hpp). They leave the
+    // residency manager to the caller.
+
+    // Free the context (KV cache, compute and output buffers), keeping the
+    // weights and tokenizer caches; the next load() of the same path only
+    // rebuilds the context
+    void release_compute() noexcept;
+
+    // Toggle op profiling. The callback is fixed at context creation, so a
+    // change drops the context; the next request reloads it.
+    void set_profile_ops(bool enabled) noexcept;
+
+    // Incremental screen ingestion for this engine, started on first use
+    [[nodiscard]] ScreenStream& screen_stream();
+
+private:
+    void build_sampler();
+    [[nodiscard]] bool create_context();
+    void release_context() noexcept;
+
+    // Declared last: its worker must stop before the rest is torn down
+    std::once_flag screen_stream_once_;
+    std::unique_ptr<ScreenStream> screen_stream_;
+};
+
+using EngineHandle = int64_t;
+
+// Register an engine; returns a non-zero opaque handle for Kotlin
+[[nodiscard]] EngineHandle register_engine(std::shared_ptr<Engine> engine);
+
+// The engine behind a handle, or nullptr. The returned reference keeps the
+// engine alive for the call even if it is unregistered concurrently.
+[[nodiscard]] std::shared_ptr<Engine> find_engine(EngineHandle handle);
+
+// Drop a handle; the engine is destroyed once in-flight calls finish
+bool unregister_engine(EngineHandle handle);
+
+// Engine behind the handle-less NativeBridge calls (initModel, infer, ...)
+[[nodiscard]] Engine& default_engine();
+
+} // namespace sentinel_native
@@ -0,0 +1,117 @@
+#include "native_flight.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <format>
+#include <iterator>
+
+#include "native_metrics.hpp"
+
+namespace sentinel_native {
+
+FlightRecorder g_flight_recorder;
+
+namespace {
+
+[[nodiscard]] uint32_t saturate32(uint64_t v) noexcept {
+    return static_cast<uint32_t>(std::min<uint64_t>(v, UINT32_MAX));
+}
+
+[[nodiscard]] uint16_t saturate16(uint32_t v) noexcept {
+    return static_cast<uint16_t>(std::min<uint32_t>(v, UINT16_MAX));
+}
+
+} // namespace
+
+[[nodiscard]] uint16_t grammar_id(std::string_view grammar_text) noexcept {
+    if (grammar_text.empty()) {
+        return 0;
+    }
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : grammar_text) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    }
+    return static_cast<uint16_t>((hash ^ (hash >> 16) ^ (hash >> 32) ^ (hash >> 48)) | 1);
+}
+
+void FlightRecorder::record(const RequestMetrics& m) noexcept {
+    FlightRecord r{};
+    r.wall_ms = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    r.request_id = static_cast<uint32_t>(m.id);
+    r.total_us = saturate32(m.phase(MetricPhase::Total));
+    for (std::size_t i = 0; i < r.phase_us.size(); ++i) {
+        r.phase_us[i] = saturate32(m.phase(static_cast<MetricPhase>(i)));
+    }
+    r.system_tokens = saturate16(m.system_tokens);
+    r.screen_tokens = saturate16(m.screen_tokens);
+    r.query_tokens = saturate16(m.query_tokens);
+    r.prompt_tokens = saturate16(m.prompt_tokens);
+    r.reused_tokens = saturate16(m.reused_tokens);
+    r.output_tokens = saturate16(m.output_tokens);
+    r.grammar_id = m.grammar_id;
+    r.source = static_cast<uint8_t>(m.source);
+    r.error = static_cast<uint8_t>(m.error);
+    r.heap_peak_kib = saturate32(m.heap_peak_bytes / 1024);
+
+    const auto words = std::bit_cast<std::array<uint64_t, WORDS>>(r);
+    const uint64_t index = next_.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots_[index % FLIGHT_CAPACITY];
+
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 0; i < WORDS; ++i) {
+        slot.words[i].store(words[i], std::memory_order_relaxed);
+    }
+    slot.seq.store(index + 1, std::memory_order_release);
+}
+
+void FlightRecorder::clear() noexcept {
+    cleared_.store(next_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+[[nodiscard]] std::string FlightRecorder::to_json() const {
+    std::string out;
+    auto it = std::back_inserter(out);
+    out += R"({"records":[)";
+
+    const uint64_t end = next_.load(std::memory_order_acquire);
+    uint64_t begin = cleared_.load(std::memory_order_relaxed);
+    if (end > FLIGHT_CAPACITY && begin < end - FLIGHT_CAPACITY) {
+        begin = end - FLIGHT_CAPACITY;
+    }
+
+    bool first = true;
+    for (uint64_t index = begin; index < end; ++index) {
+        const Slot& slot = slots_[index % FLIGHT_CAPACITY];
+        const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+        std::array<uint64_t, WORDS> words;
+        for (std::size_t i = 0; i < WORDS; ++i) {
+            words[i] = slot.words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq != index + 1 || slot.seq.load(std::memory_order_relaxed) != seq) {
+            continue;
+        }
+
+        const auto r = std::bit_cast<FlightRecord>(words);
+        std::format_to(it, R"({}{{"wall_ms":{},"id":{},"source":"{}","error":"{}","grammar":{},"total_us":{})",
+            first ? "" : ",", r.wall_ms, r.request_id,
+            r.source < RESPONSE_SOURCES ? response_source_name(static_cast<ResponseSource>(r.source)) : "?",
+            r.error < static_cast<uint8_t>(RequestError::Count) ? request_error_name(static_cast<RequestError>(r.error)) : "?",
+            r.grammar_id, r.total_us);
+        for (std::size_t i = 0; i < r.phase_us.size(); ++i) {
+            std::format_to(it, R"(,"{}_us":{})", metric_phase_name(static_cast<MetricPhase>(i)), r.phase_us[i]);
+        }
+        std::format_to(it,
+            R"(,"tokens":{{"system":{},"screen":{},"query":{},"prompt":{},"reused":{},"output":{}}},"heap_peak_kib":{}}})",
+            r.system_tokens, r.screen_tokens, r.query_tokens, r.prompt_tokens, r.reused_tokens, r.output_tokens,
+            r.heap_peak_kib);
+        first = false;
+    }
+    out += "]}";
+    return out;
+}
+
+} // namespace sentinel_native
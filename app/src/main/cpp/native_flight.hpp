@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace sentinel_native {
+
+struct RequestMetrics;
+
+// Records kept; the oldest are overwritten beyond this
+inline constexpr std::size_t FLIGHT_CAPACITY = 512;
+
+/**
+ * One request, fixed width and content-free: no query, screen or output
+ * text, only timings, counts and codes. Times saturate at ~71 minutes,
+ * token counts at 65535.
+ */
+struct FlightRecord {
+    uint64_t wall_ms;      // end of request, Unix epoch
+    uint32_t request_id;   // low bits of RequestMetrics::id
+    uint32_t total_us;
+    std::array<uint32_t, 7> phase_us;  // sanitize, template, tokenize, prefill, decode, sample, grammar
+    uint16_t system_tokens;
+    uint16_t screen_tokens;
+    uint16_t query_tokens;
+    uint16_t prompt_tokens;
+    uint16_t reused_tokens;  // KV cache prefix hit
+    uint16_t output_tokens;
+    uint16_t grammar_id;
+    uint8_t source;          // ResponseSource: model or which cache answered
+    uint8_t error;           // RequestError
+    uint32_t heap_peak_kib;  // RequestMetrics::heap_peak_bytes
+};
+
+static_assert(sizeof(FlightRecord) == 64);
+static_assert(std::is_trivially_copyable_v<FlightRecord>);
+
+/**
+ * Always-on ring of the last FLIGHT_CAPACITY requests for field reports
+ * ("it was slow"), independent of logging and metrics.
+ *
+ * record() is wait-free: one fetch_add claims a slot, the record is stored
+ * as eight relaxed words and published through the slot's sequence number.
+ * No allocation or lock, well under a microsecond. dump() runs concurrently
+ * and skips slots that are mid-write.
+ */
+class FlightRecorder {
+public:
+    void record(const RequestMetrics& metrics) noexcept;
+
+    // Oldest first, as JSON
+    [[nodiscard]] std::string to_json() const;
+
+    void clear() noexcept;
+
+private:
+    static constexpr std::size_t WORDS = sizeof(FlightRecord) / sizeof(uint64_t);
+
+    struct Slot {
+        std::atomic<uint64_t> seq{0};  // index + 1 once written, 0 while writing
+        std::array<std::atomic<uint64_t>, WORDS> words{};
+    };
+
+    std::array<Slot, FLIGHT_CAPACITY> slots_;
+    std::atomic<uint64_t> next_{0};
+    std::atomic<uint64_t> cleared_{0};
+};
+
+extern FlightRecorder g_flight_recorder;
+
+// Short stable id of a grammar text for diagnostics, 0 for no grammar.
+// Hashes the text (a few KB), once per model-generated request.
+[[nodiscard]] uint16_t grammar_id(std::string_view grammar_text) noexcept;
+
+} // namespace sentinel_native
@@ -1,25 +1,26 @@
 #include "native_inference.hpp"
 
 #include <algorithm>
-#include <cstring>
 #include <exception>
-#include <memory>
 
+#include "native_kv.hpp"
+#include "native_flight.hpp"
 #include "native_logging.hpp"
+#include "native_metrics.hpp"
 #include "native_utils.hpp"
 
 namespace sentinel_native {
 
-[[nodiscard]] llama_sampler* create_sampler(const std::string& grammar_text) {
+[[nodiscard]] llama_sampler* create_sampler(const Engine& engine, const std::string& grammar_text) {
     llama_sampler_chain_params sparams = llama_sampler_chain_default_params();
     llama_sampler* sampler = llama_sampler_chain_init(sparams);
 
-    llama_sampler_chain_add(sampler, llama_sampler_init_temp(g_state.temperature));
-    llama_sampler_chain_add(sampler, llama_sampler_init_top_p(g_state.top_p, 1));
+    llama_sampler_chain_add(sampler, llama_sampler_init_temp(engine.temperature));
+    llama_sampler_chain_add(sampler, llama_sampler_init_top_p(engine.top_p, 1));
 
     if (!grammar_text.empty()) {
         auto grammar_sampler = llama_sampler_init_grammar(
-            g_state.vocab,
+            engine.vocab,
             grammar_text.c_str(),
             "root"
         );
@@ -34,100 +35,151 @@ namespace sentinel_native {
     return sampler;
 }
 
-[[nodiscard]] InferenceResult run_inference(const std::string& prompt, const std::string& grammar_text) {
-    if (!g_state.is_ready()) {
+[[nodiscard]] InferenceResult run_inference(
+    Engine& engine,
+    std::string_view prompt,
+    const std::string& grammar_text,
+    std::pmr::memory_resource* mr
+) {
+    if (!engine.is_ready()) {
+        note_error(engine, RequestError::NotLoaded);
+        return std::unexpected("Model not loaded");
+    }
+
+    std::pmr::vector<llama_token> tokens(mr);
+    {
+        PhaseTimer timer(engine, MetricPhase::Tokenize);
+        tokens = tokenize(engine.vocab, prompt, true, true, mr);
+    }
+    return run_inference_tokens(engine, tokens, grammar_text, mr);
+}
+
+[[nodiscard]] InferenceResult run_inference_tokens(
+    Engine& engine,
+    std::span<const llama_token> tokens,
+    const std::string& grammar_text,
+    std::pmr::memory_resource* mr,
+    std::size_t checkpoint_at
+) {
+    if (!engine.is_ready()) {
+        note_error(engine, RequestError::NotLoaded);
         return std::unexpected("Model not loaded");
     }
 
-    auto tokens = tokenize(prompt, true);
     if (tokens.empty()) {
+        note_error(engine, RequestError::Tokenize);
         return std::unexpected("Failed to tokenize prompt");
     }
 
     LOGD("Prompt tokens: %zu", tokens.size());
 
-    if (tokens.size() > static_cast<size_t>(g_state.n_ctx - g_state.max_tokens)) {
+    if (tokens.size() > static_cast<size_t>(engine.n_ctx - engine.max_tokens)) {
+        note_error(engine, RequestError::PromptTooLong);
         return std::unexpected("Prompt too long for context window");
     }
 
-    auto mem = llama_get_memory(g_state.ctx);
-    if (mem) {
-        llama_memory_clear(mem, false);
+    std::expected<std::size_t, std::string> prefilled;
+    {
+        PhaseTimer timer(engine, MetricPhase::Prefill);
+        prefilled = prefill(engine, tokens, checkpoint_at);
     }
-
-    llama_batch batch = llama_batch_get_one(tokens.data(), static_cast<int>(tokens.size()));
-
-    if (llama_decode(g_state.ctx, batch) != 0) {
-        return std::unexpected("Failed to process prompt");
+    if (!prefilled) {
+        note_error(engine, RequestError::Prefill);
+        return std::unexpected(prefilled.error());
+    }
+    note_heap(engine);
+    if (engine.metrics) {
+        engine.metrics->prompt_tokens = static_cast<uint32_t>(tokens.size());
+        engine.metrics->reused_tokens = static_cast<uint32_t>(*prefilled);
+        engine.metrics->grammar_id = grammar_id(grammar_text);
     }
+    LOGD("Prompt prefix reused from KV cache: %zu tokens", *prefilled);
 
-    const size_t buf_capacity = static_cast<size_t>(g_state.max_tokens) * 8 + 1;
-    auto response_buf = std::unique_ptr<char[]>(new char[buf_capacity]);
-    size_t response_len = 0;
+    const size_t buf_capacity = static_cast<size_t>(engine.max_tokens) * 8;
+    std::pmr::string response(mr);
+    response.reserve(buf_capacity);
 
-    llama_sampler* sampler = create_sampler(grammar_text);
+    llama_sampler* sampler = create_sampler(engine, grammar_text);
     if (!sampler) {
+        note_error(engine, RequestError::Sampler);
         return std::unexpected("Failed to create sampler");
     }
 
     // Wrap sampling loop in try-catch to handle grammar parser errors
     try {
-        for (int i = 0; i < g_state.max_tokens; ++i) {
+        for (int i = 0; i < engine.max_tokens; ++i) {
             llama_token new_token;
             try {
-                new_token = llama_sampler_sample(sampler, g_state.ctx, -1);
+                PhaseTimer timer(engine, MetricPhase::Sample);
+                new_token = llama_sampler_sample(sampler, engine.ctx, -1);
             } catch (const std::exception& e) {
                 LOGE("Sampler error during sample: %s", e.what());
+                note_error(engine, RequestError::Sampler);
                 llama_sampler_free(sampler);
                 return std::unexpected(std::string("Sampler error: ") + e.what());
             }
+            note_first_token(engine);
 
-            if (llama_vocab_is_eog(g_state.vocab, new_token)) {
+            if (llama_vocab_is_eog(engine.vocab, new_token)) {
                 LOGD("EOS token at position %d", i);
                 break;
             }
 
             char buf[128];
-            int n = llama_token_to_piece(g_state.vocab, new_token, buf, sizeof(buf), 0, true);
+            int n = llama_token_to_piece(engine.vocab, new_token, buf, sizeof(buf), 0, true);
             if (n > 0) {
-                const size_t copy_len = std::min(static_cast<size_t>(n), buf_capacity - response_len - 1);
-                if (copy_len > 0) {
-                    std::memcpy(response_buf.get() + response_len, buf, copy_len);
-                    response_len += copy_len;
-                }
+                const size_t copy_len = std::min(static_cast<size_t>(n), buf_capacity - response.size());
+                response.append(buf, copy_len);
             }
 
             // This can throw if grammar parser encounters invalid state
             try {
+                PhaseTimer timer(engine, MetricPhase::Grammar);
                 llama_sampler_accept(sampler, new_token);
             } catch (const std::exception& e) {
                 LOGE("Sampler error during accept: %s", e.what());
+                note_error(engine, RequestError::Sampler);
                 llama_sampler_free(sampler);
                 return std::unexpected(std::string("Sampler error: ") + e.what());
             }
 
-            batch = llama_batch_get_one(&new_token, 1);
+            if (engine.metrics) {
+                ++engine.metrics->output_tokens;
+            }
+
+            llama_batch batch = llama_batch_get_one(&new_token, 1);
 
-            if (llama_decode(g_state.ctx, batch) != 0) {
+            int decoded;
+            {
+                PhaseTimer timer(engine, MetricPhase::Decode);
+                decoded = llama_decode(engine.ctx, batch);
+            }
+            if (decoded != 0) {
                 LOGW("Decode failed at token %d", i);
+                note_error(engine, RequestError::Decode);
+                invalidate_kv(engine);
                 break;
             }
+            engine.kv_tokens.push_back(new_token);
         }
     } catch (const std::exception& e) {
         LOGE("Unexpected error during inference: %s", e.what());
+        note_error(engine, RequestError::Other);
         llama_sampler_free(sampler);
         return std::unexpected(std::string("Inference error: ") + e.what());
     } catch (...) {
         LOGE("Unknown error during inference");
+        note_error(engine, RequestError::Other);
         llama_sampler_free(sampler);
         return std::unexpected("Unknown inference error");
     }
 
-    response_buf.get()[response_len] = '\0';
+    // Before the grammar stacks are freed
+    note_heap(engine);
     llama_sampler_free(sampler);
 
-    LOGD("Generated %zu characters", response_len);
-    return std::string(response_buf.get(), response_len);
+    LOGD("Generated %zu characters", response.size());
+    return response;
 }
 
 } // namespace sentinel_native
@@ -1,16 +1,36 @@
 #pragma once
 
 #include <expected>
+#include <memory_resource>
+#include <span>
 #include <string>
+#include <string_view>
 
 #include "llama.h"
-#include "native_state.hpp"
+#include "native_engine.hpp"
 
 namespace sentinel_native {
 
-using InferenceResult = std::expected<std::string, std::string>;
+// Successful output lives in the caller's memory resource; errors are rare
+// enough to stay on the heap.
+using InferenceResult = std::expected<std::pmr::string, std::string>;
 
-[[nodiscard]] llama_sampler* create_sampler(const std::string& grammar_text);
-[[nodiscard]] InferenceResult run_inference(const std::string& prompt, const std::string& grammar_text);
+[[nodiscard]] llama_sampler* create_sampler(const Engine& engine, const std::string& grammar_text);
+// Decode an already tokenized prompt (BOS included) and sample a response.
+// checkpoint_at is forwarded to prefill() (e.g. the end of the screen).
+[[nodiscard]] InferenceResult run_inference_tokens(
+    Engine& engine,
+    std::span<const llama_token> tokens,
+    const std::string& grammar_text,
+    std::pmr::memory_resource* mr = std::pmr::get_default_resource(),
+    std::size_t checkpoint_at = 0
+);
+
+[[nodiscard]] InferenceResult run_inference(
+    Engine& engine,
+    std::string_view prompt,
+    const std::string& grammar_text,
+    std::pmr::memory_resource* mr = std::pmr::get_default_resource()
+);
 
 } // namespace sentinel_native
@@ -0,0 +1,68 @@
+#include "native_jni.hpp"
+
+#include <cstring>
+
+#include "native_logging.hpp"
+#include "native_utils.hpp"
+
+namespace sentinel_native {
+
+[[nodiscard]] std::pmr::string jstring_to_string(
+    JNIEnv* env,
+    jstring jstr,
+    std::pmr::memory_resource* mr
+) {
+    std::pmr::string result(mr);
+    if (!jstr) return result;
+
+    const jsize len = env->GetStringLength(jstr);
+    const jchar* chars = env->GetStringCritical(jstr, nullptr);
+    if (!chars) return result;
+
+    // No JNI calls allowed until the critical section is released
+    utf16_to_utf8(reinterpret_cast<const char16_t*>(chars), static_cast<std::size_t>(len), result);
+    env->ReleaseStringCritical(jstr, chars);
+    return result;
+}
+
+[[nodiscard]] jstring string_to_jstring(
+    JNIEnv* env,
+    std::string_view str,
+    std::pmr::memory_resource* mr
+) {
+    std::pmr::u16string utf16(mr);
+    utf8_to_utf16(str, utf16);
+    return env->NewString(reinterpret_cast<const jchar*>(utf16.data()), static_cast<jsize>(utf16.size()));
+}
+
+[[nodiscard]] jint write_utf8_to_buffer(JNIEnv* env, jobject buffer, std::string_view str) {
+    auto* dst = buffer ? static_cast<char*>(env->GetDirectBufferAddress(buffer)) : nullptr;
+    const jlong capacity = buffer ? env->GetDirectBufferCapacity(buffer) : -1;
+    if (!dst || capacity < 0) {
+        LOGE("Output buffer is not a direct ByteBuffer");
+        return OUTPUT_INVALID_BUFFER;
+    }
+
+    const auto needed = static_cast<jlong>(str.size());
+    if (needed > capacity) {
+        return static_cast<jint>(-needed);
+    }
+
+    std::memcpy(dst, str.data(), str.size());
+    return static_cast<jint>(needed);
+}
+
+[[nodiscard]] std::optional<std::span<const std::byte>> direct_buffer_bytes(
+    JNIEnv* env,
+    jobject buffer,
+    jint length
+) {
+    const auto* data = buffer ? static_cast<const std::byte*>(env->GetDirectBufferAddress(buffer)) : nullptr;
+    const jlong capacity = buffer ? env->GetDirectBufferCapacity(buffer) : -1;
+    if (!data || length < 0 || length > capacity) {
+        return std::nullopt;
+    }
+    return std::span<const std::byte>(data, static_cast<std::size_t>(length));
+}
+
+} // namespace sentinel_native
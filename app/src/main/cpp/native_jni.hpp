@@ -0,0 +1,47 @@
+#pragma once
+
+#include <jni.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace sentinel_native {
+
+// Marshalling for the JNI shell (native-lib.cpp). Only the Android library
+// links this; sentinel_core stays free of JNI.
+
+// Returned by write_utf8_to_buffer when the target is not a direct buffer
+inline constexpr jint OUTPUT_INVALID_BUFFER = INT32_MIN;
+
+// Conversions allocate from mr; pass the request arena on the hot path
+[[nodiscard]] std::pmr::string jstring_to_string(
+    JNIEnv* env,
+    jstring jstr,
+    std::pmr::memory_resource* mr = std::pmr::get_default_resource()
+);
+[[nodiscard]] jstring string_to_jstring(
+    JNIEnv* env,
+    std::string_view str,
+    std::pmr::memory_resource* mr = std::pmr::get_default_resource()
+);
+
+/**
+ * Copy raw UTF-8 into a caller-provided direct ByteBuffer.
+ * @return bytes written, -(bytes required) if the buffer is too small,
+ *         or OUTPUT_INVALID_BUFFER if the buffer is not direct
+ */
+[[nodiscard]] jint write_utf8_to_buffer(JNIEnv* env, jobject buffer, std::string_view str);
+
+// First `length` bytes of a direct ByteBuffer; nothing if the buffer is
+// not direct or shorter than `length`
+[[nodiscard]] std::optional<std::span<const std::byte>> direct_buffer_bytes(
+    JNIEnv* env,
+    jobject buffer,
+    jint length
+);
+
+} // namespace sentinel_native
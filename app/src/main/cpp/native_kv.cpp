@@ -0,0 +1,171 @@
+#include "native_kv.hpp"
+
+#include <algorithm>
+
+#include "native_logging.hpp"
+#include "native_engine.hpp"
+#include "native_metrics.hpp"
+
+namespace sentinel_native {
+
+namespace {
+
+// Checkpoints past n_tokens describe a history that is about to be replaced
+void drop_checkpoints_after(Engine& engine, std::size_t n_tokens) {
+    auto& cps = engine.checkpoints;
+    std::erase_if(cps, [n_tokens](const StateCheckpoint& cp) { return cp.n_tokens > n_tokens; });
+}
+
+void save_checkpoint(Engine& engine) {
+    const std::size_t n_tokens = engine.kv_tokens.size();
+    auto& cps = engine.checkpoints;
+    if (n_tokens == 0 || (!cps.empty() && cps.back().n_tokens >= n_tokens)) {
+        return;
+    }
+
+    StateCheckpoint cp;
+    if (cps.size() >= MAX_CHECKPOINTS) {
+        // Recycle the oldest buffer
+        cp = std::move(cps.front());
+        cps.erase(cps.begin());
+    }
+
+    const std::size_t size = llama_state_seq_get_size(engine.ctx, 0);
+    cp.data.resize(size);
+    if (llama_state_seq_get_data(engine.ctx, cp.data.data(), size, 0) != size) {
+        LOGW("Failed to save state checkpoint at %zu tokens", n_tokens);
+        return;
+    }
+    cp.n_tokens = n_tokens;
+    cps.push_back(std::move(cp));
+}
+
+// Roll back to the newest checkpoint at or before `limit`. Returns the
+// restored length, or 0 if none could be restored.
+[[nodiscard]] std::size_t restore_checkpoint(Engine& engine, std::size_t limit) {
+    auto& cps = engine.checkpoints;
+    auto it = std::find_if(cps.rbegin(), cps.rend(),
+        [limit](const StateCheckpoint& cp) { return cp.n_tokens <= limit; });
+    if (it == cps.rend()) {
+        return 0;
+    }
+
+    auto mem = llama_get_memory(engine.ctx);
+    llama_memory_seq_rm(mem, 0, -1, -1);
+    if (llama_state_seq_set_data(engine.ctx, it->data.data(), it->data.size(), 0) == 0) {
+        LOGW("Failed to restore state checkpoint at %zu tokens", it->n_tokens);
+        return 0;
+    }
+    return it->n_tokens;
+}
+
+} // namespace
+
+void invalidate_kv(Engine& engine) noexcept {
+    if (auto mem = llama_get_memory(engine.ctx)) {
+        llama_memory_clear(mem, false);
+    }
+    engine.kv_tokens.clear();
+    engine.checkpoints.clear();
+}
+
+[[nodiscard]] std::expected<std::size_t, std::string> prefill(
+    Engine& engine,
+    std::span<const llama_token> tokens,
+    std::size_t checkpoint_at
+) {
+    if (tokens.empty()) {
+        return std::unexpected("Nothing to prefill");
+    }
+
+    auto& cached = engine.kv_tokens;
+
+    const auto mismatch = std::mismatch(cached.begin(), cached.end(), tokens.begin(), tokens.end());
+    // Sampling needs fresh logits for the last prompt token, so at least
+    // one token is always decoded
+    std::size_t keep = std::min(
+        static_cast<std::size_t>(mismatch.first - cached.begin()),
+        tokens.size() - 1
+    );
+
+    if (keep < cached.size()) {
+        auto mem = llama_get_memory(engine.ctx);
+        if (keep > 0 && !engine.needs_checkpoints && mem &&
+            llama_memory_seq_rm(mem, 0, static_cast<llama_pos>(keep), -1)) {
+            cached.resize(keep);
+        } else if (keep > 0 && engine.needs_checkpoints && (keep = restore_checkpoint(engine, keep)) > 0) {
+            cached.resize(keep);
+        } else {
+            keep = 0;
+        }
+        drop_checkpoints_after(engine, keep);
+    }
+
+    if (keep == 0) {
+        invalidate_kv(engine);
+    }
+
+    auto appended = prefill_append(engine, tokens.subspan(keep), checkpoint_at);
+    if (!appended) {
+        return std::unexpected(appended.error());
+    }
+    return keep;
+}
+
+[[nodiscard]] std::expected<void, std::string> prefill_append(
+    Engine& engine,
+    std::span<const llama_token> tokens,
+    std::size_t checkpoint_at
+) {
+    auto& cached = engine.kv_tokens;
+    if (cached.size() + tokens.size() > static_cast<size_t>(engine.n_ctx)) {
+        return std::unexpected("Prompt too long for context window");
+    }
+
+    const auto chunk = static_cast<std::size_t>(engine.n_batch);
+    std::size_t off = 0;
+    while (off < tokens.size()) {
+        // llama_decode rejects batches larger than n_batch
+        std::size_t n = std::min(chunk, tokens.size() - off);
+
+        // Split the chunk so it ends exactly on the next checkpoint position
+        std::size_t next_cp = 0;
+        if (engine.needs_checkpoints) {
+            const std::size_t pos = cached.size();
+            next_cp = (pos / CHECKPOINT_INTERVAL + 1) * CHECKPOINT_INTERVAL;
+            if (checkpoint_at > pos && checkpoint_at < next_cp) {
+                next_cp = checkpoint_at;
+            }
+            if (next_cp - pos <= n) {
+                n = next_cp - pos;
+            } else {
+                next_cp = 0;
+            }
+        }
+
+        // llama_batch_get_one takes a mutable pointer but only reads the tokens
+        llama_batch batch = llama_batch_get_one(
+            const_cast<llama_token*>(tokens.data() + off),
+            static_cast<int32_t>(n)
+        );
+
+        int decoded;
+        {
+            TraceSpan span("prefill_chunk", current_request_id(engine), static_cast<int64_t>(n));
+            decoded = llama_decode(engine.ctx, batch);
+        }
+        if (decoded != 0) {
+            invalidate_kv(engine);
+            return std::unexpected("Failed to process prompt");
+        }
+        cached.insert(cached.end(), tokens.begin() + off, tokens.begin() + off + n);
+        off += n;
+
+        if (next_cp != 0) {
+            save_checkpoint(engine);
+        }
+    }
+    return {};
+}
+
+} // namespace sentinel_native
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "llama.h"
+
+namespace sentinel_native {
+
+struct Engine;
+
+/**
+ * Saved sequence state after the first n_tokens of Engine::kv_tokens.
+ *
+ * Recurrent layers (Jamba's Mamba blocks) cannot drop their last N
+ * positions, so for recurrent and hybrid models prefix reuse restores one
+ * of these instead of calling llama_memory_seq_rm.
+ */
+struct StateCheckpoint {
+    std::size_t n_tokens = 0;
+    std::vector<uint8_t> data;
+};
+
+// Prompt positions between automatic checkpoints
+inline constexpr std::size_t CHECKPOINT_INTERVAL = 256;
+// Oldest checkpoints are evicted beyond this (each holds a full recurrent state)
+inline constexpr std::size_t MAX_CHECKPOINTS = 6;
+
+/**
+ * Make the KV cache hold exactly `tokens`, decoding only what differs from
+ * engine.kv_tokens: the longest common prefix is kept and decoding resumes
+ * at the first changed token. The last token is always decoded so its
+ * logits are available for sampling.
+ *
+ * On models that need checkpoints, one is saved at checkpoint_at (if
+ * non-zero) and every CHECKPOINT_INTERVAL tokens.
+ *
+ * @return number of leading tokens reused from the cache
+ */
+[[nodiscard]] std::expected<std::size_t, std::string> prefill(
+    Engine& engine,
+    std::span<const llama_token> tokens,
+    std::size_t checkpoint_at = 0
+);
+
+// Decode `tokens` after whatever the KV cache currently holds, in n_batch chunks
+[[nodiscard]] std::expected<void, std::string> prefill_append(
+    Engine& engine,
+    std::span<const llama_token> tokens,
+    std::size_t checkpoint_at = 0
+);
+
+// Drop the KV cache contents, their token record and all checkpoints
+void invalidate_kv(Engine& engine) noexcept;
+
+} // namespace sentinel_native
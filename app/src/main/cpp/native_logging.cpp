@@ -0,0 +1,206 @@
+#include "native_logging.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#if defined(__ANDROID__)
+#include <android/log.h>
+#endif
+
+namespace sentinel_native {
+
+namespace {
+
+constexpr const char* LOG_TAG = "SentinelNative";
+
+// Longer lines are truncated
+constexpr std::size_t LOG_LINE_MAX = 500;
+// Power of two
+constexpr std::size_t LOG_QUEUE_CAPACITY = 256;
+
+struct LogLine {
+    LogLevel level;
+    uint16_t length;
+    char text[LOG_LINE_MAX];
+};
+
+/**
+ * Bounded multi-producer queue (Vyukov): each cell's sequence number says
+ * whether it is free for position p (== p) or holds the line for p
+ * (== p + 1). Producers claim positions with a CAS on head_; the single
+ * consumer (the sink thread) owns tail_.
+ */
+class LogSink {
+public:
+    ~LogSink() {
+        if (worker_.joinable()) {
+            worker_.request_stop();
+            wake();
+            worker_.join();
+        }
+    }
+
+    [[nodiscard]] bool push(LogLevel level, const char* text, std::size_t length) noexcept {
+        std::call_once(start_once_, [this] {
+            for (std::size_t i = 0; i < LOG_QUEUE_CAPACITY; ++i) {
+                cells_[i].seq.store(i, std::memory_order_relaxed);
+            }
+            worker_ = std::jthread([this](std::stop_token stop) { run(stop); });
+        });
+
+        uint64_t pos = head_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & (LOG_QUEUE_CAPACITY - 1)];
+            const uint64_t seq = cell->seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<int64_t>(seq - pos);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->line.level = level;
+        cell->line.length = static_cast<uint16_t>(length);
+        std::memcpy(cell->line.text, text, length);
+        // seq_cst pairs with the sink's re-check before it sleeps
+        cell->seq.store(pos + 1, std::memory_order_seq_cst);
+        wake();
+        return true;
+    }
+
+    [[nodiscard]] LogBackend backend() const noexcept { return backend_.load(std::memory_order_acquire); }
+    void set_backend(LogBackend backend) noexcept { backend_.store(backend, std::memory_order_release); }
+
+    void flush() noexcept {
+        const uint64_t target = head_.load(std::memory_order_acquire);
+        while (worker_.joinable() && drained_.load(std::memory_order_acquire) < target) {
+            wake();
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    struct Cell {
+        std::atomic<uint64_t> seq{0};
+        LogLine line;
+    };
+
+    // A syscall only when the sink thread is actually asleep
+    void wake() noexcept {
+        if (sleeping_.exchange(false)) {
+            sleeping_.notify_one();
+        }
+    }
+
+    [[nodiscard]] bool pop(LogLine& out) noexcept {
+        Cell& cell = cells_[tail_ & (LOG_QUEUE_CAPACITY - 1)];
+        if (cell.seq.load(std::memory_order_acquire) != tail_ + 1) {
+            return false;
+        }
+        out.level = cell.line.level;
+        out.length = cell.line.length;
+        std::memcpy(out.text, cell.line.text, out.length);
+        cell.seq.store(tail_ + LOG_QUEUE_CAPACITY, std::memory_order_release);
+        ++tail_;
+        return true;
+    }
+
+    void run(std::stop_token stop) {
+        LogLine line;
+        while (true) {
+            while (pop(line)) {
+                backend()(line.level, {line.text, line.length});
+                drained_.store(tail_, std::memory_order_release);
+            }
+            if (const uint64_t dropped = dropped_.exchange(0, std::memory_order_relaxed)) {
+                char note[64];
+                const int n = std::snprintf(note, sizeof(note), "%llu log lines dropped (queue full)",
+                                            static_cast<unsigned long long>(dropped));
+                backend()(LogLevel::Warn, {note, static_cast<std::size_t>(n)});
+            }
+            if (stop.stop_requested()) {
+                return;
+            }
+
+            // Re-check after announcing sleep: a producer that pushed before
+            // seeing the flag has its line visible to the next pop
+            sleeping_.store(true);
+            if (cells_[tail_ & (LOG_QUEUE_CAPACITY - 1)].seq.load(std::memory_order_seq_cst) == tail_ + 1 ||
+                stop.stop_requested()) {
+                sleeping_.store(false);
+                continue;
+            }
+            sleeping_.wait(true);
+        }
+    }
+
+    std::atomic<LogBackend> backend_{&default_log_backend};
+    std::array<Cell, LOG_QUEUE_CAPACITY> cells_;
+    std::atomic<uint64_t> head_{0};
+    uint64_t tail_ = 0;  // sink thread only
+    std::atomic<uint64_t> drained_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<bool> sleeping_{false};
+    std::once_flag start_once_;
+    std::jthread worker_;  // declared last: stops before the queue is destroyed
+};
+
+[[nodiscard]] LogSink& sink() {
+    static LogSink instance;
+    return instance;
+}
+
+} // namespace
+
+void default_log_backend(LogLevel level, std::string_view message) {
+#if defined(__ANDROID__)
+    static constexpr int PRIORITIES[] = {ANDROID_LOG_DEBUG, ANDROID_LOG_INFO, ANDROID_LOG_WARN, ANDROID_LOG_ERROR};
+    __android_log_print(PRIORITIES[static_cast<int>(level)], LOG_TAG, "%.*s",
+                        static_cast<int>(message.size()), message.data());
+#else
+    static constexpr char LETTERS[] = {'D', 'I', 'W', 'E'};
+    std::fprintf(stderr, "%c %s: %.*s\n", LETTERS[static_cast<int>(level)], LOG_TAG,
+                 static_cast<int>(message.size()), message.data());
+#endif
+}
+
+void set_log_backend(LogBackend backend) noexcept {
+    sink().set_backend(backend ? backend : &default_log_backend);
+}
+
+void log_write(LogLevel level, const char* format, ...) noexcept {
+    char text[LOG_LINE_MAX];
+    va_list args;
+    va_start(args, format);
+    const int n = std::vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (n < 0) {
+        return;
+    }
+    const std::size_t length = std::min(static_cast<std::size_t>(n), sizeof(text) - 1);
+
+    if (level == LogLevel::Error) {
+        sink().backend()(level, {text, length});
+        return;
+    }
+    (void)sink().push(level, text, length);
+}
+
+void log_flush() noexcept {
+    sink().flush();
+}
+
+} // namespace sentinel_native
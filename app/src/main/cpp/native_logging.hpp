@@ -1,9 +1,74 @@
 #pragma once
 
-#include <android/log.h>
+#include <cstdint>
+#include <string_view>
 
-#define LOG_TAG "SentinelNative"
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
-#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
-#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+// Levels below SENTINEL_LOG_LEVEL compile to nothing: arguments are still
+// type-checked but never evaluated. Set from CMake; defaults to warnings in
+// NDEBUG builds so request content (queries, results) is never logged.
+#define SENTINEL_LOG_LEVEL_DEBUG 0
+#define SENTINEL_LOG_LEVEL_INFO 1
+#define SENTINEL_LOG_LEVEL_WARN 2
+#define SENTINEL_LOG_LEVEL_ERROR 3
+#define SENTINEL_LOG_LEVEL_OFF 4
+
+#ifndef SENTINEL_LOG_LEVEL
+#ifdef NDEBUG
+#define SENTINEL_LOG_LEVEL SENTINEL_LOG_LEVEL_WARN
+#else
+#define SENTINEL_LOG_LEVEL SENTINEL_LOG_LEVEL_DEBUG
+#endif
+#endif
+
+namespace sentinel_native {
+
+enum class LogLevel : uint8_t { Debug, Info, Warn, Error };
+
+// Where drained lines go; called from the sink thread only (errors: caller's thread)
+using LogBackend = void (*)(LogLevel level, std::string_view message);
+
+// logcat on Android, stderr elsewhere
+void default_log_backend(LogLevel level, std::string_view message);
+
+void set_log_backend(LogBackend backend) noexcept;
+
+/**
+ * Format a line and hand it to the async sink: a bounded lock-free queue
+ * drained by a background thread into the backend, so the caller never
+ * blocks on logcat. A full queue drops the line (the drop count is logged
+ * once the queue drains). Errors bypass the queue and are written
+ * synchronously, so they survive a crash right after.
+ */
+[[gnu::format(printf, 2, 3)]]
+void log_write(LogLevel level, const char* format, ...) noexcept;
+
+// Wait until everything queued so far reached the backend
+void log_flush() noexcept;
+
+} // namespace sentinel_native
+
+#define SENTINEL_LOG_DISCARD(...) do { if (false) ::sentinel_native::log_write(__VA_ARGS__); } while (0)
+
+#if SENTINEL_LOG_LEVEL <= SENTINEL_LOG_LEVEL_DEBUG
+#define LOGD(...) ::sentinel_native::log_write(::sentinel_native::LogLevel::Debug, __VA_ARGS__)
+#else
+#define LOGD(...) SENTINEL_LOG_DISCARD(::sentinel_native::LogLevel::Debug, __VA_ARGS__)
+#endif
+
+#if SENTINEL_LOG_LEVEL <= SENTINEL_LOG_LEVEL_INFO
+#define LOGI(...) ::sentinel_native::log_write(::sentinel_native::LogLevel::Info, __VA_ARGS__)
+#else
+#define LOGI(...) SENTINEL_LOG_DISCARD(::sentinel_native::LogLevel::Info, __VA_ARGS__)
+#endif
+
+#if SENTINEL_LOG_LEVEL <= SENTINEL_LOG_LEVEL_WARN
+#define LOGW(...) ::sentinel_native::log_write(::sentinel_native::LogLevel::Warn, __VA_ARGS__)
+#else
+#define LOGW(...) SENTINEL_LOG_DISCARD(::sentinel_native::LogLevel::Warn, __VA_ARGS__)
+#endif
+
+#if SENTINEL_LOG_LEVEL <= SENTINEL_LOG_LEVEL_ERROR
+#define LOGE(...) ::sentinel_native::log_write(::sentinel_native::LogLevel::Error, __VA_ARGS__)
+#else
+#define LOGE(...) SENTINEL_LOG_DISCARD(::sentinel_native::LogLevel::Error, __VA_ARGS__)
+#endif
@@ -0,0 +1,150 @@
+#include "native_macro.hpp"
+
+#include <algorithm>
+
+#include "native_logging.hpp"
+#include "native_utils.hpp"
+
+namespace sentinel_native {
+
+MacroCache g_macro_cache;
+
+[[nodiscard]] bool is_replayable(std::string_view action_json) noexcept {
+    return action_json.starts_with('{') &&
+        action_json.find(R"("NONE")") == std::string_view::npos &&
+        action_json.find(R"("none")") == std::string_view::npos;
+}
+
+void MacroCache::sync_task_locked(std::string_view query) {
+    normalize_text(query, scratch_);
+    if (!task_ || task_->query != scratch_) {
+        task_.emplace();
+        task_->query = scratch_;
+    }
+}
+
+void MacroCache::begin_task(std::string_view query) {
+    std::lock_guard lock(mutex_);
+    task_.reset();
+    sync_task_locked(query);
+}
+
+void MacroCache::end_task(bool success) {
+    std::lock_guard lock(mutex_);
+    if (!task_) {
+        return;
+    }
+
+    if (success && !task_->steps.empty()) {
+        auto& macro = macros_[task_->query];
+        macro.steps = std::move(task_->steps);
+        macro.last_used = ++tick_;
+        ++recorded_;
+        LOGD("Macro stored: %s (%zu steps)", task_->query.c_str(), macro.steps.size());
+        evict_locked();
+    } else if (!success && task_->replayed) {
+        // The replay led somewhere wrong; let the model redo it next time
+        macros_.erase(task_->query);
+        ++failures_;
+    }
+    task_.reset();
+}
+
+[[nodiscard]] std::optional<std::string> MacroCache::lookup(std::string_view query, uint64_t signature) {
+    std::lock_guard lock(mutex_);
+    if (!enabled_) {
+        return std::nullopt;
+    }
+    ++lookups_;
+    sync_task_locked(query);
+
+    auto it = macros_.find(task_->query);
+    if (it == macros_.end() || task_->step >= it->second.steps.size()) {
+        return std::nullopt;
+    }
+
+    const Step& step = it->second.steps[task_->step];
+    if (step.signature != signature) {
+        LOGD("Macro drifted at step %zu: %s", task_->step, task_->query.c_str());
+        macros_.erase(it);
+        ++drifts_;
+        return std::nullopt;
+    }
+
+    it->second.last_used = ++tick_;
+    task_->steps.push_back(step);
+    task_->replayed = true;
+    ++task_->step;
+    ++hits_;
+    return step.action_json;
+}
+
+void MacroCache::record(std::string_view query, uint64_t signature, std::string_view action_json) {
+    std::lock_guard lock(mutex_);
+    if (!enabled_ || !is_replayable(action_json)) {
+        return;
+    }
+    sync_task_locked(query);
+    if (task_->steps.size() >= MACRO_MAX_STEPS) {
+        return;
+    }
+    task_->steps.push_back({signature, std::string(action_json)});
+    ++task_->step;
+}
+
+void MacroCache::set_enabled(bool enabled) {
+    std::lock_guard lock(mutex_);
+    enabled_ = enabled;
+    if (!enabled) {
+        task_.reset();
+    }
+}
+
+void MacroCache::clear() {
+    std::lock_guard lock(mutex_);
+    macros_.clear();
+    task_.reset();
+}
+
+void MacroCache::evict_locked() {
+    while (macros_.size() > MACRO_CAPACITY) {
+        auto oldest = std::min_element(macros_.begin(), macros_.end(), [](const auto& a, const auto& b) {
+            return a.second.last_used < b.second.last_used;
+        });
+        macros_.erase(oldest);
+    }
+}
+
+[[nodiscard]] MacroStats MacroCache::stats() {
+    std::lock_guard lock(mutex_);
+    return {
+        .lookups = lookups_,
+        .hits = hits_,
+        .drifts = drifts_,
+        .failures = failures_,
+        .recorded = recorded_,
+        .size = macros_.size(),
+    };
+}
+
+[[nodiscard]] std::size_t MacroCache::memory_bytes() {
+    const auto steps_bytes = [](const std::vector<Step>& steps) {
+        std::size_t bytes = steps.capacity() * sizeof(Step);
+        for (const Step& step : steps) {
+            bytes += step.action_json.capacity();
+        }
+        return bytes;
+    };
+
+    std::lock_guard lock(mutex_);
+    std::size_t bytes = scratch_.capacity();
+    for (const auto& [query, macro] : macros_) {
+        bytes += sizeof(std::pair<const std::string, Macro>) + query.capacity() + steps_bytes(macro.steps);
+    }
+    if (task_) {
+        bytes += task_->query.capacity() + steps_bytes(task_->steps);
+    }
+    return bytes;
+}
+
+} // namespace sentinel_native
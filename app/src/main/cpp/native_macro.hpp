@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "native_engine.hpp"
+
+namespace sentinel_native {
+
+// Macros kept; the least recently used is dropped beyond this
+inline constexpr std::size_t MACRO_CAPACITY = 64;
+
+// Longest action sequence recorded for one task
+inline constexpr std::size_t MACRO_MAX_STEPS = 16;
+
+// NONE ends a task rather than being a step of it; errors come back as
+// NONE. Only other actions are worth replaying or caching.
+[[nodiscard]] bool is_replayable(std::string_view action_json) noexcept;
+
+struct MacroStats {
+    uint64_t lookups;
+    uint64_t hits;
+    uint64_t drifts;    // recorded step met a different screen structure
+    uint64_t failures;  // replayed task reported unsuccessful
+    uint64_t recorded;  // macros stored
+    std::size_t size;
+};
+
+/**
+ * Replays action sequences of tasks that succeeded before.
+ *
+ * A task is one normalized query and the actions taken for it, one per
+ * screen. Every action is recorded with the structure signature of the
+ * screen it was chosen on (structure_signature). When the task ends
+ * successfully the sequence is stored. The next time the task starts, step
+ * k is answered from the macro as long as the screen still has the
+ * structure step k was recorded on, so element ids in the replayed action
+ * still point at the same elements. A structure mismatch (drift) or a
+ * failed replayed task invalidates the macro and hands back to the model.
+ *
+ * Thread-safe; independent of any engine.
+ */
+class MacroCache {
+public:
+    // Start a task explicitly. Requests with a different query start one
+    // implicitly, discarding an unfinished recording.
+    void begin_task(std::string_view query);
+
+    // Store the recording if `success`, invalidate a replayed macro if not
+    void end_task(bool success);
+
+    // Action for the current step of `query`'s task on a screen with
+    // `signature`, or nothing to ask the model. A hit advances the step.
+    [[nodiscard]] std::optional<std::string> lookup(std::string_view query, uint64_t signature);
+
+    // Record the model's action for the step lookup() missed
+    void record(std::string_view query, uint64_t signature, std::string_view action_json);
+
+    void set_enabled(bool enabled);
+    void clear();
+
+    [[nodiscard]] MacroStats stats();
+
+    // Heap bytes held by stored macros and the task in progress
+    [[nodiscard]] std::size_t memory_bytes();
+
+private:
+    struct Step {
+        uint64_t signature;
+        std::string action_json;
+    };
+
+    struct Macro {
+        std::vector<Step> steps;
+        uint64_t last_used = 0;
+    };
+
+    struct Task {
+        std::string query;  // normalized
+        std::size_t step = 0;
+        bool replayed = false;
+        std::vector<Step> steps;  // every step so far, replayed or recorded
+    };
+
+    void sync_task_locked(std::string_view query);
+    void evict_locked();
+
+    std::mutex mutex_;
+    bool enabled_ = true;
+    StringMap<Macro> macros_;
+    std::optional<Task> task_;
+    std::string scratch_;
+    uint64_t tick_ = 0;
+    uint64_t lookups_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t drifts_ = 0;
+    uint64_t failures_ = 0;
+    uint64_t recorded_ = 0;
+};
+
+extern MacroCache g_macro_cache;
+
+} // namespace sentinel_native
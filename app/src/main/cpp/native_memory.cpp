@@ -0,0 +1,138 @@
+#include "native_memory.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <malloc.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace sentinel_native {
+
+namespace {
+
+// Value of a "Name:   1234 kB" smaps field, in bytes
+[[nodiscard]] uint64_t field_kib(std::string_view line) noexcept {
+    const auto colon = line.find(':');
+    if (colon == std::string_view::npos) {
+        return 0;
+    }
+    return std::strtoull(line.data() + colon + 1, nullptr, 10) * 1024;
+}
+
+} // namespace
+
+[[nodiscard]] uint64_t heap_allocated_bytes() noexcept {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    // glibc counts blocks served by mmap separately; ggml buffers are such blocks
+    const struct mallinfo2 info = mallinfo2();
+    return static_cast<uint64_t>(info.uordblks) + static_cast<uint64_t>(info.hblkhd);
+#elif defined(__GLIBC__)
+    const struct mallinfo info = mallinfo();
+    return static_cast<uint64_t>(static_cast<unsigned>(info.uordblks)) +
+           static_cast<uint64_t>(static_cast<unsigned>(info.hblkhd));
+#else
+    // bionic: size_t fields, uordblks already includes large allocations
+    const struct mallinfo info = mallinfo();
+    return static_cast<uint64_t>(info.uordblks);
+#endif
+}
+
+[[nodiscard]] uint64_t process_rss_bytes() noexcept {
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size_pages = 0;
+    uint64_t resident_pages = 0;
+    if (!(statm >> size_pages >> resident_pages)) {
+        return 0;
+    }
+    const long page_size = sysconf(_SC_PAGE_SIZE);
+    return page_size > 0 ? resident_pages * static_cast<uint64_t>(page_size) : 0;
+}
+
+[[nodiscard]] MappingUsage file_mapping_usage(std::string_view path) {
+    MappingUsage usage{0, 0};
+    if (path.empty()) {
+        return usage;
+    }
+
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool in_file = false;
+    while (std::getline(smaps, line)) {
+        const std::string_view view = line;
+        const auto space = view.find(' ');
+        const bool is_field = space != std::string_view::npos && space > 0 && view[space - 1] == ':';
+        if (!is_field) {
+            // Mapping header: "start-end perms offset dev inode    pathname"
+            in_file = view.ends_with(path) && view.size() > path.size() && view[view.size() - path.size() - 1] == ' ';
+            continue;
+        }
+        if (!in_file) {
+            continue;
+        }
+        if (view.starts_with("Size:")) {
+            usage.mapped_bytes += field_kib(view);
+        } else if (view.starts_with("Rss:")) {
+            usage.resident_bytes += field_kib(view);
+        }
+    }
+    return usage;
+}
+
+uint64_t drop_file_pages(std::string_view path) {
+    if (path.empty()) {
+        return 0;
+    }
+
+    // Collected first: madvise while reading maps could change the listing
+    std::vector<std::pair<uintptr_t, uintptr_t>> ranges;
+    std::ifstream maps("/proc/self/maps");
+    std::string line;
+    while (std::getline(maps, line)) {
+        const std::string_view view = line;
+        if (!view.ends_with(path) || view.size() <= path.size() || view[view.size() - path.size() - 1] != ' ') {
+            continue;
+        }
+        // "start-end perms ..."; only read-only mappings are safe to drop
+        const auto dash = view.find('-');
+        const auto space = view.find(' ');
+        if (dash == std::string_view::npos || space == std::string_view::npos || space + 2 >= view.size() ||
+            view[space + 2] == 'w') {
+            continue;
+        }
+        const auto start = static_cast<uintptr_t>(std::strtoull(line.c_str(), nullptr, 16));
+        const auto end = static_cast<uintptr_t>(std::strtoull(line.c_str() + dash + 1, nullptr, 16));
+        if (end > start) {
+            ranges.emplace_back(start, end);
+        }
+    }
+
+    uint64_t dropped = 0;
+    for (const auto& [start, end] : ranges) {
+        if (madvise(reinterpret_cast<void*>(start), end - start, MADV_DONTNEED) == 0) {
+            dropped += end - start;
+        }
+    }
+    return dropped;
+}
+
+void release_free_heap() noexcept {
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#elif defined(M_PURGE)
+    mallopt(M_PURGE, 0);
+#endif
+}
+
+[[nodiscard]] uint64_t kv_cache_bytes(const llama_model* model, int32_t n_ctx) noexcept {
+    const auto n_layer = static_cast<uint64_t>(llama_model_n_layer(model));
+    const auto n_embd = static_cast<uint64_t>(llama_model_n_embd(model));
+    const auto n_head = static_cast<uint64_t>(std::max(llama_model_n_head(model), 1));
+    const auto n_head_kv = static_cast<uint64_t>(std::max(llama_model_n_head_kv(model), 1));
+    const uint64_t n_embd_kv = n_embd / n_head * n_head_kv;
+    return 2 * static_cast<uint64_t>(std::max(n_ctx, 0)) * n_layer * n_embd_kv * 2;
+}
+
+} // namespace sentinel_native
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "llama.h"
+
+namespace sentinel_native {
+
+// Process-level memory probes. Independent of engines so host tools can
+// link them on their own.
+
+// Bytes currently allocated from the C heap (mallinfo), mmap-backed large
+// blocks included. Takes the allocator's stats lock: a few microseconds.
+[[nodiscard]] uint64_t heap_allocated_bytes() noexcept;
+
+// Resident set size of the process, 0 if /proc is unavailable
+[[nodiscard]] uint64_t process_rss_bytes() noexcept;
+
+struct MappingUsage {
+    uint64_t mapped_bytes;    // address space mapped from the file
+    uint64_t resident_bytes;  // of that, pages currently in RAM
+};
+
+// Sum over every mapping of the file at `path` in /proc/self/smaps. Reads
+// the whole table (milliseconds with many mappings); diagnostics only.
+[[nodiscard]] MappingUsage file_mapping_usage(std::string_view path);
+
+// Drop this process's pages of every read-only mapping of the file at
+// `path` (MADV_DONTNEED). The mappings stay valid and fault pages back in
+// from the file on access; writable mappings are skipped, dropping them
+// could discard data. Returns the bytes of address space advised.
+uint64_t drop_file_pages(std::string_view path);
+
+// Return free heap pages to the system (malloc_trim / M_PURGE)
+void release_free_heap() noexcept;
+
+// F16 K and V for every layer at full n_ctx. Hybrid models keep KV only in
+// their attention layers, so this overestimates them.
+[[nodiscard]] uint64_t kv_cache_bytes(const llama_model* model, int32_t n_ctx) noexcept;
+
+/**
+ * Footprint of one engine. Context bytes are the heap growth measured
+ * around context creation, so they cover the KV cache and the compute and
+ * output buffers together; compute is what remains after the KV estimate.
+ */
+struct EngineMemory {
+    std::string model_path;
+    bool resident = false;
+    bool busy = false;  // engine was mid-request; only residency figures are set
+    int32_t n_ctx = 0;
+    uint64_t weights_bytes = 0;  // tensor data (llama_model_size)
+    uint64_t adapter_bytes = 0;
+    uint64_t mapped_bytes = 0;
+    uint64_t mapped_resident_bytes = 0;
+    uint64_t kv_bytes = 0;
+    uint64_t context_bytes = 0;
+    uint64_t compute_bytes = 0;
+    uint64_t checkpoint_bytes = 0;   // recurrent state snapshots
+    uint64_t token_cache_bytes = 0;  // TokenSpanCache
+    uint64_t layout_bytes = 0;       // cached agent prompt layout
+    uint64_t arena_bytes = 0;        // RequestArena block
+};
+
+} // namespace sentinel_native
@@ -0,0 +1,268 @@
+#include "native_metrics.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <iterator>
+#include <string_view>
+
+#include "native_flight.hpp"
+
+namespace sentinel_native {
+
+MetricsRegistry g_metrics;
+
+namespace {
+
+constexpr std::array<std::string_view, METRIC_PHASES> PHASE_NAMES = {
+    "sanitize", "template", "tokenize", "prefill", "decode", "sample", "grammar", "total",
+};
+
+constexpr std::array<std::string_view, RESPONSE_SOURCES> SOURCE_NAMES = {
+    "model", "router", "macro", "semantic", "blocked", "failed",
+};
+
+constexpr std::array<std::string_view, static_cast<std::size_t>(RequestError::Count)> ERROR_NAMES = {
+    "none", "not_loaded", "adapter_stage", "tokenize", "prompt_too_long", "prefill", "sampler", "decode",
+    "stream_unavailable", "other",
+};
+
+[[nodiscard]] double per_second(uint32_t tokens, uint64_t us) noexcept {
+    return us > 0 ? tokens * 1e6 / static_cast<double>(us) : 0.0;
+}
+
+void append_percentiles(std::string& out, std::string_view name, const LatencyHistogram& h, std::string_view unit) {
+    std::format_to(std::back_inserter(out), R"("{}":{{"count":{},"p50{}":{},"p95{}":{},"p99{}":{},"max{}":{}}})",
+        name, h.count(), unit, h.percentile(0.50), unit, h.percentile(0.95), unit, h.percentile(0.99),
+        unit, h.max());
+}
+
+} // namespace
+
+[[nodiscard]] std::string_view metric_phase_name(MetricPhase phase) noexcept {
+    return PHASE_NAMES[static_cast<std::size_t>(phase)];
+}
+
+[[nodiscard]] std::string_view response_source_name(ResponseSource source) noexcept {
+    return SOURCE_NAMES[static_cast<std::size_t>(source)];
+}
+
+[[nodiscard]] std::string_view request_error_name(RequestError error) noexcept {
+    return ERROR_NAMES[static_cast<std::size_t>(error)];
+}
+
+[[nodiscard]] double RequestMetrics::prefill_tps() const noexcept {
+    return per_second(prompt_tokens - std::min(reused_tokens, prompt_tokens), phase(MetricPhase::Prefill));
+}
+
+[[nodiscard]] double RequestMetrics::decode_tps() const noexcept {
+    return per_second(output_tokens,
+        phase(MetricPhase::Decode) + phase(MetricPhase::Sample) + phase(MetricPhase::Grammar));
+}
+
+// --- LatencyHistogram ---
+
+[[nodiscard]] std::size_t LatencyHistogram::bucket_of(uint64_t value) noexcept {
+    if (value < SUB_BUCKETS) {
+        return static_cast<std::size_t>(value);
+    }
+    const unsigned msb = std::min<unsigned>(static_cast<unsigned>(std::bit_width(value)) - 1, MAX_BITS - 1);
+    const unsigned shift = msb - SUB_BITS;
+    // Top SUB_BITS + 1 bits, in [SUB_BUCKETS, 2 * SUB_BUCKETS) unless clamped
+    const uint64_t top = std::min<uint64_t>(value >> shift, 2 * SUB_BUCKETS - 1);
+    return (shift + 1) * SUB_BUCKETS + static_cast<std::size_t>(top - SUB_BUCKETS);
+}
+
+[[nodiscard]] uint64_t LatencyHistogram::bucket_mid(std::size_t bucket) noexcept {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    const unsigned shift = static_cast<unsigned>(bucket / SUB_BUCKETS) - 1;
+    const uint64_t lower = (SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    return lower + ((uint64_t{1} << shift) >> 1);
+}
+
+void LatencyHistogram::record(uint64_t value) noexcept {
+    buckets_[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t seen = max_.load(std::memory_order_relaxed);
+    while (value > seen && !max_.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset() noexcept {
+    for (auto& b : buckets_) {
+        b.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+[[nodiscard]] uint64_t LatencyHistogram::percentile(double q) const noexcept {
+    // Concurrent record() calls may land between the loads; the result is
+    // then off by those few samples, never out of range
+    uint64_t total = 0;
+    for (const auto& b : buckets_) {
+        total += b.load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    const auto rank = static_cast<uint64_t>(std::clamp(q, 0.0, 1.0) * static_cast<double>(total - 1)) + 1;
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(bucket_mid(i), max());
+        }
+    }
+    return max();
+}
+
+// --- MetricsRegistry ---
+
+void MetricsRegistry::commit(const RequestMetrics& metrics) {
+    for (std::size_t i = 0; i < METRIC_PHASES; ++i) {
+        if (metrics.phases_run & (1u << i)) {
+            phases_[i].record(metrics.phase_ns[i] / 1000);
+        }
+    }
+    if (metrics.phases_run & (1u << static_cast<unsigned>(MetricPhase::Prefill)) &&
+        metrics.prompt_tokens > metrics.reused_tokens) {
+        prefill_tps_.record(static_cast<uint64_t>(metrics.prefill_tps()));
+    }
+    if (metrics.output_tokens > 0) {
+        decode_tps_.record(static_cast<uint64_t>(metrics.decode_tps()));
+    }
+    heap_peak_kib_.record(metrics.heap_peak_bytes / 1024);
+    if (metrics.first_token_ns > 0) {
+        first_token_.record(metrics.first_token_ns / 1000);
+    }
+    sources_[static_cast<std::size_t>(metrics.source)].fetch_add(1, std::memory_order_relaxed);
+
+    std::lock_guard lock(recent_mutex_);
+    recent_[recent_next_] = metrics;
+    recent_next_ = (recent_next_ + 1) % METRICS_RECENT;
+    recent_size_ = std::min(recent_size_ + 1, METRICS_RECENT);
+}
+
+void MetricsRegistry::reset() {
+    for (auto& h : phases_) {
+        h.reset();
+    }
+    prefill_tps_.reset();
+    decode_tps_.reset();
+    heap_peak_kib_.reset();
+    first_token_.reset();
+    for (auto& s : sources_) {
+        s.store(0, std::memory_order_relaxed);
+    }
+    std::lock_guard lock(recent_mutex_);
+    recent_next_ = 0;
+    recent_size_ = 0;
+}
+
+[[nodiscard]] std::string MetricsRegistry::to_json(std::size_t recent) {
+    std::string out;
+    out.reserve(4096);
+    auto it = std::back_inserter(out);
+
+    out += R"({"sources":{)";
+    for (std::size_t i = 0; i < RESPONSE_SOURCES; ++i) {
+        std::format_to(it, R"({}"{}":{})", i ? "," : "", SOURCE_NAMES[i], sources_[i].load(std::memory_order_relaxed));
+    }
+
+    out += R"(},"phases":{)";
+    for (std::size_t i = 0; i < METRIC_PHASES; ++i) {
+        if (i) out += ',';
+        append_percentiles(out, PHASE_NAMES[i], phases_[i], "_us");
+    }
+
+    out += R"(},"throughput":{)";
+    append_percentiles(out, "prefill", prefill_tps_, "_tps");
+    out += ',';
+    append_percentiles(out, "decode", decode_tps_, "_tps");
+
+    out += R"(},"latency":{)";
+    append_percentiles(out, "first_token", first_token_, "_us");
+
+    out += R"(},"memory":)";
+    out += memory_json();
+
+    out += R"(,"recent":[)";
+    {
+        std::lock_guard lock(recent_mutex_);
+        const std::size_t n = std::min(recent, recent_size_);
+        for (std::size_t k = 0; k < n; ++k) {
+            const RequestMetrics& m = recent_[(recent_next_ + METRICS_RECENT - n + k) % METRICS_RECENT];
+            std::format_to(it, R"({}{{"id":{},"source":"{}")", k ? "," : "", m.id,
+                SOURCE_NAMES[static_cast<std::size_t>(m.source)]);
+            for (std::size_t i = 0; i < METRIC_PHASES; ++i) {
+                std::format_to(it, R"(,"{}_us":{})", PHASE_NAMES[i], m.phase_ns[i] / 1000);
+            }
+            std::format_to(it,
+                R"(,"first_token_us":{},"tokens":{{"system":{},"screen":{},"query":{},"prompt":{},"reused":{},"output":{}}},"prefill_tps":{:.1f},"decode_tps":{:.1f},"heap_peak_kib":{}}})",
+                m.first_token_ns / 1000, m.system_tokens, m.screen_tokens, m.query_tokens, m.prompt_tokens,
+                m.reused_tokens, m.output_tokens, m.prefill_tps(), m.decode_tps(), m.heap_peak_bytes / 1024);
+        }
+    }
+    out += "]}";
+    return out;
+}
+
+[[nodiscard]] std::vector<RequestMetrics> MetricsRegistry::recent(std::size_t count) {
+    std::lock_guard lock(recent_mutex_);
+    const std::size_t n = std::min(count, recent_size_);
+    std::vector<RequestMetrics> out;
+    out.reserve(n);
+    for (std::size_t k = 0; k < n; ++k) {
+        out.push_back(recent_[(recent_next_ + METRICS_RECENT - n + k) % METRICS_RECENT]);
+    }
+    return out;
+}
+
+[[nodiscard]] std::string MetricsRegistry::memory_json() const {
+    std::string out = "{";
+    append_percentiles(out, "heap_peak", heap_peak_kib_, "_kib");
+    out += '}';
+    return out;
+}
+
+// --- RequestScope ---
+
+RequestScope::RequestScope(Engine& engine) noexcept : engine_(engine) {
+    if (engine_.metrics) {
+        return;
+    }
+    owner_ = true;
+    metrics_.id = g_metrics.next_request_id();
+    metrics_.heap_base = heap_allocated_bytes();
+    metrics_.start_ns = monotonic_ns();
+    engine_.metrics = &metrics_;
+}
+
+RequestScope::~RequestScope() {
+    (void)close();
+}
+
+const RequestMetrics* RequestScope::close() {
+    if (!owner_) {
+        return nullptr;
+    }
+    owner_ = false;
+    note_heap(engine_);
+    engine_.metrics = nullptr;
+    const uint64_t end_ns = monotonic_ns();
+    const auto total = static_cast<std::size_t>(MetricPhase::Total);
+    metrics_.phase_ns[total] = end_ns - metrics_.start_ns;
+    metrics_.phases_run |= 1u << total;
+    g_metrics.commit(metrics_);
+    g_flight_recorder.record(metrics_);
+    if (g_tracer.enabled()) {
+        g_tracer.record("request", metrics_.start_ns, end_ns, metrics_.id, static_cast<int64_t>(metrics_.output_tokens));
+    }
+    return &metrics_;
+}
+
+} // namespace sentinel_native
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "native_engine.hpp"
+#include "native_memory.hpp"
+#include "native_trace.hpp"
+
+namespace sentinel_native {
+
+enum class MetricPhase : uint8_t {
+    Sanitize,
+    Template,
+    Tokenize,  // prompt text and screen lines to tokens
+    Prefill,
+    Decode,    // llama_decode of generated tokens
+    Sample,    // llama_sampler_sample, grammar masking included
+    Grammar,   // llama_sampler_accept: advancing the grammar stack
+    Total,
+    Count
+};
+
+inline constexpr std::size_t METRIC_PHASES = static_cast<std::size_t>(MetricPhase::Count);
+
+// Where a response came from
+enum class ResponseSource : uint8_t {
+    Model,
+    Router,
+    Macro,
+    Semantic,
+    Blocked,  // injection check
+    Failed,   // error reported as a NONE action
+    Count
+};
+
+inline constexpr std::size_t RESPONSE_SOURCES = static_cast<std::size_t>(ResponseSource::Count);
+
+// First thing that went wrong in a request, kept without its message
+enum class RequestError : uint8_t {
+    None,
+    NotLoaded,
+    AdapterStage,
+    Tokenize,
+    PromptTooLong,
+    Prefill,
+    Sampler,
+    Decode,  // generation stopped early; partial output returned
+    StreamUnavailable,
+    Other,
+    Count
+};
+
+[[nodiscard]] std::string_view request_error_name(RequestError error) noexcept;
+[[nodiscard]] std::string_view response_source_name(ResponseSource source) noexcept;
+
+// Per-request records kept for getMetrics
+inline constexpr std::size_t METRICS_RECENT = 64;
+
+// Lowercase name used in JSON and as the trace span name
+[[nodiscard]] std::string_view metric_phase_name(MetricPhase phase) noexcept;
+
+/**
+ * One request's breakdown, filled in while it runs. Token counts split by
+ * system, screen and query only where the prompt is assembled from tokens
+ * (snapshot and streamed requests); `prompt` is always set.
+ */
+struct RequestMetrics {
+    uint64_t id = 0;
+    ResponseSource source = ResponseSource::Model;
+    RequestError error = RequestError::None;
+    uint16_t grammar_id = 0;  // grammar_id() of the constraint, 0 = none
+    std::array<uint64_t, METRIC_PHASES> phase_ns{};
+    uint32_t phases_run = 0;  // bit per MetricPhase
+    uint32_t system_tokens = 0;
+    uint32_t screen_tokens = 0;
+    uint32_t query_tokens = 0;
+    uint32_t prompt_tokens = 0;
+    uint32_t reused_tokens = 0;  // prompt prefix kept in the KV cache
+    uint32_t output_tokens = 0;
+    uint64_t start_ns = 0;         // monotonic_ns() when the request began
+    uint64_t first_token_ns = 0;   // from start to the first sampled token, 0 if none
+    uint64_t heap_base = 0;        // heap_allocated_bytes() when the request began
+    uint64_t heap_peak_bytes = 0;  // largest heap growth over heap_base seen by note_heap
+
+    // Microseconds spent in `p`
+    [[nodiscard]] uint64_t phase(MetricPhase p) const noexcept {
+        return phase_ns[static_cast<std::size_t>(p)] / 1000;
+    }
+    // Newly decoded prompt tokens per second; 0 if nothing was prefilled
+    [[nodiscard]] double prefill_tps() const noexcept;
+    // Generated tokens per second over decode, sampling and grammar time
+    [[nodiscard]] double decode_tps() const noexcept;
+};
+
+/**
+ * HDR-style latency histogram: values below 2^SUB_BITS are exact, larger
+ * ones keep SUB_BITS significant bits (about 3% relative error) up to
+ * 2^MAX_BITS. record() is a single relaxed fetch_add, safe from any thread.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BITS = 5;
+    static constexpr unsigned MAX_BITS = 36;  // ~19 hours in microseconds
+    static constexpr std::size_t SUB_BUCKETS = std::size_t{1} << SUB_BITS;
+    static constexpr std::size_t BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+    void record(uint64_t value) noexcept;
+    void reset() noexcept;
+
+    [[nodiscard]] uint64_t count() const noexcept { return count_.load(std::memory_order_relaxed); }
+    [[nodiscard]] uint64_t max() const noexcept { return max_.load(std::memory_order_relaxed); }
+
+    // Value at quantile q in [0, 1] (bucket midpoint), 0 when empty
+    [[nodiscard]] uint64_t percentile(double q) const noexcept;
+
+    [[nodiscard]] static std::size_t bucket_of(uint64_t value) noexcept;
+    [[nodiscard]] static uint64_t bucket_mid(std::size_t bucket) noexcept;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+/**
+ * Process-wide request metrics: a histogram per phase, for prefill and
+ * decode throughput and for peak heap growth, response source counters,
+ * and the last METRICS_RECENT request records.
+ */
+class MetricsRegistry {
+public:
+    void commit(const RequestMetrics& metrics);
+    void reset();
+
+    [[nodiscard]] uint64_t next_request_id() noexcept {
+        return next_id_.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    // Histograms plus the newest `recent` records, oldest first
+    [[nodiscard]] std::string to_json(std::size_t recent);
+
+    // The newest `count` records, oldest first
+    [[nodiscard]] std::vector<RequestMetrics> recent(std::size_t count);
+
+    // Percentiles of peak heap growth per request, in KiB
+    [[nodiscard]] std::string memory_json() const;
+
+private:
+    std::array<LatencyHistogram, METRIC_PHASES> phases_;
+    LatencyHistogram prefill_tps_;
+    LatencyHistogram decode_tps_;
+    LatencyHistogram heap_peak_kib_;
+    LatencyHistogram first_token_;
+    std::array<std::atomic<uint64_t>, RESPONSE_SOURCES> sources_{};
+    std::atomic<uint64_t> next_id_{0};
+
+    // Written once per request; histograms stay lock-free
+    std::mutex recent_mutex_;
+    std::array<RequestMetrics, METRICS_RECENT> recent_{};
+    std::size_t recent_next_ = 0;
+    std::size_t recent_size_ = 0;
+};
+
+extern MetricsRegistry g_metrics;
+
+/**
+ * Makes `engine` collect a RequestMetrics for its lifetime and commits it
+ * to g_metrics on destruction. Nested scopes on the same engine (a
+ * snapshot request falling back to the string path) add to the outer one.
+ * Caller must hold engine.mutex exclusively.
+ */
+class RequestScope {
+public:
+    explicit RequestScope(Engine& engine) noexcept;
+    ~RequestScope();
+    RequestScope(const RequestScope&) = delete;
+    RequestScope& operator=(const RequestScope&) = delete;
+
+    // Commit now rather than on destruction, for callers that need the
+    // finished metrics (Total included). Null for a nested scope; the
+    // destructor does nothing afterwards.
+    [[nodiscard]] const RequestMetrics* close();
+
+private:
+    Engine& engine_;
+    RequestMetrics metrics_;
+    bool owner_ = false;
+};
+
+// Adds the enclosed time to `phase` of the engine's current request and
+// records it as a trace span. Outside a RequestScope with tracing off it
+// does nothing, not even read the clock.
+class PhaseTimer {
+public:
+    PhaseTimer(Engine& engine, MetricPhase phase) noexcept
+        : metrics_(engine.metrics),
+          phase_(phase),
+          tracing_(g_tracer.enabled()),
+          start_ns_(metrics_ || tracing_ ? monotonic_ns() : 0) {}
+    ~PhaseTimer() {
+        if (!metrics_ && !tracing_) {
+            return;
+        }
+        const uint64_t end_ns = monotonic_ns();
+        const auto i = static_cast<std::size_t>(phase_);
+        if (metrics_) {
+            metrics_->phase_ns[i] += end_ns - start_ns_;
+            metrics_->phases_run |= 1u << i;
+        }
+        if (tracing_) {
+            g_tracer.record(metric_phase_name(phase_).data(), start_ns_, end_ns, metrics_ ? metrics_->id : 0, 0);
+        }
+    }
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    RequestMetrics* metrics_;
+    MetricPhase phase_;
+    bool tracing_;
+    uint64_t start_ns_;
+};
+
+// Id of the engine's request in flight for trace spans, 0 outside one
+[[nodiscard]] inline uint64_t current_request_id(const Engine& engine) noexcept {
+    return engine.metrics ? engine.metrics->id : 0;
+}
+
+inline void note_source(Engine& engine, ResponseSource source) noexcept {
+    if (engine.metrics) {
+        engine.metrics->source = source;
+    }
+}
+
+// Keeps the first error of the request
+inline void note_error(Engine& engine, RequestError error) noexcept {
+    if (engine.metrics && engine.metrics->error == RequestError::None) {
+        engine.metrics->error = error;
+    }
+}
+
+// Sample the heap for the request's peak growth. Called where a request's
+// transient allocations are largest (after prefill, before the sampler is
+// freed) and when it ends; growth in between is not seen.
+inline void note_heap(Engine& engine) noexcept {
+    if (RequestMetrics* m = engine.metrics) {
+        const uint64_t heap = heap_allocated_bytes();
+        m->heap_peak_bytes = std::max(m->heap_peak_bytes, heap > m->heap_base ? heap - m->heap_base : 0);
+    }
+}
+
+// First sampled token of the request: time to first token
+inline void note_first_token(Engine& engine) noexcept {
+    if (RequestMetrics* m = engine.metrics; m && m->first_token_ns == 0) {
+        m->first_token_ns = monotonic_ns() - m->start_ns;
+    }
+}
+
+// The request ends with an error response
+inline void note_failure(Engine& engine, RequestError error) noexcept {
+    note_source(engine, ResponseSource::Failed);
+    note_error(engine, error);
+}
+
+} // namespace sentinel_native
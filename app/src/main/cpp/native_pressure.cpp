@@ -0,0 +1,170 @@
+#include "native_pressure.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "native_engine.hpp"
+#include "native_logging.hpp"
+#include "native_macro.hpp"
+#include "native_memory.hpp"
+#include "native_residency.hpp"
+#include "native_semantic.hpp"
+#include "native_trace.hpp"
+
+namespace sentinel_native {
+
+namespace {
+
+// ComponentCallbacks2 TRIM_MEMORY_* values
+constexpr int32_t TRIM_RUNNING_MODERATE = 5;
+constexpr int32_t TRIM_RUNNING_LOW = 10;
+constexpr int32_t TRIM_RUNNING_CRITICAL = 15;
+constexpr int32_t TRIM_UI_HIDDEN = 20;
+constexpr int32_t TRIM_BACKGROUND = 40;
+constexpr int32_t TRIM_MODERATE = 60;
+constexpr int32_t TRIM_COMPLETE = 80;
+
+constexpr std::array<std::string_view, 5> STEP_NAMES = {"none", "caches", "context", "compute", "weights"};
+
+// monotonic_ns() of the last Context or higher step, 0 = none since restore
+std::atomic<uint64_t> g_last_shrink_ns{0};
+
+void drop_engine_caches(Engine& engine) {
+    engine.checkpoints.clear();
+    engine.checkpoints.shrink_to_fit();
+    engine.token_cache.reset(engine.vocab);
+    engine.arena.shrink();
+}
+
+void shrink_context(Engine& engine) {
+    const int32_t size = std::max(engine.n_ctx / 2, PRESSURE_MIN_N_CTX);
+    if (size >= engine.n_ctx) {
+        return;
+    }
+    if (engine.unshrunk_n_ctx == 0) {
+        engine.unshrunk_n_ctx = engine.n_ctx;
+    }
+    LOGI("Memory pressure: context %d -> %d tokens", engine.n_ctx, size);
+    // Rebuilt at the smaller size by the next request, as in restore_context
+    engine.release_compute();
+    engine.n_ctx = size;
+}
+
+void restore_context(Engine& engine) {
+    if (engine.unshrunk_n_ctx == 0) {
+        return;
+    }
+    // Recreated at full size by the next request rather than here: the
+    // caller may be the UI thread
+    engine.release_compute();
+    engine.n_ctx = engine.unshrunk_n_ctx;
+    engine.unshrunk_n_ctx = 0;
+}
+
+} // namespace
+
+[[nodiscard]] std::optional<PressureStep> pressure_step(int32_t trim_level) noexcept {
+    switch (trim_level) {
+    case TRIM_UI_HIDDEN:
+        return std::nullopt;
+    case TRIM_RUNNING_MODERATE:
+    case TRIM_BACKGROUND:
+        return PressureStep::Caches;
+    case TRIM_RUNNING_LOW:
+    case TRIM_MODERATE:
+        return PressureStep::Context;
+    case TRIM_RUNNING_CRITICAL:
+        return PressureStep::Compute;
+    case TRIM_COMPLETE:
+        return PressureStep::Weights;
+    default:
+        // Levels added in future releases: the nearest step below
+        if (trim_level >= TRIM_COMPLETE) return PressureStep::Weights;
+        if (trim_level >= TRIM_MODERATE) return PressureStep::Context;
+        if (trim_level >= TRIM_RUNNING_MODERATE) return PressureStep::Caches;
+        return PressureStep::None;
+    }
+}
+
+[[nodiscard]] std::string_view pressure_step_name(PressureStep step) noexcept {
+    return STEP_NAMES[static_cast<std::size_t>(step)];
+}
+
+void restore_relieved_context(Engine& engine) {
+    if (engine.unshrunk_n_ctx == 0) {
+        return;
+    }
+    const uint64_t shrunk_ns = g_last_shrink_ns.load(std::memory_order_relaxed);
+    if (shrunk_ns != 0 && monotonic_ns() - shrunk_ns < PRESSURE_RESTORE_DELAY_NS) {
+        return;
+    }
+    LOGI("Memory pressure passed: context %d -> %d tokens", engine.n_ctx, engine.unshrunk_n_ctx);
+    restore_context(engine);
+}
+
+[[nodiscard]] PressureReport relieve_memory_pressure(PressureStep step) {
+    PressureReport report{
+        .step = step,
+        .engines = 0,
+        .busy = 0,
+        .heap_before = heap_allocated_bytes(),
+        .heap_after = 0,
+        .rss_before = process_rss_bytes(),
+        .rss_after = 0,
+    };
+
+    if (step >= PressureStep::Caches) {
+        g_semantic_cache.clear();
+    }
+    if (step >= PressureStep::Compute) {
+        g_macro_cache.clear();
+    }
+    if (step == PressureStep::None) {
+        g_last_shrink_ns.store(0, std::memory_order_relaxed);
+    } else if (step >= PressureStep::Context) {
+        g_last_shrink_ns.store(monotonic_ns(), std::memory_order_relaxed);
+    }
+
+    std::vector<std::string> weights_paths;
+    report.busy = residency().for_each_idle([&](Engine& engine) {
+        ++report.engines;
+        if (step == PressureStep::None) {
+            restore_context(engine);
+            return;
+        }
+        drop_engine_caches(engine);
+        if (step >= PressureStep::Compute) {
+            engine.release_compute();
+        }
+        if (step >= PressureStep::Context) {
+            shrink_context(engine);
+        }
+        if (step >= PressureStep::Weights && engine.weights &&
+            std::find(weights_paths.begin(), weights_paths.end(), engine.weights->path) == weights_paths.end()) {
+            weights_paths.push_back(engine.weights->path);
+        }
+    });
+
+    // Outside the manager lock: reading the maps takes a while
+    for (const std::string& path : weights_paths) {
+        const uint64_t dropped = drop_file_pages(path);
+        LOGI("Memory pressure: dropped %llu MiB of weight pages (%s)",
+             static_cast<unsigned long long>(dropped >> 20), path.c_str());
+    }
+    if (step >= PressureStep::Caches) {
+        release_free_heap();
+    }
+
+    report.heap_after = heap_allocated_bytes();
+    report.rss_after = process_rss_bytes();
+    LOGI("Memory pressure %.*s: %zu engines, %zu busy, rss %llu -> %llu MiB",
+         static_cast<int>(pressure_step_name(step).size()), pressure_step_name(step).data(), report.engines,
+         report.busy, static_cast<unsigned long long>(report.rss_before >> 20),
+         static_cast<unsigned long long>(report.rss_after >> 20));
+    return report;
+}
+
+} // namespace sentinel_native
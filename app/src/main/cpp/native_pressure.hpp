@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace sentinel_native {
+
+struct Engine;
+
+/**
+ * Graduated response to system memory pressure. Each step includes the
+ * ones before it:
+ *
+ *   Caches   drop the semantic cache, recurrent state checkpoints, token
+ *            span caches and grown request arenas
+ *   Context  halve n_ctx (not below PRESSURE_MIN_N_CTX), shrinking the
+ *            KV cache the context is rebuilt with
+ *   Compute  free contexts (KV cache, compute and output buffers) and the
+ *            macro cache; the weights and vocab stay loaded, the next
+ *            request only rebuilds the context
+ *   Weights  also drop the resident pages of the mmapped weights; the
+ *            model stays loaded and pages fault back in from the file
+ *
+ * Context and Compute only free the context; the next request rebuilds it
+ * at the current n_ctx, so nothing is allocated on the caller's thread.
+ * None undoes Context: shrunk engines get their n_ctx back, recreated by
+ * the next request. Android never signals the end of pressure, so the next
+ * request after PRESSURE_RESTORE_DELAY_NS without a Context or higher step
+ * does the same (restore_relieved_context). Engines busy with a request
+ * are skipped; pressure handling never waits on inference.
+ *
+ * llama.cpp keeps compute buffers inside the context, so they cannot be
+ * freed apart from the KV cache. The vocab belongs to the model, so the
+ * model itself is never freed under pressure; Weights gives back its
+ * pages instead.
+ */
+enum class PressureStep : uint8_t {
+    None,
+    Caches,
+    Context,
+    Compute,
+    Weights,
+};
+
+// Contexts are not shrunk below this; agent prompts need most of it
+inline constexpr int32_t PRESSURE_MIN_N_CTX = 2048;
+
+// Quiet time after a Context or higher step before shrunk contexts regrow
+inline constexpr uint64_t PRESSURE_RESTORE_DELAY_NS = 60'000'000'000;
+
+// Step for an Android ComponentCallbacks2.onTrimMemory level; nothing for
+// TRIM_MEMORY_UI_HIDDEN, which signals visibility rather than pressure
+[[nodiscard]] std::optional<PressureStep> pressure_step(int32_t trim_level) noexcept;
+
+[[nodiscard]] std::string_view pressure_step_name(PressureStep step) noexcept;
+
+struct PressureReport {
+    PressureStep step;
+    std::size_t engines;  // engines the step was applied to
+    std::size_t busy;     // engines skipped mid-request
+    uint64_t heap_before;
+    uint64_t heap_after;
+    uint64_t rss_before;
+    uint64_t rss_after;
+};
+
+[[nodiscard]] PressureReport relieve_memory_pressure(PressureStep step);
+
+// Give a shrunk engine its n_ctx back once pressure has been quiet for
+// PRESSURE_RESTORE_DELAY_NS. Frees the context for the caller to rebuild;
+// caller holds engine.mutex exclusively.
+void restore_relieved_context(Engine& engine);
+
+} // namespace sentinel_native
@@ -0,0 +1,157 @@
+#include "native_profiler.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <iterator>
+
+#include "native_trace.hpp"
+
+namespace sentinel_native {
+
+OpProfiler g_op_profiler;
+
+namespace {
+
+// Set when the scheduler asks about a node, right before computing it
+thread_local uint64_t t_node_start_ns = 0;
+
+[[nodiscard]] bool is_layout_op(ggml_op op) noexcept {
+    switch (op) {
+        case GGML_OP_NONE:
+        case GGML_OP_VIEW:
+        case GGML_OP_RESHAPE:
+        case GGML_OP_PERMUTE:
+        case GGML_OP_TRANSPOSE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace
+
+[[nodiscard]] int tensor_layer(std::string_view name) noexcept {
+    const auto dash = name.rfind('-');
+    if (dash == std::string_view::npos || dash + 1 == name.size()) {
+        return -1;
+    }
+    int layer = -1;
+    const auto digits = name.substr(dash + 1);
+    auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), layer);
+    if (ec != std::errc{} || end != digits.data() + digits.size()) {
+        return -1;
+    }
+    return layer;
+}
+
+void OpProfiler::Counters::add(uint64_t ns_, uint64_t in, uint64_t out) noexcept {
+    count.fetch_add(1, std::memory_order_relaxed);
+    ns.fetch_add(ns_, std::memory_order_relaxed);
+    bytes_in.fetch_add(in, std::memory_order_relaxed);
+    bytes_out.fetch_add(out, std::memory_order_relaxed);
+}
+
+[[nodiscard]] OpTotals OpProfiler::Counters::load() const noexcept {
+    return {
+        .count = count.load(std::memory_order_relaxed),
+        .ns = ns.load(std::memory_order_relaxed),
+        .bytes_in = bytes_in.load(std::memory_order_relaxed),
+        .bytes_out = bytes_out.load(std::memory_order_relaxed),
+    };
+}
+
+void OpProfiler::Counters::clear() noexcept {
+    count.store(0, std::memory_order_relaxed);
+    ns.store(0, std::memory_order_relaxed);
+    bytes_in.store(0, std::memory_order_relaxed);
+    bytes_out.store(0, std::memory_order_relaxed);
+}
+
+bool OpProfiler::eval_callback(ggml_tensor* tensor, bool ask, void* user_data) {
+    if (ask) {
+        if (is_layout_op(tensor->op)) {
+            return false;
+        }
+        t_node_start_ns = monotonic_ns();
+        return true;
+    }
+    static_cast<OpProfiler*>(user_data)->record(tensor, monotonic_ns() - t_node_start_ns);
+    return true;  // keep computing
+}
+
+void OpProfiler::record(const ggml_tensor* tensor, uint64_t ns) noexcept {
+    uint64_t bytes_in = 0;
+    for (const ggml_tensor* src : tensor->src) {
+        if (src) {
+            bytes_in += ggml_nbytes(src);
+        }
+    }
+    const uint64_t bytes_out = ggml_nbytes(tensor);
+
+    if (tensor->op >= 0 && tensor->op < GGML_OP_COUNT) {
+        ops_[tensor->op].add(ns, bytes_in, bytes_out);
+    }
+    const int layer = tensor_layer(tensor->name);
+    const std::size_t slot = layer >= 0 && static_cast<std::size_t>(layer) < PROFILER_MAX_LAYERS
+        ? static_cast<std::size_t>(layer) : PROFILER_MAX_LAYERS;
+    layers_[slot].add(ns, bytes_in, bytes_out);
+}
+
+void OpProfiler::reset() noexcept {
+    for (auto& c : ops_) {
+        c.clear();
+    }
+    for (auto& c : layers_) {
+        c.clear();
+    }
+}
+
+[[nodiscard]] OpProfile OpProfiler::snapshot() const {
+    OpProfile profile;
+    for (std::size_t op = 0; op < ops_.size(); ++op) {
+        const OpTotals totals = ops_[op].load();
+        if (totals.count == 0) {
+            continue;
+        }
+        profile.ops.emplace_back(ggml_op_name(static_cast<ggml_op>(op)), totals);
+        profile.total_ns += totals.ns;
+    }
+    std::sort(profile.ops.begin(), profile.ops.end(), [](const auto& a, const auto& b) {
+        return a.second.ns > b.second.ns;
+    });
+
+    for (std::size_t slot = 0; slot < layers_.size(); ++slot) {
+        const OpTotals totals = layers_[slot].load();
+        if (totals.count == 0) {
+            continue;
+        }
+        profile.layers.emplace_back(slot == PROFILER_MAX_LAYERS ? -1 : static_cast<int>(slot), totals);
+    }
+    return profile;
+}
+
+[[nodiscard]] std::string op_profile_json(const OpProfile& profile) {
+    std::string out;
+    auto it = std::back_inserter(out);
+    const auto totals = [&](const OpTotals& t) {
+        const double share = profile.total_ns ? static_cast<double>(t.ns) / static_cast<double>(profile.total_ns) : 0.0;
+        std::format_to(it, R"("count":{},"us":{},"share":{:.4f},"bytes_in":{},"bytes_out":{}}})",
+            t.count, t.ns / 1000, share, t.bytes_in, t.bytes_out);
+    };
+
+    std::format_to(it, R"({{"total_us":{},"ops":[)", profile.total_ns / 1000);
+    for (std::size_t i = 0; i < profile.ops.size(); ++i) {
+        std::format_to(it, R"({}{{"op":"{}",)", i ? "," : "", profile.ops[i].first);
+        totals(profile.ops[i].second);
+    }
+    out += R"(],"layers":[)";
+    for (std::size_t i = 0; i < profile.layers.size(); ++i) {
+        std::format_to(it, R"({}{{"layer":{},)", i ? "," : "", profile.layers[i].first);
+        totals(profile.layers[i].second);
+    }
+    out += "]}";
+    return out;
+}
+
+} // namespace sentinel_native
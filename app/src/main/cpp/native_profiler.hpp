@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ggml.h"
+
+namespace sentinel_native {
+
+// Layers tracked individually; nodes of deeper or unnamed layers share one bucket
+inline constexpr std::size_t PROFILER_MAX_LAYERS = 128;
+
+struct OpTotals {
+    uint64_t count = 0;
+    uint64_t ns = 0;
+    uint64_t bytes_in = 0;   // sources read, weights included
+    uint64_t bytes_out = 0;  // result written
+};
+
+struct OpProfile {
+    std::vector<std::pair<std::string_view, OpTotals>> ops;  // by time, descending
+    std::vector<std::pair<int, OpTotals>> layers;             // by layer, -1 = outside layers
+    uint64_t total_ns = 0;
+};
+
+/**
+ * Per-op-type and per-layer compute time from the ggml scheduler's eval
+ * callback (llama_context_params::cb_eval).
+ *
+ * Asking to observe every node makes the scheduler compute the graph one
+ * node at a time; the callback stamps the clock when asked and charges the
+ * elapsed time to the node once it has been computed. Layout-only nodes
+ * (view, reshape, permute, transpose) are not observed and fold into the
+ * next node. The per-node split and thread sync inflate small ops, so
+ * compare ops against each other, not against unprofiled runs.
+ *
+ * Only contexts created with the callback pay anything (Engine::profile_ops);
+ * everyone else runs the normal graph. Counters are relaxed atomics.
+ */
+class OpProfiler {
+public:
+    // ggml_backend_sched_eval_callback; user_data is the OpProfiler
+    static bool eval_callback(ggml_tensor* tensor, bool ask, void* user_data);
+
+    void reset() noexcept;
+    [[nodiscard]] OpProfile snapshot() const;
+
+private:
+    struct Counters {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> ns{0};
+        std::atomic<uint64_t> bytes_in{0};
+        std::atomic<uint64_t> bytes_out{0};
+
+        void add(uint64_t ns_, uint64_t in, uint64_t out) noexcept;
+        [[nodiscard]] OpTotals load() const noexcept;
+        void clear() noexcept;
+    };
+
+    void record(const ggml_tensor* tensor, uint64_t ns) noexcept;
+
+    std::array<Counters, GGML_OP_COUNT> ops_;
+    std::array<Counters, PROFILER_MAX_LAYERS + 1> layers_;  // last = outside layers
+};
+
+extern OpProfiler g_op_profiler;
+
+// Layer index from a llama.cpp node name ("ffn_out-12" -> 12), or -1
+[[nodiscard]] int tensor_layer(std::string_view name) noexcept;
+
+[[nodiscard]] std::string op_profile_json(const OpProfile& profile);
+
+} // namespace sentinel_native
@@ -0,0 +1,84 @@
+#include "native_prompt.hpp"
+
+#include "native_logging.hpp"
+#include "native_engine.hpp"
+#include "native_utils.hpp"
+
+namespace sentinel_native {
+
+namespace {
+
+// Control characters never survive sanitize(), so these cannot collide
+// with real screen or query text.
+constexpr std::string_view SCREEN_MARKER = "\x01SCREEN\x01";
+constexpr std::string_view QUERY_MARKER = "\x01QUERY\x01";
+
+std::vector<llama_token> tokenize_fixed(const llama_vocab* vocab, std::string_view text, bool add_bos) {
+    auto tokens = tokenize(vocab, text, add_bos, true);
+    return {tokens.begin(), tokens.end()};
+}
+
+} // namespace
+
+[[nodiscard]] std::size_t TokenSpanCache::memory_bytes() const noexcept {
+    std::size_t bytes = spans_.bucket_count() * sizeof(void*);
+    for (const auto& [text, tokens] : spans_) {
+        bytes += sizeof(std::pair<const std::string, std::vector<llama_token>>) + text.capacity() +
+                 tokens.capacity() * sizeof(llama_token);
+    }
+    return bytes;
+}
+
+[[nodiscard]] std::span<const llama_token> TokenSpanCache::get_or_tokenize(std::string_view text) {
+    if (auto it = spans_.find(text); it != spans_.end()) {
+        ++hits_;
+        return it->second;
+    }
+
+    ++misses_;
+    if (spans_.size() >= MAX_ENTRIES) {
+        spans_.clear();
+    }
+
+    auto tokens = tokenize(vocab_, text, false, false);
+    auto [it, inserted] = spans_.emplace(std::string(text), std::vector<llama_token>(tokens.begin(), tokens.end()));
+    return it->second;
+}
+
+[[nodiscard]] const PromptLayout* agent_prompt_layout(Engine& engine) {
+    if (engine.agent_layout) {
+        return &*engine.agent_layout;
+    }
+
+    std::string system_prompt;
+    system_prompt += AGENT_PROMPT_HEAD;
+    system_prompt += SCREEN_MARKER;
+    system_prompt += AGENT_PROMPT_TAIL;
+
+    auto rendered = apply_chat_template(engine.chat_template, system_prompt, QUERY_MARKER);
+    std::string_view text = rendered;
+
+    const auto screen_pos = text.find(SCREEN_MARKER);
+    const auto query_pos = text.find(QUERY_MARKER);
+    if (screen_pos == std::string_view::npos || query_pos == std::string_view::npos || query_pos < screen_pos) {
+        LOGW("Chat template does not preserve prompt markers, segmented prompts disabled");
+        return nullptr;
+    }
+
+    PromptLayout layout;
+    layout.head = text.substr(0, screen_pos);
+    layout.middle = text.substr(screen_pos + SCREEN_MARKER.size(), query_pos - screen_pos - SCREEN_MARKER.size());
+    layout.tail = text.substr(query_pos + QUERY_MARKER.size());
+
+    layout.head_tokens = tokenize_fixed(engine.vocab, layout.head, true);
+    layout.middle_tokens = tokenize_fixed(engine.vocab, layout.middle, false);
+    layout.tail_tokens = tokenize_fixed(engine.vocab, layout.tail, false);
+
+    LOGI("Agent prompt layout: %zu + %zu + %zu fixed tokens",
+         layout.head_tokens.size(), layout.middle_tokens.size(), layout.tail_tokens.size());
+
+    engine.agent_layout = std::move(layout);
+    return &*engine.agent_layout;
+}
+
+} // namespace sentinel_native
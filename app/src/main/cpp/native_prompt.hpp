@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "llama.h"
+
+namespace sentinel_native {
+
+struct Engine;
+
+inline constexpr std::string_view AGENT_PROMPT_HEAD = R"(You are an Android accessibility agent. Analyze the screen and respond with a JSON action.
+
+Available actions:
+- CLICK: {"action":"CLICK","target":"element_id","reasoning":"why"}
+- TYPE: {"action":"TYPE","target":"element_id","text":"what to type","reasoning":"why"}
+- SCROLL: {"action":"SCROLL","direction":"up|down|left|right","reasoning":"why"}
+- BACK: {"action":"BACK","reasoning":"why"}
+- NONE: {"action":"NONE","reasoning":"why nothing needed"}
+
+Current screen context:
+)";
+
+inline constexpr std::string_view AGENT_PROMPT_TAIL = R"(
+
+Respond ONLY with valid JSON. No markdown, no explanation outside JSON.)";
+
+/**
+ * The agent prompt rendered once through the chat template and split
+ * around the two variable parts:
+ *
+ *   head | screen | middle | query | tail
+ *
+ * The fixed pieces are tokenized once per model. Variable parts are
+ * tokenized without special-token parsing, so screen or query text cannot
+ * smuggle in template control tokens.
+ */
+struct PromptLayout {
+    std::string head;
+    std::string middle;
+    std::string tail;
+
+    std::vector<llama_token> head_tokens;
+    std::vector<llama_token> middle_tokens;
+    std::vector<llama_token> tail_tokens;
+};
+
+/**
+ * Token spans for recurring text (screen lines), keyed by the exact text.
+ * Tied to one vocab; reset() whenever the model changes.
+ */
+class TokenSpanCache {
+public:
+    static constexpr std::size_t MAX_ENTRIES = 4096;
+
+    [[nodiscard]] std::span<const llama_token> get_or_tokenize(std::string_view text);
+
+    void reset(const llama_vocab* vocab) noexcept {
+        vocab_ = vocab;
+        spans_.clear();
+    }
+    [[nodiscard]] std::size_t size() const noexcept { return spans_.size(); }
+    [[nodiscard]] std::size_t hits() const noexcept { return hits_; }
+    [[nodiscard]] std::size_t misses() const noexcept { return misses_; }
+
+    // Heap bytes of the cached texts and their token spans
+    [[nodiscard]] std::size_t memory_bytes() const noexcept;
+
+private:
+    struct Hash {
+        using is_transparent = void;
+        [[nodiscard]] std::size_t operator()(std::string_view s) const noexcept {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+
+    const llama_vocab* vocab_ = nullptr;
+    std::unordered_map<std::string, std::vector<llama_token>, Hash, std::equal_to<>> spans_;
+    std::size_t hits_ = 0;
+    std::size_t misses_ = 0;
+};
+
+/**
+ * Layout for the built-in agent prompt under the engine's chat template,
+ * built lazily and cached in the engine. nullptr if the template mangles
+ * the split markers (caller should fall back to the plain string path).
+ */
+[[nodiscard]] const PromptLayout* agent_prompt_layout(Engine& engine);
+
+} // namespace sentinel_native
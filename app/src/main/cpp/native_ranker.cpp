@@ -0,0 +1,300 @@
+#include "native_ranker.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <bitset>
+#include <cmath>
+
+namespace sentinel_native {
+
+namespace {
+
+constexpr std::size_t MAX_QUERY_TERMS = 16;
+constexpr std::size_t MAX_QUERY_TRIGRAMS = 64;
+constexpr std::size_t MAX_TERM_BYTES = 32;
+
+// BM25 parameters; labels are short so length normalization is mild
+constexpr float BM25_K1 = 1.2f;
+constexpr float BM25_B = 0.5f;
+// Weight of the fraction of query trigrams found in a label
+constexpr float TRIGRAM_WEIGHT = 1.5f;
+constexpr float ANCHOR_SCORE = 1e6f;
+
+constexpr std::array<std::string_view, 18> STOP_WORDS = {
+    "a", "an", "and", "for", "in", "is", "it", "me", "my", "of",
+    "on", "or", "please", "that", "the", "this", "to", "with",
+};
+
+// Labels the model needs regardless of the query to navigate at all
+constexpr std::array<std::string_view, 10> ANCHOR_LABELS = {
+    "back", "navigate up", "close", "cancel", "ok", "done",
+    "search", "menu", "more options", "send",
+};
+
+[[nodiscard]] constexpr char to_lower(char c) noexcept {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// ASCII letters/digits and any UTF-8 byte, so non-Latin labels still split
+// on spaces and punctuation
+[[nodiscard]] constexpr bool is_word_byte(char c) noexcept {
+    const auto u = static_cast<unsigned char>(c);
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || u >= 0x80;
+}
+
+// Calls fn(word) for each lowercased word of text, truncated to MAX_TERM_BYTES
+template <typename Fn>
+void for_each_word(std::string_view text, Fn&& fn) {
+    std::array<char, MAX_TERM_BYTES> buf;
+    std::size_t len = 0;
+    auto flush = [&] {
+        if (len > 0) fn(std::string_view(buf.data(), len));
+        len = 0;
+    };
+    for (char c : text) {
+        if (!is_word_byte(c)) {
+            flush();
+        } else if (len < buf.size()) {
+            buf[len++] = to_lower(c);
+        }
+    }
+    flush();
+}
+
+[[nodiscard]] constexpr uint32_t trigram(std::string_view w, std::size_t i) noexcept {
+    return static_cast<uint32_t>(static_cast<unsigned char>(w[i])) << 16 |
+           static_cast<uint32_t>(static_cast<unsigned char>(w[i + 1])) << 8 |
+           static_cast<uint32_t>(static_cast<unsigned char>(w[i + 2]));
+}
+
+[[nodiscard]] constexpr std::size_t bloom_slot(uint32_t t) noexcept {
+    return (t * 2654435761u) >> 22;  // 10 bits
+}
+
+} // namespace
+
+struct RankQuery {
+    std::array<std::array<char, MAX_TERM_BYTES>, MAX_QUERY_TERMS> term_buf{};
+    std::array<std::string_view, MAX_QUERY_TERMS> terms{};
+    std::size_t term_count = 0;
+
+    std::array<uint64_t, MAX_QUERY_TERMS> term_trigrams{};  // bits of each term's trigrams
+
+    std::array<uint32_t, MAX_QUERY_TRIGRAMS> trigrams{};
+    std::size_t trigram_count = 0;
+    std::bitset<1024> bloom;
+
+    explicit RankQuery(std::string_view text) {
+        for_each_word(text, [this](std::string_view w) {
+            if (term_count == MAX_QUERY_TERMS) return;
+            if (std::ranges::find(STOP_WORDS, w) != STOP_WORDS.end()) return;
+            if (std::ranges::find(terms.begin(), terms.begin() + term_count, w) != terms.begin() + term_count) return;
+
+            auto& buf = term_buf[term_count];
+            std::ranges::copy(w, buf.begin());
+            const std::string_view term(buf.data(), w.size());
+            uint64_t& own = term_trigrams[term_count];
+            terms[term_count++] = term;
+
+            for (std::size_t i = 0; i + 3 <= term.size(); ++i) {
+                const uint32_t t = trigram(term, i);
+                const auto q = static_cast<std::size_t>(
+                    std::ranges::find(trigrams.begin(), trigrams.begin() + trigram_count, t) - trigrams.begin());
+                if (q == trigram_count) {
+                    if (trigram_count == MAX_QUERY_TRIGRAMS) break;
+                    trigrams[trigram_count++] = t;
+                    bloom.set(bloom_slot(t));
+                }
+                own |= uint64_t{1} << q;
+            }
+        });
+    }
+
+    // Bit i set if query trigram i occurs in word
+    [[nodiscard]] uint64_t trigram_hits(std::string_view word) const noexcept {
+        uint64_t hits = 0;
+        for (std::size_t i = 0; i + 3 <= word.size(); ++i) {
+            const uint32_t t = trigram(word, i);
+            if (!bloom.test(bloom_slot(t))) continue;
+            for (std::size_t q = 0; q < trigram_count; ++q) {
+                if (trigrams[q] == t) hits |= uint64_t{1} << q;
+            }
+        }
+        return hits;
+    }
+
+    // A term equals a word of label, or at least half its trigrams occur in one
+    [[nodiscard]] bool matches(std::string_view label) const noexcept {
+        bool found = false;
+        for_each_word(label, [&](std::string_view w) {
+            if (found) return;
+            const uint64_t hits = trigram_count > 0 ? trigram_hits(w) : 0;
+            for (std::size_t t = 0; t < term_count && !found; ++t) {
+                const int own = std::popcount(term_trigrams[t]);
+                found = w == terms[t] || (own > 0 && 2 * std::popcount(hits & term_trigrams[t]) >= own);
+            }
+        });
+        return found;
+    }
+};
+
+namespace {
+
+struct Candidate {
+    uint32_t index;
+    float score;
+    uint32_t length;                        // words
+    std::array<uint8_t, MAX_QUERY_TERMS> tf;
+    uint64_t trigrams;
+};
+
+[[nodiscard]] bool is_anchor(const SnapshotElement& element) noexcept {
+    if (element.flags & (SNAPSHOT_FLAG_EDITABLE | SNAPSHOT_FLAG_SCROLLABLE)) {
+        return true;
+    }
+    const std::string_view label = element.label;
+    return std::ranges::any_of(ANCHOR_LABELS, [label](std::string_view anchor) {
+        return label.size() == anchor.size() &&
+               std::equal(label.begin(), label.end(), anchor.begin(),
+                   [](char a, char b) { return to_lower(a) == b; });
+    });
+}
+
+void first_interactive(const ScreenSnapshot& snapshot, std::pmr::vector<uint32_t>& selected, std::size_t max_elements) {
+    for (std::size_t i = 0; i < snapshot.size() && selected.size() < max_elements; ++i) {
+        if (snapshot.element(i).is_interactive()) {
+            selected.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+} // namespace
+
+void rank_elements(
+    const ScreenSnapshot& snapshot,
+    std::string_view query_text,
+    std::pmr::vector<uint32_t>& selected,
+    std::size_t max_elements
+) {
+    selected.clear();
+
+    const RankQuery query(query_text);
+    if (query.term_count == 0) {
+        first_interactive(snapshot, selected, max_elements);
+        return;
+    }
+
+    std::pmr::vector<Candidate> candidates(selected.get_allocator());
+    candidates.reserve(snapshot.size());
+
+    std::array<uint32_t, MAX_QUERY_TERMS> df{};
+    uint64_t total_length = 0;
+
+    for (std::size_t i = 0; i < snapshot.size(); ++i) {
+        const auto element = snapshot.element(i);
+        if (!element.is_interactive()) continue;
+
+        Candidate c{.index = static_cast<uint32_t>(i), .score = 0.0f, .length = 0, .tf = {}, .trigrams = 0};
+        for_each_word(element.label, [&](std::string_view w) {
+            ++c.length;
+            for (std::size_t t = 0; t < query.term_count; ++t) {
+                if (w == query.terms[t] && c.tf[t] < UINT8_MAX) ++c.tf[t];
+            }
+            if (query.trigram_count > 0) {
+                c.trigrams |= query.trigram_hits(w);
+            }
+        });
+        for (std::size_t t = 0; t < query.term_count; ++t) {
+            df[t] += c.tf[t] > 0;
+        }
+        total_length += c.length;
+        candidates.push_back(c);
+    }
+
+    if (candidates.size() <= RANKED_MIN_ELEMENTS) {
+        for (const auto& c : candidates) selected.push_back(c.index);
+        return;
+    }
+
+    const float n = static_cast<float>(candidates.size());
+    const float avg_length = std::max(1.0f, static_cast<float>(total_length) / n);
+    std::array<float, MAX_QUERY_TERMS> idf{};
+    for (std::size_t t = 0; t < query.term_count; ++t) {
+        idf[t] = std::log(1.0f + (n - df[t] + 0.5f) / (df[t] + 0.5f));
+    }
+
+    bool any_match = false;
+    std::size_t anchors = 0;
+    for (auto& c : candidates) {
+        const float norm = BM25_K1 * (1.0f - BM25_B + BM25_B * c.length / avg_length);
+        for (std::size_t t = 0; t < query.term_count; ++t) {
+            if (c.tf[t] == 0) continue;
+            c.score += idf[t] * (c.tf[t] * (BM25_K1 + 1.0f)) / (c.tf[t] + norm);
+        }
+        if (query.trigram_count > 0 && c.trigrams != 0) {
+            c.score += TRIGRAM_WEIGHT * std::popcount(c.trigrams) / static_cast<float>(query.trigram_count);
+        }
+        any_match |= c.score > 0.0f;
+
+        if (anchors < RANKED_MAX_ANCHORS && is_anchor(snapshot.element(c.index))) {
+            c.score += ANCHOR_SCORE;
+            ++anchors;
+        }
+    }
+
+    if (!any_match) {
+        first_interactive(snapshot, selected, max_elements);
+        return;
+    }
+
+    // Best first; ties keep document order
+    std::ranges::stable_sort(candidates, std::greater<>{}, &Candidate::score);
+
+    std::size_t keep = 0;
+    while (keep < candidates.size() && keep < max_elements && candidates[keep].score > 0.0f) {
+        selected.push_back(candidates[keep++].index);
+    }
+    // Pad small selections with the earliest remaining elements for context
+    if (selected.size() < RANKED_MIN_ELEMENTS) {
+        std::ranges::sort(candidates.begin() + static_cast<std::ptrdiff_t>(keep), candidates.end(),
+            std::less<>{}, &Candidate::index);
+        for (std::size_t i = keep; i < candidates.size() && selected.size() < RANKED_MIN_ELEMENTS; ++i) {
+            selected.push_back(candidates[i].index);
+        }
+    }
+
+    std::ranges::sort(selected);
+}
+
+StreamRanker::StreamRanker() : query_(std::make_unique<RankQuery>(std::string_view())) {}
+
+StreamRanker::~StreamRanker() = default;
+
+void StreamRanker::reset(std::string_view query) {
+    // RankQuery views into its own buffers, so it is rebuilt, not assigned
+    query_ = std::make_unique<RankQuery>(query);
+    kept_ = 0;
+    anchors_ = 0;
+    context_ = 0;
+}
+
+[[nodiscard]] bool StreamRanker::keep(const SnapshotElement& element) {
+    if (kept_ == RANKED_MAX_ELEMENTS) {
+        return false;
+    }
+
+    bool keep = query_->term_count == 0 || query_->matches(element.label);
+    if (!keep && anchors_ < RANKED_MAX_ANCHORS && is_anchor(element)) {
+        ++anchors_;
+        keep = true;
+    }
+    if (!keep && context_ < RANKED_MIN_ELEMENTS) {
+        ++context_;
+        keep = true;
+    }
+    kept_ += keep;
+    return keep;
+}
+
+} // namespace sentinel_native
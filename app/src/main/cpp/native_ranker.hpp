@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+#include "native_snapshot.hpp"
+
+namespace sentinel_native {
+
+// Interactive elements kept by the ranker (the unranked path keeps 60)
+inline constexpr std::size_t RANKED_MAX_ELEMENTS = 32;
+// Editable/scrollable/navigation elements always kept, up to this many
+inline constexpr std::size_t RANKED_MAX_ANCHORS = 8;
+// Screens with at most this many interactive elements are never pruned,
+// and pruned screens are padded up to it in document order
+inline constexpr std::size_t RANKED_MIN_ELEMENTS = 12;
+
+/**
+ * Pick the interactive elements of `snapshot` worth showing the model for
+ * `query`: structural anchors plus the best BM25 matches on label words,
+ * with a trigram overlap bonus so "setting" still finds "Settings".
+ *
+ * Indices come back in document order so the rendered screen keeps its
+ * layout. Falls back to the first max_elements interactive elements when
+ * the query matches nothing. Scratch comes from selected's allocator.
+ */
+void rank_elements(
+    const ScreenSnapshot& snapshot,
+    std::string_view query,
+    std::pmr::vector<uint32_t>& selected,
+    std::size_t max_elements = RANKED_MAX_ELEMENTS
+);
+
+struct RankQuery;
+
+/**
+ * Per-element form of rank_elements for a screen that arrives in batches
+ * (ScreenStream), so it is never seen whole. An element is kept if a query
+ * term matches one of its label words, exactly or on at least half of the
+ * term's trigrams, or if it is one of the first RANKED_MAX_ANCHORS anchors.
+ * The first RANKED_MIN_ELEMENTS other elements are kept for context.
+ *
+ * Without document frequencies there is no BM25 order: matches are kept
+ * first come, in document order, up to RANKED_MAX_ELEMENTS. A query with
+ * no terms keeps the first RANKED_MAX_ELEMENTS elements, as rank_elements.
+ */
+class StreamRanker {
+public:
+    StreamRanker();
+    ~StreamRanker();
+
+    StreamRanker(const StreamRanker&) = delete;
+    StreamRanker& operator=(const StreamRanker&) = delete;
+
+    // Start a new screen for `query`
+    void reset(std::string_view query);
+
+    // Whether to render `element`, an interactive element of the screen
+    [[nodiscard]] bool keep(const SnapshotElement& element);
+
+private:
+    std::unique_ptr<RankQuery> query_;
+    std::size_t kept_ = 0;
+    std::size_t anchors_ = 0;
+    std::size_t context_ = 0;
+};
+
+} // namespace sentinel_native
@@ -0,0 +1,290 @@
+#include "native_request.hpp"
+
+#include <format>
+
+#include "native_adapter.hpp"
+#include "native_inference.hpp"
+#include "native_logging.hpp"
+#include "native_macro.hpp"
+#include "native_metrics.hpp"
+#include "native_prompt.hpp"
+#include "native_ranker.hpp"
+#include "native_residency.hpp"
+#include "native_router.hpp"
+#include "native_screen.hpp"
+#include "native_semantic.hpp"
+#include "native_utils.hpp"
+#include "sentinel.hpp"
+
+namespace sentinel_native {
+
+namespace {
+
+[[nodiscard]] std::pmr::string error_json(std::string_view error, std::pmr::memory_resource* mr) {
+    return std::pmr::string(std::format(R"({{"action":"NONE","reasoning":"{}"}})", error), mr);
+}
+
+struct QueryOptions {
+    std::string_view stage = {};             // LoRA adapter stage, empty = default
+    bool routable = false;                   // try the fast-path router
+    std::optional<uint64_t> signature = {};  // screen structure, enables macro and semantic caches
+};
+
+// Shared preamble: injection check, query sanitization, fast-path routing,
+// macro replay and the semantic cache, then readiness and adapter stage.
+// Returns a response to short-circuit with, or nothing to proceed.
+[[nodiscard]] std::optional<std::pmr::string> check_query(
+    Engine& engine,
+    const QueryOptions& options,
+    std::string_view user_query,
+    std::pmr::string& safe_query,
+    std::pmr::memory_resource* mr
+) {
+    LOGD("User query: %.*s", static_cast<int>(user_query.size()), user_query.data());
+
+    // Check for injection attempts
+    {
+        PhaseTimer timer(engine, MetricPhase::Sanitize);
+        if (sentinel::contains_injection(user_query)) {
+            note_source(engine, ResponseSource::Blocked);
+            return std::pmr::string(R"({"action":"none","reasoning":"blocked"})", mr);
+        }
+        sentinel::sanitize_into(user_query, safe_query, 2048);
+    }
+
+    // Trivial commands never reach the model (or reload an evicted one)
+    if (options.routable) {
+        if (auto route = g_intent_router.route(safe_query)) {
+            LOGD("Routed to %.*s (%.2f)", static_cast<int>(route_intent_name(route->intent).size()),
+                 route_intent_name(route->intent).data(), route->confidence);
+            note_source(engine, ResponseSource::Router);
+            return std::pmr::string(std::format(R"({{{},"confidence":{:.2f},"reasoning":"Fast-path command"}})",
+                route_action_fields(route->intent), route->confidence), mr);
+        }
+    }
+
+    // Repeat tasks replay their recorded step while the screen is unchanged
+    if (options.signature) {
+        if (auto action = g_macro_cache.lookup(safe_query, *options.signature)) {
+            LOGD("Macro replay: %s", action->c_str());
+            note_source(engine, ResponseSource::Macro);
+            return std::pmr::string(*action, mr);
+        }
+        // Paraphrases of a query already answered on this screen. Embedding
+        // may reload the embedding engine, whose trim must not pick this one.
+        std::optional<std::string> cached;
+        {
+            ResidencyManager::Held held(engine);
+            cached = g_semantic_cache.lookup(safe_query, *options.signature);
+        }
+        if (auto& action = cached) {
+            LOGD("Semantic cache: %s", action->c_str());
+            g_macro_cache.record(safe_query, *options.signature, *action);
+            note_source(engine, ResponseSource::Semantic);
+            return std::pmr::string(*action, mr);
+        }
+    }
+
+    if (!residency().ensure_resident(engine)) {
+        LOGE("Model not ready for inference");
+        note_failure(engine, RequestError::NotLoaded);
+        return std::pmr::string(R"({"action":"NONE","reasoning":"Model not loaded"})", mr);
+    }
+    if (!apply_stage(engine, options.stage)) {
+        note_failure(engine, RequestError::AdapterStage);
+        return std::pmr::string(R"({"action":"NONE","reasoning":"Adapter stage unavailable"})", mr);
+    }
+    return std::nullopt;
+}
+
+// middle | query | tail, completing a prompt whose head and screen are in tokens
+void append_query_tokens(
+    Engine& engine,
+    std::pmr::vector<llama_token>& tokens,
+    const PromptLayout& layout,
+    std::string_view safe_query,
+    std::pmr::memory_resource* mr
+) {
+    PhaseTimer timer(engine, MetricPhase::Tokenize);
+    const std::size_t before = tokens.size();
+    tokens.insert(tokens.end(), layout.middle_tokens.begin(), layout.middle_tokens.end());
+    auto query_tokens = tokenize(engine.vocab, safe_query, false, false, mr);
+    tokens.insert(tokens.end(), query_tokens.begin(), query_tokens.end());
+    tokens.insert(tokens.end(), layout.tail_tokens.begin(), layout.tail_tokens.end());
+    if (engine.metrics) {
+        engine.metrics->query_tokens = static_cast<uint32_t>(tokens.size() - before);
+    }
+}
+
+// Feed the model's answer to the caches that missed it in check_query
+void remember(std::string_view safe_query, uint64_t signature, std::string_view result) {
+    g_macro_cache.record(safe_query, signature, result);
+    g_semantic_cache.record(safe_query, signature, result);
+}
+
+[[nodiscard]] std::pmr::string finish(Engine& engine, InferenceResult result, std::pmr::memory_resource* mr) {
+    if (!result) {
+        LOGE("Inference failed: %s", result.error().c_str());
+        note_failure(engine, RequestError::Other);
+        return error_json(result.error(), mr);
+    }
+
+    LOGI("Inference result: %s", result->c_str());
+    return std::move(*result);
+}
+
+// The template-and-inference half of handle_request, for a query that has
+// already passed check_query
+[[nodiscard]] std::pmr::string run_prompt(
+    Engine& engine,
+    std::string_view safe_query,
+    std::string_view screen_context,
+    PromptMode mode,
+    const std::string* grammar_text,
+    std::pmr::memory_resource* mr
+) {
+    LOGD("Screen context length: %zu", screen_context.size());
+
+    std::pmr::string safe_context(mr);
+    sentinel::sanitize_into(screen_context, safe_context, 32000);
+
+    std::pmr::string system_prompt(mr);
+    if (mode == PromptMode::Agent) {
+        system_prompt.reserve(AGENT_PROMPT_HEAD.size() + safe_context.size() + AGENT_PROMPT_TAIL.size());
+        system_prompt += AGENT_PROMPT_HEAD;
+        system_prompt += safe_context;
+        system_prompt += AGENT_PROMPT_TAIL;
+    } else {
+        system_prompt = std::move(safe_context);
+    }
+
+    std::pmr::string prompt(mr);
+    {
+        PhaseTimer timer(engine, MetricPhase::Template);
+        prompt = apply_chat_template(engine.chat_template, system_prompt, safe_query, mr);
+    }
+
+    LOGD("Final prompt length: %zu", prompt.size());
+
+    static const std::string no_grammar;
+    return finish(engine, run_inference(engine, prompt, grammar_text ? *grammar_text : no_grammar, mr), mr);
+}
+
+} // namespace
+
+[[nodiscard]] std::pmr::string handle_request(
+    Engine& engine,
+    const AgentRequest& request,
+    std::pmr::memory_resource* mr
+) {
+    RequestScope scope(engine);
+    std::pmr::string safe_query(mr);
+    if (auto early = check_query(engine, {.stage = request.stage, .routable = request.mode == PromptMode::Agent}, request.user_query, safe_query, mr)) {
+        return std::move(*early);
+    }
+
+    return run_prompt(engine, safe_query, request.screen_context, request.mode, request.grammar_text, mr);
+}
+
+[[nodiscard]] std::pmr::string handle_snapshot_request(
+    Engine& engine,
+    std::string_view user_query,
+    const ScreenSnapshot& snapshot,
+    const std::string& grammar_text,
+    std::pmr::memory_resource* mr
+) {
+    RequestScope scope(engine);
+    const uint64_t signature = structure_signature(snapshot);
+    std::pmr::string safe_query(mr);
+    if (auto early = check_query(engine, {.routable = true, .signature = signature}, user_query, safe_query, mr)) {
+        return std::move(*early);
+    }
+
+    std::pmr::vector<uint32_t> selected(mr);
+    rank_elements(snapshot, safe_query, selected);
+    LOGD("Snapshot elements: %zu, kept %zu", snapshot.size(), selected.size());
+
+    const PromptLayout* layout = agent_prompt_layout(engine);
+    if (!layout) {
+        // Template cannot be split: render the screen and take the string path
+        std::pmr::string screen(mr);
+        render_snapshot(snapshot, selected, engine.screen_encoding, screen);
+        auto result = run_prompt(engine, safe_query, screen, PromptMode::Agent, &grammar_text, mr);
+        remember(safe_query, signature, result);
+        return result;
+    }
+
+    std::pmr::vector<llama_token> tokens(mr);
+    tokens.reserve(static_cast<size_t>(engine.n_ctx));
+    tokens.insert(tokens.end(), layout->head_tokens.begin(), layout->head_tokens.end());
+
+    ScreenEncoder encoder(mr);
+    encoder.reset(engine.screen_encoding);
+    std::pmr::vector<llama_token> deferred(mr);
+    {
+        PhaseTimer timer(engine, MetricPhase::Tokenize);
+        append_selected_screen_tokens(snapshot, selected, encoder, engine.token_cache, tokens, deferred);
+        finish_screen_tokens(encoder, engine.token_cache, tokens, deferred);
+    }
+    const std::size_t screen_end = tokens.size();
+    if (engine.metrics) {
+        engine.metrics->system_tokens = static_cast<uint32_t>(layout->head_tokens.size());
+        engine.metrics->screen_tokens = static_cast<uint32_t>(screen_end - layout->head_tokens.size());
+    }
+    append_query_tokens(engine, tokens, *layout, safe_query, mr);
+
+    LOGD("Snapshot prompt: %zu elements, %zu tokens, encoding %d (cache %zu entries)",
+         encoder.count(), tokens.size(), static_cast<int>(engine.screen_encoding.level),
+         engine.token_cache.size());
+
+    // Checkpoint the screen so recurrent models can reuse it on the next query
+    auto result = finish(engine, run_inference_tokens(engine, tokens, grammar_text, mr, screen_end), mr);
+    remember(safe_query, signature, result);
+    return result;
+}
+
+[[nodiscard]] std::pmr::string handle_streamed_request(
+    Engine& engine,
+    std::string_view user_query,
+    const std::string& grammar_text,
+    std::pmr::memory_resource* mr
+) {
+    RequestScope scope(engine);
+    ScreenStream& stream = engine.screen_stream();
+    std::optional<uint64_t> signature;
+    if (stream.prompt_tokens()) {
+        signature = stream.signature();
+    }
+
+    std::pmr::string safe_query(mr);
+    if (auto early = check_query(engine, {.routable = true, .signature = signature}, user_query, safe_query, mr)) {
+        return std::move(*early);
+    }
+
+    auto screen = stream.prompt_tokens();
+    const PromptLayout* layout = agent_prompt_layout(engine);
+    if (!screen || !layout) {
+        note_failure(engine, RequestError::StreamUnavailable);
+        return error_json(screen ? "Prompt layout unavailable" : screen.error(), mr);
+    }
+
+    std::pmr::vector<llama_token> tokens(mr);
+    tokens.reserve(static_cast<size_t>(engine.n_ctx));
+    tokens.insert(tokens.end(), screen->begin(), screen->end());
+    if (engine.metrics) {
+        // The stream's prompt starts with the layout head
+        engine.metrics->system_tokens = static_cast<uint32_t>(layout->head_tokens.size());
+        engine.metrics->screen_tokens = static_cast<uint32_t>(screen->size() - layout->head_tokens.size());
+    }
+    append_query_tokens(engine, tokens, *layout, safe_query, mr);
+
+    LOGD("Streamed prompt: %zu screen + %zu query tokens", screen->size(), tokens.size() - screen->size());
+
+    auto result = finish(engine, run_inference_tokens(engine, tokens, grammar_text, mr, screen->size()), mr);
+    if (signature) {
+        remember(safe_query, *signature, result);
+    }
+    return result;
+}
+
+} // namespace sentinel_native
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <vector>
+#include <string>
+#include <string_view>
+
+#include "native_encoding.hpp"
+#include "native_engine.hpp"
+#include "native_snapshot.hpp"
+
+namespace sentinel_native {
+
+enum class PromptMode {
+    Agent,       // Screen context is wrapped in the built-in agent system prompt
+    Passthrough  // Screen context is used verbatim as the system prompt
+};
+
+struct AgentRequest {
+    std::string_view user_query;
+    std::string_view screen_context;
+    PromptMode mode = PromptMode::Agent;
+    const std::string* grammar_text = nullptr;  // nullptr disables grammar constraint
+    std::string_view stage = {};  // LoRA adapter stage, empty = engine default (see native_adapter.hpp)
+};
+
+/**
+ * Sanitize, template and run a single request on `engine`.
+ * Caller must hold engine.mutex exclusively.
+ *
+ * Always yields a JSON document: failures are reported as a NONE action
+ * with the error as reasoning, matching what the Kotlin side expects.
+ * Every intermediate buffer and the result are allocated from mr.
+ */
+[[nodiscard]] std::pmr::string handle_request(
+    Engine& engine,
+    const AgentRequest& request,
+    std::pmr::memory_resource* mr = std::pmr::get_default_resource()
+);
+
+// Interactive elements rendered into the prompt, as ElementRegistry.toPromptString
+inline constexpr std::size_t SCREEN_MAX_ELEMENTS = 60;
+
+/**
+ * Sink for ScreenEncoder lines: tokenizes each line through `cache` and
+ * appends it to `tokens`, or to `deferred` for volatile lines (see
+ * is_volatile), which finish_screen_tokens places after the stable part.
+ * Caller must hold the owning engine's mutex.
+ */
+template <typename TokenVector, typename DeferredVector>
+auto screen_token_sink(TokenSpanCache& cache, TokenVector& tokens, DeferredVector& deferred) {
+    return [&cache, &tokens, &deferred](std::string_view line, bool volatile_line) {
+        auto span = cache.get_or_tokenize(line);
+        if (volatile_line) {
+            deferred.insert(deferred.end(), span.begin(), span.end());
+        } else {
+            tokens.insert(tokens.end(), span.begin(), span.end());
+        }
+    };
+}
+
+template <typename TokenVector>
+void append_element_tokens(
+    const SnapshotElement& element,
+    ScreenEncoder& encoder,
+    TokenSpanCache& cache,
+    TokenVector& tokens,
+    auto&& sink
+) {
+    if (encoder.count() == 0) {
+        auto header = cache.get_or_tokenize(encoder.header());
+        tokens.insert(tokens.end(), header.begin(), header.end());
+    }
+    encoder.add(element, sink);
+}
+
+/**
+ * Append the prompt tokens for the interactive elements of `snapshot` that
+ * `keep(element)` accepts, continuing the list `encoder` is building (up to
+ * SCREEN_MAX_ELEMENTS). Caller must hold the owning engine's mutex.
+ */
+template <typename TokenVector, typename DeferredVector, typename Keep>
+void append_screen_tokens(
+    const ScreenSnapshot& snapshot,
+    ScreenEncoder& encoder,
+    TokenSpanCache& cache,
+    TokenVector& tokens,
+    DeferredVector& deferred,
+    Keep&& keep
+) {
+    auto sink = screen_token_sink(cache, tokens, deferred);
+    for (std::size_t i = 0; i < snapshot.size() && encoder.count() < SCREEN_MAX_ELEMENTS; ++i) {
+        const auto element = snapshot.element(i);
+        if (!element.is_interactive() || !keep(element)) continue;
+
+        append_element_tokens(element, encoder, cache, tokens, sink);
+    }
+}
+
+// Same, for the elements picked by rank_elements
+template <typename TokenVector, typename DeferredVector>
+void append_selected_screen_tokens(
+    const ScreenSnapshot& snapshot,
+    std::span<const uint32_t> selected,
+    ScreenEncoder& encoder,
+    TokenSpanCache& cache,
+    TokenVector& tokens,
+    DeferredVector& deferred
+) {
+    auto sink = screen_token_sink(cache, tokens, deferred);
+    for (uint32_t i : selected) {
+        append_element_tokens(snapshot.element(i), encoder, cache, tokens, sink);
+    }
+}
+
+// Flush the encoder, then volatile lines, or placeholder text when no
+// interactive element was rendered
+template <typename TokenVector, typename DeferredVector>
+void finish_screen_tokens(
+    ScreenEncoder& encoder,
+    TokenSpanCache& cache,
+    TokenVector& tokens,
+    DeferredVector& deferred
+) {
+    encoder.finish(screen_token_sink(cache, tokens, deferred));
+    tokens.insert(tokens.end(), deferred.begin(), deferred.end());
+    if (encoder.count() == 0) {
+        auto empty = cache.get_or_tokenize(SCREEN_EMPTY_TEXT);
+        tokens.insert(tokens.end(), empty.begin(), empty.end());
+    }
+}
+
+/**
+ * Same contract as handle_request in Agent mode, but the screen comes from
+ * a packed snapshot. Elements are pruned to those relevant to the query
+ * (rank_elements), encoded per engine.screen_encoding and tokenized through
+ * engine.token_cache, so repeated elements skip the tokenizer.
+ */
+[[nodiscard]] std::pmr::string handle_snapshot_request(
+    Engine& engine,
+    std::string_view user_query,
+    const ScreenSnapshot& snapshot,
+    const std::string& grammar_text,
+    std::pmr::memory_resource* mr = std::pmr::get_default_resource()
+);
+
+/**
+ * Complete the screen prefilled by engine.screen_stream() with the query
+ * and run inference. Only middle | query | tail is decoded if the KV cache
+ * still holds the streamed screen. The screen was pruned against the query
+ * given to ScreenStream::begin, not this one.
+ */
+[[nodiscard]] std::pmr::string handle_streamed_request(
+    Engine& engine,
+    std::string_view user_query,
+    const std::string& grammar_text,
+    std::pmr::memory_resource* mr = std::pmr::get_default_resource()
+);
+
+} // namespace sentinel_native
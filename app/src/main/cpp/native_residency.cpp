@@ -0,0 +1,313 @@
+#include "native_residency.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <unistd.h>
+
+#include "native_engine.hpp"
+#include "native_logging.hpp"
+#include "native_memory.hpp"
+#include "native_pressure.hpp"
+
+namespace sentinel_native {
+
+namespace {
+
+// Engines locked by this thread under ResidencyManager::Held, innermost last
+thread_local std::vector<const Engine*> t_held;
+
+[[nodiscard]] uint64_t default_budget() noexcept {
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    const long page_size = sysconf(_SC_PAGE_SIZE);
+    if (pages <= 0 || page_size <= 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(pages) * static_cast<uint64_t>(page_size) / 2;
+}
+
+// Measured context allocation, or the KV estimate when the measurement
+// came out smaller (a concurrent free skewed it). The estimate overcounts
+// hybrid models; that errs on the side of evicting early.
+[[nodiscard]] uint64_t context_bytes(const Engine& engine) noexcept {
+    return std::max(kv_cache_bytes(engine.model, engine.n_ctx), engine.context_heap_bytes);
+}
+
+[[nodiscard]] uint64_t layout_bytes(const PromptLayout& layout) noexcept {
+    return layout.head.capacity() + layout.middle.capacity() + layout.tail.capacity() +
+           (layout.head_tokens.capacity() + layout.middle_tokens.capacity() + layout.tail_tokens.capacity()) *
+               sizeof(llama_token);
+}
+
+// Caller holds engine.mutex
+void fill_engine_memory(const Engine& engine, EngineMemory& m) {
+    m.n_ctx = engine.n_ctx;
+    m.weights_bytes = llama_model_size(engine.model);
+    m.adapter_bytes = engine.weights->adapter_bytes();
+    m.kv_bytes = kv_cache_bytes(engine.model, engine.n_ctx);
+    m.context_bytes = engine.context_heap_bytes;
+    m.compute_bytes = m.context_bytes > m.kv_bytes ? m.context_bytes - m.kv_bytes : 0;
+    for (const StateCheckpoint& checkpoint : engine.checkpoints) {
+        m.checkpoint_bytes += checkpoint.data.capacity();
+    }
+    m.token_cache_bytes = engine.token_cache.memory_bytes();
+    m.layout_bytes = engine.agent_layout ? layout_bytes(*engine.agent_layout) : 0;
+    m.arena_bytes = engine.arena.capacity();
+}
+
+} // namespace
+
+ResidencyManager::Held::Held(const Engine& engine) {
+    t_held.push_back(&engine);
+}
+
+ResidencyManager::Held::~Held() {
+    t_held.pop_back();
+}
+
+ResidencyManager::ResidencyManager() : budget_(default_budget()) {}
+
+void ResidencyManager::set_budget(uint64_t bytes) {
+    std::lock_guard lock(mutex_);
+    budget_ = bytes;
+    LOGI("Residency budget: %llu MiB", static_cast<unsigned long long>(bytes >> 20));
+    // Applied on the next load; evicting here would need an engine to hold
+}
+
+void ResidencyManager::track(Engine& engine) {
+    std::lock_guard lock(mutex_);
+    entries_.emplace_back().engine = &engine;
+}
+
+void ResidencyManager::untrack(Engine& engine) {
+    std::lock_guard lock(mutex_);
+    std::erase_if(entries_, [&](const Entry& e) { return e.engine == &engine; });
+}
+
+[[nodiscard]] ResidencyManager::Entry* ResidencyManager::find_locked(const Engine& engine) {
+    auto it = std::find_if(entries_.begin(), entries_.end(), [&](const Entry& e) { return e.engine == &engine; });
+    return it != entries_.end() ? &*it : nullptr;
+}
+
+[[nodiscard]] uint64_t ResidencyManager::resident_bytes_locked() const {
+    uint64_t total = 0;
+    std::vector<const ModelWeights*> counted;
+    for (const Entry& e : entries_) {
+        if (!e.resident) continue;
+        total += e.context_bytes;
+        if (std::find(counted.begin(), counted.end(), e.weights) == counted.end()) {
+            counted.push_back(e.weights);
+            total += e.weights_bytes;
+        }
+    }
+    return total;
+}
+
+[[nodiscard]] bool ResidencyManager::weights_shared_locked(std::string_view path, const Entry* except) const {
+    return std::any_of(entries_.begin(), entries_.end(), [&](const Entry& e) {
+        return &e != except && e.resident && e.weights_path == path;
+    });
+}
+
+void ResidencyManager::trim_locked(uint64_t incoming, Engine& held, bool evict_held) {
+    if (budget_ == 0) {
+        return;
+    }
+
+    // Engines that were busy when tried; not retried within this trim
+    std::vector<const Entry*> skipped;
+    while (resident_bytes_locked() + incoming > budget_) {
+        Entry* victim = nullptr;
+        for (Entry& e : entries_) {
+            if (!e.resident) continue;
+            if (e.engine == &held && !evict_held) continue;
+            if (e.engine != &held && std::find(t_held.begin(), t_held.end(), e.engine) != t_held.end()) continue;
+            if (std::find(skipped.begin(), skipped.end(), &e) != skipped.end()) continue;
+            // Released engines go first, then least recently used
+            if (!victim || std::pair(!e.released, e.last_used) < std::pair(!victim->released, victim->last_used)) {
+                victim = &e;
+            }
+        }
+        if (!victim) {
+            LOGW("Residency budget exceeded, nothing evictable");
+            return;
+        }
+
+        if (victim->engine == &held) {
+            held.unload();
+        } else {
+            std::unique_lock victim_lock(victim->engine->mutex, std::try_to_lock);
+            if (!victim_lock) {
+                skipped.push_back(victim);
+                continue;
+            }
+            victim->engine->unload();
+        }
+
+        LOGI("Evicted %s (%llu MiB)", victim->weights_path.c_str(),
+             static_cast<unsigned long long>((victim->weights_bytes + victim->context_bytes) >> 20));
+        victim->resident = false;
+        victim->weights = nullptr;
+        ++evictions_;
+    }
+}
+
+void ResidencyManager::make_room(Engine& engine, std::string_view model_path) {
+    std::lock_guard lock(mutex_);
+    Entry* entry = find_locked(engine);
+
+    uint64_t incoming = entry ? entry->context_bytes : 0;
+    if (!weights_shared_locked(model_path, entry)) {
+        std::error_code ec;
+        const auto file_bytes = std::filesystem::file_size(model_path, ec);
+        incoming += ec ? 0 : file_bytes;
+    }
+    trim_locked(incoming, engine, false);
+}
+
+void ResidencyManager::loaded(Engine& engine) {
+    std::lock_guard lock(mutex_);
+    Entry* entry = find_locked(engine);
+    if (!entry) {
+        return;
+    }
+
+    entry->weights_path = engine.weights->path;
+    entry->weights = engine.weights.get();
+    entry->weights_bytes = llama_model_size(engine.model) + engine.weights->adapter_bytes();
+    entry->context_bytes = context_bytes(engine);
+    entry->resident = true;
+    entry->released = false;
+    entry->last_used = ++tick_;
+
+    trim_locked(0, engine, false);
+}
+
+void ResidencyManager::unloaded(Engine& engine) {
+    std::lock_guard lock(mutex_);
+    if (Entry* entry = find_locked(engine)) {
+        entry->resident = false;
+        entry->weights = nullptr;
+    }
+}
+
+[[nodiscard]] bool ResidencyManager::ensure_resident(Engine& engine) {
+    if (!engine.is_available()) {
+        return false;
+    }
+    // Pressure has passed: the reload below rebuilds the context at full size
+    restore_relieved_context(engine);
+
+    if (engine.is_ready()) {
+        std::lock_guard lock(mutex_);
+        if (Entry* entry = find_locked(engine)) {
+            entry->last_used = ++tick_;
+        }
+        return true;
+    }
+
+    LOGI("Reloading evicted model: %s", engine.model_path.c_str());
+    // load() overwrites the members these would alias
+    const std::string path = engine.model_path;
+    const std::string grammar = engine.grammar_text;
+    if (!engine.load(path, grammar)) {
+        return false;
+    }
+
+    std::lock_guard lock(mutex_);
+    ++reloads_;
+    return true;
+}
+
+void ResidencyManager::release(Engine& engine) {
+    engine.released = true;
+
+    std::lock_guard lock(mutex_);
+    Entry* entry = find_locked(engine);
+    if (!entry || !entry->resident) {
+        return;
+    }
+    entry->released = true;
+    trim_locked(0, engine, true);
+}
+
+[[nodiscard]] ResidencyStats ResidencyManager::stats() {
+    std::lock_guard lock(mutex_);
+    ResidencyStats stats{
+        .budget_bytes = budget_,
+        .resident_bytes = resident_bytes_locked(),
+        .engines = static_cast<uint32_t>(entries_.size()),
+        .resident_engines = 0,
+        .evictions = evictions_,
+        .reloads = reloads_,
+    };
+    for (const Entry& e : entries_) {
+        stats.resident_engines += e.resident ? 1 : 0;
+    }
+    return stats;
+}
+
+std::size_t ResidencyManager::for_each_idle(const std::function<void(Engine&)>& fn) {
+    std::lock_guard lock(mutex_);
+    std::size_t busy = 0;
+    for (Entry& e : entries_) {
+        std::unique_lock engine_lock(e.engine->mutex, std::try_to_lock);
+        if (!engine_lock) {
+            ++busy;
+            continue;
+        }
+        fn(*e.engine);
+        if (e.resident) {
+            // A released context is rebuilt by the next load(), which records it again
+            e.context_bytes = e.engine->ctx ? context_bytes(*e.engine) : 0;
+        }
+    }
+    return busy;
+}
+
+[[nodiscard]] std::vector<EngineMemory> ResidencyManager::memory() {
+    std::vector<EngineMemory> engines;
+    {
+        std::lock_guard lock(mutex_);
+        for (const Entry& e : entries_) {
+            if (e.weights_path.empty()) continue;  // never loaded
+            EngineMemory& m = engines.emplace_back();
+            m.model_path = e.weights_path;
+            m.resident = e.resident;
+            if (!e.resident) continue;
+
+            // ~Engine untracks under mutex_ first, so the engine outlives this
+            std::shared_lock engine_lock(e.engine->mutex, std::try_to_lock);
+            if (!engine_lock || !e.engine->is_ready()) {
+                m.busy = true;
+                m.weights_bytes = e.weights_bytes;
+                m.context_bytes = e.context_bytes;
+                continue;
+            }
+            fill_engine_memory(*e.engine, m);
+        }
+    }
+
+    // smaps is read outside the locks, once per weights file
+    for (std::size_t i = 0; i < engines.size(); ++i) {
+        EngineMemory& m = engines[i];
+        if (!m.resident) continue;
+        const auto shared = std::find_if(engines.begin(), engines.begin() + static_cast<std::ptrdiff_t>(i),
+            [&](const EngineMemory& other) { return other.resident && other.model_path == m.model_path; });
+        if (shared != engines.begin() + static_cast<std::ptrdiff_t>(i)) {
+            m.mapped_bytes = shared->mapped_bytes;
+            m.mapped_resident_bytes = shared->mapped_resident_bytes;
+            continue;
+        }
+        const MappingUsage usage = file_mapping_usage(m.model_path);
+        m.mapped_bytes = usage.mapped_bytes;
+        m.mapped_resident_bytes = usage.resident_bytes;
+    }
+    return engines;
+}
+
+[[nodiscard]] ResidencyManager& residency() {
+    static ResidencyManager manager;
+    return manager;
+}
+
+} // namespace sentinel_native
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sentinel_native {
+
+struct Engine;
+struct EngineMemory;
+struct ModelWeights;
+
+struct ResidencyStats {
+    uint64_t budget_bytes;    // 0 = unlimited
+    uint64_t resident_bytes;  // shared weights counted once
+    uint32_t engines;
+    uint32_t resident_engines;
+    uint64_t evictions;
+    uint64_t reloads;
+};
+
+/**
+ * Keeps loaded engines within a byte budget.
+ *
+ * Each engine's footprint is its weights (mmap plus loaded LoRA adapters,
+ * shared weights counted once) plus its context (heap measured at creation,
+ * at least the KV cache estimate). When a load would exceed the
+ * budget, resident engines are evicted least recently used first, released
+ * engines before live ones. Eviction keeps the engine's path and settings,
+ * so its next request reloads it transparently.
+ *
+ * Lock order: an engine mutex, then the manager mutex. Other engines are
+ * only ever try_lock'ed from inside the manager, so a busy engine is
+ * skipped rather than waited on. A thread that locks a second engine while
+ * holding one marks the first with a Held scope: try_lock on a mutex the
+ * thread already owns is undefined, so trims never pick it.
+ */
+class ResidencyManager {
+public:
+    // Keeps `engine`, locked by this thread, out of trims this thread runs
+    // while the scope lives (a request reloading the embedding engine)
+    class Held {
+    public:
+        explicit Held(const Engine& engine);
+        ~Held();
+
+        Held(const Held&) = delete;
+        Held& operator=(const Held&) = delete;
+    };
+
+    // Defaults to half of physical memory
+    ResidencyManager();
+
+    void set_budget(uint64_t bytes);
+
+    void track(Engine& engine);
+    void untrack(Engine& engine);
+
+    // Caller holds engine.mutex exclusively for all of the below
+
+    // Evict other engines so loading `model_path` into `engine` fits
+    void make_room(Engine& engine, std::string_view model_path);
+
+    // Record a fresh load or a grown footprint (new adapter), then trim
+    // other engines back under budget
+    void loaded(Engine& engine);
+
+    // Record that the engine freed its context and weights share
+    void unloaded(Engine& engine);
+
+    // Reload an evicted engine if needed; false if it has nothing to load
+    [[nodiscard]] bool ensure_resident(Engine& engine);
+
+    // releaseModel: keep the engine only while the budget allows
+    void release(Engine& engine);
+
+    [[nodiscard]] ResidencyStats stats();
+
+    // Run `fn` on every engine that is idle, holding its mutex exclusively;
+    // busy engines are skipped. Context sizes are re-read afterwards. `fn` runs under the manager mutex and must not call back
+    // into the manager (Engine::release_compute doesn't).
+    // @return number of engines skipped as busy
+    std::size_t for_each_idle(const std::function<void(Engine&)>& fn);
+
+    // Footprint of every engine that has loaded a model. Engines busy with
+    // a request are not waited for; they report residency figures only.
+    [[nodiscard]] std::vector<EngineMemory> memory();
+
+private:
+    struct Entry {
+        Engine* engine = nullptr;
+        uint64_t last_used = 0;
+        std::string weights_path;
+        const ModelWeights* weights = nullptr;  // identity only, for dedup
+        uint64_t weights_bytes = 0;
+        uint64_t context_bytes = 0;  // kept after eviction to size the reload
+        bool resident = false;
+        bool released = false;
+    };
+
+    [[nodiscard]] Entry* find_locked(const Engine& engine);
+    [[nodiscard]] uint64_t resident_bytes_locked() const;
+    [[nodiscard]] bool weights_shared_locked(std::string_view path, const Entry* except) const;
+
+    // Evict until `incoming` more bytes fit. `held` is locked by the caller
+    // and is only evicted when `evict_held` is set; engines in a Held scope
+    // of this thread never are.
+    void trim_locked(uint64_t incoming, Engine& held, bool evict_held);
+
+    std::mutex mutex_;
+    std::vector<Entry> entries_;
+    uint64_t budget_ = 0;
+    uint64_t tick_ = 0;
+    uint64_t evictions_ = 0;
+    uint64_t reloads_ = 0;
+};
+
+[[nodiscard]] ResidencyManager& residency();
+
+} // namespace sentinel_native
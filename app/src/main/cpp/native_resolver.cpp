@@ -0,0 +1,232 @@
+#include "native_resolver.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+
+#include "native_utils.hpp"
+
+namespace sentinel_native {
+
+std::mutex g_resolver_mutex;
+TargetResolver g_target_resolver;
+
+namespace {
+
+constexpr float SCORE_EXACT = 1.0f;
+constexpr float SCORE_NORMALIZED = 0.95f;
+constexpr float SCORE_SUBSTRING_BASE = 0.7f;
+// Shorter sides get no substring credit: "a" is in "camera" by accident
+constexpr std::size_t SUBSTRING_MIN_BYTES = 3;
+constexpr float SCORE_EDIT_MAX = 0.9f;
+constexpr float SCORE_TRIGRAM_MAX = 0.6f;
+
+[[nodiscard]] constexpr uint32_t trigram_at(std::string_view s, std::size_t i) noexcept {
+    return static_cast<uint32_t>(static_cast<unsigned char>(s[i])) << 16 |
+           static_cast<uint32_t>(static_cast<unsigned char>(s[i + 1])) << 8 |
+           static_cast<uint32_t>(static_cast<unsigned char>(s[i + 2]));
+}
+
+// Distinct trigrams of s, sorted
+void trigrams_of(std::string_view s, std::vector<uint32_t>& out) {
+    out.clear();
+    for (std::size_t i = 0; i + 3 <= s.size(); ++i) {
+        out.push_back(trigram_at(s, i));
+    }
+    std::ranges::sort(out);
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+} // namespace
+
+[[nodiscard]] uint32_t myers_distance(std::string_view pattern, std::string_view text, uint32_t bound) {
+    const std::size_t m = pattern.size();
+    if (m == 0) return static_cast<uint32_t>(text.size());
+
+    std::array<uint64_t, 256> peq{};
+    for (std::size_t i = 0; i < m; ++i) {
+        peq[static_cast<unsigned char>(pattern[i])] |= uint64_t{1} << i;
+    }
+
+    const uint64_t high = uint64_t{1} << (m - 1);
+    uint64_t pv = m == 64 ? ~uint64_t{0} : (uint64_t{1} << m) - 1;
+    uint64_t mv = 0;
+    uint32_t score = static_cast<uint32_t>(m);
+
+    for (std::size_t j = 0; j < text.size(); ++j) {
+        const uint64_t eq = peq[static_cast<unsigned char>(text[j])];
+        const uint64_t xv = eq | mv;
+        const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if (ph & high) {
+            ++score;
+        } else if (mh & high) {
+            --score;
+        }
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+
+        // Each remaining text byte lowers the last row by at most one
+        const std::size_t remaining = text.size() - j - 1;
+        if (score > bound + remaining) {
+            return bound + 1;
+        }
+    }
+    return score;
+}
+
+[[nodiscard]] uint32_t dp_distance(std::string_view a, std::string_view b, std::vector<uint32_t>& row) {
+    row.resize(b.size() + 1);
+    for (std::size_t j = 0; j <= b.size(); ++j) row[j] = static_cast<uint32_t>(j);
+    for (std::size_t i = 1; i <= a.size(); ++i) {
+        uint32_t diag = row[0];
+        row[0] = static_cast<uint32_t>(i);
+        for (std::size_t j = 1; j <= b.size(); ++j) {
+            const uint32_t up = row[j];
+            row[j] = std::min({row[j] + 1, row[j - 1] + 1, diag + (a[i - 1] != b[j - 1] ? 1u : 0u)});
+            diag = up;
+        }
+    }
+    return row[b.size()];
+}
+
+void TargetResolver::load(const ScreenSnapshot& snapshot) {
+    entries_.clear();
+    raw_.clear();
+    norm_.clear();
+    trigrams_.clear();
+
+    std::pmr::string label;
+    std::string normalized;
+    std::vector<uint32_t> grams;
+    for (std::size_t i = 0; i < snapshot.size(); ++i) {
+        const auto element = snapshot.element(i);
+
+        label.clear();
+        append_label(element.label, label);
+        normalize_text(label, normalized);
+
+        const auto index = static_cast<uint32_t>(entries_.size());
+        entries_.push_back({
+            .id = element.id,
+            .raw_offset = static_cast<uint32_t>(raw_.size()),
+            .raw_length = static_cast<uint32_t>(label.size()),
+            .norm_offset = static_cast<uint32_t>(norm_.size()),
+            .norm_length = static_cast<uint32_t>(normalized.size()),
+        });
+        raw_ += label;
+        norm_ += normalized;
+
+        trigrams_of(normalized, grams);
+        for (uint32_t g : grams) {
+            trigrams_.emplace_back(g, index);
+        }
+    }
+    std::ranges::sort(trigrams_);
+}
+
+[[nodiscard]] float TargetResolver::fuzzy_score(
+    std::string_view target,
+    std::string_view label,
+    uint32_t shared_trigrams,
+    uint32_t target_trigrams
+) {
+    if (label.empty()) return 0.0f;
+
+    float best = 0.0f;
+    const auto tlen = static_cast<float>(target.size());
+    const auto llen = static_cast<float>(label.size());
+
+    // "settings" in "wi fi settings", or "search messages" for "search"
+    if (std::min(target.size(), label.size()) >= SUBSTRING_MIN_BYTES &&
+        (label.find(target) != std::string_view::npos || target.find(label) != std::string_view::npos)) {
+        best = SCORE_SUBSTRING_BASE + 0.2f * std::min(tlen, llen) / std::max(tlen, llen);
+    }
+
+    // Typos and near-misses: allow roughly one edit per three bytes
+    const auto bound = static_cast<uint32_t>(std::max<std::size_t>(1, target.size() / 3));
+    const std::size_t diff = target.size() > label.size() ? target.size() - label.size() : label.size() - target.size();
+    if (diff <= bound) {
+        const uint32_t d = target.size() <= 64 ? myers_distance(target, label, bound) : dp_distance(target, label, dp_);
+        if (d <= bound) {
+            best = std::max(best, SCORE_EDIT_MAX * (1.0f - static_cast<float>(d) / std::max(tlen, llen)));
+        }
+    }
+
+    // Word reordering and partial overlap (Dice coefficient on trigrams)
+    if (target_trigrams > 0 && shared_trigrams > 0) {
+        const std::size_t label_trigrams = label.size() >= 3 ? label.size() - 2 : 0;
+        const float dice = 2.0f * shared_trigrams / static_cast<float>(target_trigrams + label_trigrams);
+        best = std::max(best, SCORE_TRIGRAM_MAX * std::min(dice, 1.0f));
+    }
+    return best;
+}
+
+[[nodiscard]] std::size_t TargetResolver::resolve(std::string_view target, std::span<TargetMatch> out) {
+    if (out.empty() || entries_.empty()) {
+        return 0;
+    }
+
+    while (!target.empty() && (target.front() == ' ' || target.front() == '"')) target.remove_prefix(1);
+    while (!target.empty() && (target.back() == ' ' || target.back() == '"')) target.remove_suffix(1);
+    matches_.clear();
+
+    // The model often answers with the element id itself
+    int32_t id = 0;
+    auto [end, ec] = std::from_chars(target.data(), target.data() + target.size(), id);
+    if (ec == std::errc{} && end == target.data() + target.size()) {
+        for (const auto& e : entries_) {
+            if (e.id == id) {
+                out[0] = {id, SCORE_EXACT};
+                return 1;
+            }
+        }
+    }
+
+    normalize_text(target, target_norm_);
+    if (target_norm_.empty()) {
+        return 0;
+    }
+
+    for (const auto& e : entries_) {
+        if (raw(e) == target) {
+            matches_.push_back({e.id, SCORE_EXACT});
+        } else if (norm(e) == target_norm_) {
+            matches_.push_back({e.id, SCORE_NORMALIZED});
+        }
+    }
+
+    if (matches_.empty()) {
+        // Candidates share at least one trigram; short targets scan everything
+        shared_.assign(entries_.size(), 0);
+        trigrams_of(target_norm_, target_trigrams_);
+        for (uint32_t g : target_trigrams_) {
+            auto range = std::ranges::equal_range(trigrams_, g, {}, &std::pair<uint32_t, uint32_t>::first);
+            for (const auto& [gram, index] : range) {
+                ++shared_[index];
+            }
+        }
+
+        const bool scan_all = target_trigrams_.empty();
+        const auto n_trigrams = static_cast<uint32_t>(target_trigrams_.size());
+        for (std::size_t i = 0; i < entries_.size(); ++i) {
+            if (!scan_all && shared_[i] == 0) continue;
+            const float score = fuzzy_score(target_norm_, norm(entries_[i]), shared_[i], n_trigrams);
+            if (score >= RESOLVE_MIN_SCORE) {
+                matches_.push_back({entries_[i].id, score});
+            }
+        }
+    }
+
+    // Stable: equal scores keep document order
+    std::ranges::stable_sort(matches_, std::greater<>{}, &TargetMatch::score);
+
+    const std::size_t n = std::min(out.size(), matches_.size());
+    std::copy_n(matches_.begin(), n, out.begin());
+    return n;
+}
+
+} // namespace sentinel_native
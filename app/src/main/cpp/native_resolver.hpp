@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "native_snapshot.hpp"
+
+namespace sentinel_native {
+
+struct TargetMatch {
+    int32_t id;
+    float score;  // 1.0 = exact label or id
+};
+
+// Matches scoring below this are not reported
+inline constexpr float RESOLVE_MIN_SCORE = 0.5f;
+
+/**
+ * Maps the model's free-text `target` to element ids of the current
+ * screen. Tried in order of confidence: a literal element id, exact label,
+ * normalized label (case, punctuation, whitespace), substring (both sides
+ * at least 3 bytes), then a bounded Levenshtein distance over candidates
+ * sharing a trigram with the target (bit-parallel, Myers/Hyyrö, one 64-bit
+ * word per label).
+ *
+ * Separate from the engine mutexes so resolving never waits on inference.
+ */
+class TargetResolver {
+public:
+    // Replace the element set; labels are copied
+    void load(const ScreenSnapshot& snapshot);
+
+    /**
+     * Fill `out` with the best matches, highest score first.
+     * @return number of matches written
+     */
+    [[nodiscard]] std::size_t resolve(std::string_view target, std::span<TargetMatch> out);
+
+    [[nodiscard]] std::size_t size() const noexcept { return entries_.size(); }
+
+    // Heap bytes of the element set and its trigram index
+    [[nodiscard]] std::size_t memory_bytes() const noexcept {
+        return entries_.capacity() * sizeof(Entry) + raw_.capacity() + norm_.capacity() +
+               trigrams_.capacity() * sizeof(trigrams_[0]) + target_norm_.capacity() +
+               (target_trigrams_.capacity() + dp_.capacity()) * sizeof(uint32_t) +
+               shared_.capacity() * sizeof(uint16_t) + matches_.capacity() * sizeof(TargetMatch);
+    }
+
+private:
+    struct Entry {
+        int32_t id;
+        uint32_t raw_offset;
+        uint32_t raw_length;
+        uint32_t norm_offset;
+        uint32_t norm_length;
+    };
+
+    [[nodiscard]] std::string_view raw(const Entry& e) const noexcept {
+        return std::string_view(raw_).substr(e.raw_offset, e.raw_length);
+    }
+    [[nodiscard]] std::string_view norm(const Entry& e) const noexcept {
+        return std::string_view(norm_).substr(e.norm_offset, e.norm_length);
+    }
+
+    [[nodiscard]] float fuzzy_score(std::string_view target, std::string_view label, uint32_t shared_trigrams,
+                                    uint32_t target_trigrams);
+
+    std::vector<Entry> entries_;
+    std::string raw_;   // sanitized labels
+    std::string norm_;  // normalized labels
+    std::vector<std::pair<uint32_t, uint32_t>> trigrams_;  // (trigram, entry), sorted
+
+    // Scratch reused across calls
+    std::string target_norm_;
+    std::vector<uint32_t> target_trigrams_;
+    std::vector<uint16_t> shared_;
+    std::vector<TargetMatch> matches_;
+    std::vector<uint32_t> dp_;
+};
+
+/**
+ * Levenshtein distance with pattern.size() <= 64, one bit per pattern
+ * position (Myers 1999, global-distance form from Hyyrö 2001). Stops
+ * early and returns bound + 1 once the distance provably exceeds bound.
+ */
+[[nodiscard]] uint32_t myers_distance(std::string_view pattern, std::string_view text, uint32_t bound);
+
+// Two-row DP for patterns too long for one machine word; `row` is scratch
+[[nodiscard]] uint32_t dp_distance(std::string_view a, std::string_view b, std::vector<uint32_t>& row);
+
+extern std::mutex g_resolver_mutex;
+extern TargetResolver g_target_resolver;
+
+} // namespace sentinel_native
@@ -0,0 +1,360 @@
+#include "native_router.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+
+#include "native_logging.hpp"
+
+namespace sentinel_native {
+
+IntentRouter g_intent_router;
+
+namespace {
+
+// Longest query considered; anything longer is not a trivial command
+constexpr std::size_t MAX_QUERY_BYTES = 160;
+
+struct Phrase {
+    std::string_view text;
+    RouteIntent intent;
+};
+
+// Normalized (lowercase, fillers removed) commands that need no model
+constexpr Phrase PHRASES[] = {
+    {"back", RouteIntent::Back},
+    {"go back", RouteIntent::Back},
+    {"navigate back", RouteIntent::Back},
+    {"go to previous screen", RouteIntent::Back},
+    {"previous screen", RouteIntent::Back},
+    {"home", RouteIntent::Home},
+    {"go home", RouteIntent::Home},
+    {"go to home", RouteIntent::Home},
+    {"go to home screen", RouteIntent::Home},
+    {"go to homescreen", RouteIntent::Home},
+    {"home screen", RouteIntent::Home},
+    {"scroll up", RouteIntent::ScrollUp},
+    {"page up", RouteIntent::ScrollUp},
+    {"scroll down", RouteIntent::ScrollDown},
+    {"page down", RouteIntent::ScrollDown},
+    {"scroll", RouteIntent::ScrollDown},
+    {"scroll left", RouteIntent::ScrollLeft},
+    {"scroll right", RouteIntent::ScrollRight},
+    {"wait", RouteIntent::Wait},
+    {"hold on", RouteIntent::Wait},
+    {"wait a second", RouteIntent::Wait},
+    {"wait a moment", RouteIntent::Wait},
+};
+
+// Politeness words dropped before phrase lookup
+constexpr std::string_view FILLERS[] = {
+    "please", "can", "could", "would", "will", "you", "just", "now", "hey", "kindly", "for", "me",
+};
+
+// Any of these means the command is not the plain action
+constexpr std::string_view NEGATIONS[] = {
+    "not", "dont", "never", "stop", "cant", "cannot",
+};
+
+constexpr std::string_view INTENT_NAMES[ROUTE_INTENTS] = {
+    "NONE", "BACK", "HOME", "SCROLL_UP", "SCROLL_DOWN", "SCROLL_LEFT", "SCROLL_RIGHT", "WAIT",
+};
+
+constexpr std::string_view INTENT_FIELDS[ROUTE_INTENTS] = {
+    R"("action":"NONE")",
+    R"("action":"BACK")",
+    R"("action":"HOME")",
+    R"("action":"SCROLL","direction":"UP")",
+    R"("action":"SCROLL","direction":"DOWN")",
+    R"("action":"SCROLL","direction":"LEFT")",
+    R"("action":"SCROLL","direction":"RIGHT")",
+    R"("action":"WAIT")",
+};
+
+template <std::size_t N>
+[[nodiscard]] constexpr bool contains(const std::string_view (&list)[N], std::string_view word) noexcept {
+    return std::find(std::begin(list), std::end(list), word) != std::end(list);
+}
+
+// FNV-1a over a kind tag and up to two words
+[[nodiscard]] constexpr uint32_t feature_hash(char kind, std::string_view a, std::string_view b = {}) noexcept {
+    uint32_t h = 2166136261u;
+    auto mix = [&h](char c) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 16777619u;
+    };
+    mix(kind);
+    for (char c : a) mix(c);
+    mix(' ');
+    for (char c : b) mix(c);
+    return h;
+}
+
+[[nodiscard]] std::optional<RouteIntent> intent_from_name(std::string_view name) noexcept {
+    for (std::size_t i = 0; i < ROUTE_INTENTS; ++i) {
+        if (INTENT_NAMES[i] == name) {
+            return static_cast<RouteIntent>(i);
+        }
+    }
+    return std::nullopt;
+}
+
+// Splits on whitespace; views stay valid while `line` does
+[[nodiscard]] std::vector<std::string_view> fields_of(std::string_view line) {
+    std::vector<std::string_view> fields;
+    std::size_t i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) ++i;
+        const std::size_t start = i;
+        while (i < line.size() && line[i] != ' ' && line[i] != '\t' && line[i] != '\r') ++i;
+        if (i > start) fields.push_back(line.substr(start, i - start));
+    }
+    return fields;
+}
+
+[[nodiscard]] std::optional<float> parse_float(std::string_view text) {
+    std::string buffer(text);
+    char* end = nullptr;
+    const float value = std::strtof(buffer.c_str(), &end);
+    if (end != buffer.c_str() + buffer.size() || !std::isfinite(value)) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+[[nodiscard]] std::optional<uint32_t> parse_uint(std::string_view text) {
+    uint32_t value = 0;
+    if (text.empty() || text.size() > 9) return std::nullopt;
+    for (char c : text) {
+        if (c < '0' || c > '9') return std::nullopt;
+        value = value * 10 + static_cast<uint32_t>(c - '0');
+    }
+    return value;
+}
+
+} // namespace
+
+[[nodiscard]] bool IntentRouter::load_model(const std::string& path, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "Cannot open " + path;
+        return false;
+    }
+
+    Model model;
+    std::optional<float> threshold;
+    std::array<std::size_t, ROUTE_INTENTS> rows{};  // file class index -> intent
+    std::size_t n_classes = 0;
+    bool has_bias = false;
+
+    std::string line;
+    std::size_t line_no = 0;
+    auto fail = [&](std::string_view what) {
+        error = std::string(what) + " at line " + std::to_string(line_no);
+        return false;
+    };
+
+    while (std::getline(in, line)) {
+        ++line_no;
+        const auto f = fields_of(line);
+        if (f.empty() || f[0].starts_with('#')) continue;
+
+        if (f[0] == "dim" && f.size() == 2) {
+            auto dim = parse_uint(f[1]);
+            if (!dim || !std::has_single_bit(*dim) || *dim > (1u << 20)) return fail("dim must be a power of two");
+            model.dim = *dim;
+            model.weights.assign(ROUTE_INTENTS * model.dim, 0.0f);
+        } else if (f[0] == "threshold" && f.size() == 2) {
+            threshold = parse_float(f[1]);
+            if (!threshold) return fail("Bad threshold");
+        } else if (f[0] == "classes") {
+            n_classes = f.size() - 1;
+            if (n_classes == 0 || n_classes > ROUTE_INTENTS) return fail("Bad class list");
+            for (std::size_t i = 0; i < n_classes; ++i) {
+                auto intent = intent_from_name(f[i + 1]);
+                if (!intent) return fail("Unknown class");
+                rows[i] = static_cast<std::size_t>(*intent);
+            }
+        } else if (f[0] == "bias") {
+            if (f.size() != n_classes + 1) return fail("bias needs one value per class");
+            for (std::size_t i = 0; i < n_classes; ++i) {
+                auto value = parse_float(f[i + 1]);
+                if (!value) return fail("Bad bias");
+                model.bias[rows[i]] = *value;
+            }
+            has_bias = true;
+        } else if (f[0] == "w" && f.size() == 4) {
+            auto cls = parse_uint(f[1]);
+            auto bucket = parse_uint(f[2]);
+            auto value = parse_float(f[3]);
+            if (model.dim == 0 || n_classes == 0) return fail("w before dim/classes");
+            if (!cls || *cls >= n_classes || !bucket || *bucket >= model.dim || !value) return fail("Bad weight");
+            model.weights[rows[*cls] * model.dim + *bucket] = *value;
+        } else {
+            return fail("Unknown directive");
+        }
+    }
+
+    if (model.dim == 0 || n_classes == 0 || !has_bias) {
+        error = "Missing dim, classes or bias";
+        return false;
+    }
+    // Classes absent from the file can never win
+    for (std::size_t i = 0; i < ROUTE_INTENTS; ++i) {
+        if (std::find(rows.begin(), rows.begin() + n_classes, i) == rows.begin() + n_classes) {
+            model.bias[i] = -INFINITY;
+        }
+    }
+
+    {
+        std::unique_lock lock(model_mutex_);
+        model_ = std::move(model);
+    }
+    if (threshold) {
+        set_threshold(*threshold);
+    }
+    LOGI("Router model loaded: %s (%zu classes)", path.c_str(), n_classes);
+    return true;
+}
+
+[[nodiscard]] bool IntentRouter::has_model() const {
+    std::shared_lock lock(model_mutex_);
+    return model_.has_value();
+}
+
+[[nodiscard]] std::size_t IntentRouter::memory_bytes() const {
+    std::shared_lock lock(model_mutex_);
+    return model_ ? sizeof(Model) + model_->weights.capacity() * sizeof(float) : 0;
+}
+
+[[nodiscard]] std::optional<Route> IntentRouter::route(std::string_view query) {
+    if (!enabled_.load(std::memory_order_relaxed)) {
+        return std::nullopt;
+    }
+    queries_.fetch_add(1, std::memory_order_relaxed);
+    if (query.size() > MAX_QUERY_BYTES) {
+        return std::nullopt;
+    }
+
+    // Lowercase words of [a-z0-9'] with everything else as separators
+    char text[MAX_QUERY_BYTES];
+    std::array<std::string_view, ROUTER_MAX_WORDS + 1> words;
+    std::size_t n_words = 0;
+    std::size_t len = 0;
+    std::size_t start = 0;
+    auto end_word = [&] {
+        if (len > start) {
+            if (n_words < words.size()) words[n_words] = {text + start, len - start};
+            ++n_words;
+        }
+        start = len;
+    };
+    for (char c : query) {
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        if (c >= '0' && c <= '9') {
+            return std::nullopt;  // counts, positions: needs the model
+        }
+        if (c >= 'a' && c <= 'z') {
+            text[len++] = c;
+        } else if (c == '\'') {
+            continue;  // "don't" -> "dont"
+        } else {
+            end_word();
+        }
+    }
+    end_word();
+    if (n_words == 0 || n_words > ROUTER_MAX_WORDS) {
+        return std::nullopt;
+    }
+    const std::span<const std::string_view> all(words.data(), n_words);
+    if (std::any_of(all.begin(), all.end(), [](std::string_view w) { return contains(NEGATIONS, w); })) {
+        return std::nullopt;
+    }
+
+    // Stage 1: exact phrase
+    char phrase[MAX_QUERY_BYTES + ROUTER_MAX_WORDS];
+    std::size_t phrase_len = 0;
+    for (std::string_view w : all) {
+        if (contains(FILLERS, w)) continue;
+        if (phrase_len) phrase[phrase_len++] = ' ';
+        std::copy(w.begin(), w.end(), phrase + phrase_len);
+        phrase_len += w.size();
+    }
+    const std::string_view normalized(phrase, phrase_len);
+    for (const Phrase& p : PHRASES) {
+        if (p.text == normalized) {
+            exact_hits_.fetch_add(1, std::memory_order_relaxed);
+            by_intent_[static_cast<std::size_t>(p.intent)].fetch_add(1, std::memory_order_relaxed);
+            return Route{p.intent, 1.0f, true};
+        }
+    }
+
+    // Stage 2: logistic model
+    auto route = classify(all);
+    if (route) {
+        model_hits_.fetch_add(1, std::memory_order_relaxed);
+        by_intent_[static_cast<std::size_t>(route->intent)].fetch_add(1, std::memory_order_relaxed);
+    }
+    return route;
+}
+
+[[nodiscard]] std::optional<Route> IntentRouter::classify(std::span<const std::string_view> words) const {
+    std::shared_lock lock(model_mutex_);
+    if (!model_) {
+        return std::nullopt;
+    }
+    const Model& m = *model_;
+    const uint32_t mask = m.dim - 1;
+
+    std::array<float, ROUTE_INTENTS> z = m.bias;
+    auto add = [&](uint32_t hash) {
+        const uint32_t bucket = hash & mask;
+        for (std::size_t c = 0; c < ROUTE_INTENTS; ++c) {
+            z[c] += m.weights[c * m.dim + bucket];
+        }
+    };
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        add(feature_hash('u', words[i]));
+        add(feature_hash('b', i == 0 ? "^" : words[i - 1], words[i]));
+    }
+    add(feature_hash('b', words.back(), "$"));
+
+    const auto best = static_cast<std::size_t>(std::max_element(z.begin(), z.end()) - z.begin());
+    float sum = 0.0f;
+    for (float v : z) {
+        sum += std::exp(v - z[best]);
+    }
+    const float p = 1.0f / sum;
+
+    if (best == static_cast<std::size_t>(RouteIntent::Fallthrough) ||
+        p < threshold_.load(std::memory_order_relaxed)) {
+        return std::nullopt;
+    }
+    return Route{static_cast<RouteIntent>(best), p, false};
+}
+
+[[nodiscard]] RouterStats IntentRouter::stats() const noexcept {
+    RouterStats s{
+        .queries = queries_.load(std::memory_order_relaxed),
+        .exact_hits = exact_hits_.load(std::memory_order_relaxed),
+        .model_hits = model_hits_.load(std::memory_order_relaxed),
+        .by_intent = {},
+    };
+    for (std::size_t i = 0; i < ROUTE_INTENTS; ++i) {
+        s.by_intent[i] = by_intent_[i].load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+[[nodiscard]] std::string_view route_action_fields(RouteIntent intent) noexcept {
+    return INTENT_FIELDS[static_cast<std::size_t>(intent)];
+}
+
+[[nodiscard]] std::string_view route_intent_name(RouteIntent intent) noexcept {
+    return INTENT_NAMES[static_cast<std::size_t>(intent)];
+}
+
+} // namespace sentinel_native
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sentinel_native {
+
+// Actions the router can answer without the model. Fallthrough is the
+// model's "not mine" class and is never returned as a route.
+enum class RouteIntent : uint8_t {
+    Fallthrough,
+    Back,
+    Home,
+    ScrollUp,
+    ScrollDown,
+    ScrollLeft,
+    ScrollRight,
+    Wait,
+    Count
+};
+
+inline constexpr std::size_t ROUTE_INTENTS = static_cast<std::size_t>(RouteIntent::Count);
+
+// Default confidence a model route needs; exact phrases always route
+inline constexpr float ROUTER_DEFAULT_THRESHOLD = 0.9f;
+
+// Longer queries carry detail (targets, text) only the LLM can act on
+inline constexpr std::size_t ROUTER_MAX_WORDS = 8;
+
+struct Route {
+    RouteIntent intent;
+    float confidence;
+    bool exact;  // matched a built-in phrase rather than the model
+};
+
+struct RouterStats {
+    uint64_t queries;
+    uint64_t exact_hits;
+    uint64_t model_hits;
+    std::array<uint64_t, ROUTE_INTENTS> by_intent;
+};
+
+/**
+ * Fast path in front of inference for trivial commands ("go back",
+ * "scroll down a bit"). Two stages, both allocation-free per query:
+ *
+ *   1. Exact match of the normalized query, fillers ("please", "can you")
+ *      removed, against a built-in phrase table.
+ *   2. A multinomial logistic model over hashed word unigram and bigram
+ *      features, loaded from a file (see load_model). It routes when its
+ *      top class is not Fallthrough and clears the threshold.
+ *
+ * Queries with digits, negations or more than ROUTER_MAX_WORDS words always
+ * fall through. route() is thread-safe; counters are relaxed atomics.
+ */
+class IntentRouter {
+public:
+    /**
+     * Text format, one directive per line, '#' comments:
+     *
+     *   dim 1024                         feature buckets (power of two)
+     *   threshold 0.9                    optional
+     *   classes NONE BACK HOME ...       class order of bias/w rows
+     *   bias <one float per class>
+     *   w <class> <bucket> <weight>      sparse weights, repeatable
+     *
+     * Class names: NONE, BACK, HOME, SCROLL_UP, SCROLL_DOWN, SCROLL_LEFT,
+     * SCROLL_RIGHT, WAIT. Replaces any loaded model on success.
+     */
+    [[nodiscard]] bool load_model(const std::string& path, std::string& error);
+
+    [[nodiscard]] std::optional<Route> route(std::string_view query);
+
+    void set_enabled(bool enabled) noexcept { enabled_.store(enabled, std::memory_order_relaxed); }
+    void set_threshold(float threshold) noexcept { threshold_.store(threshold, std::memory_order_relaxed); }
+
+    [[nodiscard]] bool has_model() const;
+    // Bytes of the loaded classifier weights
+    [[nodiscard]] std::size_t memory_bytes() const;
+    [[nodiscard]] RouterStats stats() const noexcept;
+
+private:
+    struct Model {
+        uint32_t dim = 0;  // power of two
+        std::array<float, ROUTE_INTENTS> bias{};
+        std::vector<float> weights;  // [intent][dim]
+    };
+
+    [[nodiscard]] std::optional<Route> classify(std::span<const std::string_view> words) const;
+
+    mutable std::shared_mutex model_mutex_;
+    std::optional<Model> model_;
+
+    std::atomic<bool> enabled_{true};
+    std::atomic<float> threshold_{ROUTER_DEFAULT_THRESHOLD};
+
+    std::atomic<uint64_t> queries_{0};
+    std::atomic<uint64_t> exact_hits_{0};
+    std::atomic<uint64_t> model_hits_{0};
+    std::array<std::atomic<uint64_t>, ROUTE_INTENTS> by_intent_{};
+};
+
+// Action fields of a route (`"action":"SCROLL","direction":"DOWN"`), to be
+// wrapped into the same JSON object shape the agent grammar produces
+[[nodiscard]] std::string_view route_action_fields(RouteIntent intent) noexcept;
+
+[[nodiscard]] std::string_view route_intent_name(RouteIntent intent) noexcept;
+
+extern IntentRouter g_intent_router;
+
+} // namespace sentinel_native
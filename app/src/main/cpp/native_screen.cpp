@@ -0,0 +1,211 @@
+#include "native_screen.hpp"
+
+#include "native_adapter.hpp"
+#include "native_inference.hpp"
+#include "native_kv.hpp"
+#include "native_logging.hpp"
+#include "native_prompt.hpp"
+#include "native_request.hpp"
+#include "native_residency.hpp"
+#include "native_snapshot.hpp"
+#include "native_trace.hpp"
+#include "native_workload.hpp"
+
+namespace sentinel_native {
+
+ScreenStream::~ScreenStream() {
+    if (worker_.joinable()) {
+        worker_.request_stop();
+        cv_.notify_all();
+    }
+}
+
+void ScreenStream::begin(std::string_view query) {
+    std::unique_lock lock(mutex_);
+    if (!worker_.joinable()) {
+        worker_ = std::jthread([this](std::stop_token stop) { worker_loop(stop); });
+    }
+    // Batches of an abandoned stream are dropped, not prefilled
+    while (!queue_.empty()) {
+        spare_.push_back(std::move(queue_.front()));
+        queue_.pop_front();
+    }
+    reset_pending_ = true;
+    pending_query_.assign(query);
+    cv_.notify_all();
+}
+
+[[nodiscard]] bool ScreenStream::append(std::span<const std::byte> batch) {
+    std::unique_lock lock(mutex_);
+    if (!worker_.joinable()) {
+        return false;
+    }
+
+    std::vector<std::byte> copy;
+    if (!spare_.empty()) {
+        copy = std::move(spare_.back());
+        spare_.pop_back();
+    }
+    copy.assign(batch.begin(), batch.end());
+    queue_.push_back(std::move(copy));
+    cv_.notify_all();
+    return true;
+}
+
+[[nodiscard]] std::expected<std::size_t, std::string> ScreenStream::end() {
+    {
+        std::unique_lock lock(mutex_);
+        cv_.wait(lock, [this] { return !reset_pending_ && queue_.empty() && !busy_; });
+    }
+
+    std::unique_lock model_lock(engine_.mutex);
+    if (!open_) {
+        return std::unexpected("No screen stream in progress");
+    }
+    open_ = false;
+
+    if (!error_.empty()) {
+        return std::unexpected(error_);
+    }
+    if (model_generation_ != engine_.model_generation) {
+        return std::unexpected("Model changed during screen stream");
+    }
+
+    const std::size_t before = tokens_.size();
+    finish_screen_tokens(encoder_, engine_.token_cache, tokens_, deferred_);
+    if (tokens_.size() != before) {
+        if (auto done = prefill(engine_, tokens_, tokens_.size()); !done) {
+            return std::unexpected(done.error());
+        }
+    }
+
+    complete_ = true;
+    LOGD("Screen stream complete: %zu elements%s, %zu tokens", encoder_.count(), ranked_ ? " (ranked)" : "",
+         tokens_.size());
+    return tokens_.size();
+}
+
+[[nodiscard]] std::expected<std::span<const llama_token>, std::string> ScreenStream::prompt_tokens() const {
+    if (!complete_) {
+        return std::unexpected("No completed screen stream");
+    }
+    if (model_generation_ != engine_.model_generation) {
+        return std::unexpected("Screen stream belongs to a previous model");
+    }
+    return std::span<const llama_token>(tokens_);
+}
+
+[[nodiscard]] std::optional<std::string_view> ScreenStream::recorded_batches() const noexcept {
+    if (!recording_) {
+        return std::nullopt;
+    }
+    return std::string_view(batches_);
+}
+
+void ScreenStream::worker_loop(std::stop_token stop) {
+    std::unique_lock lock(mutex_);
+    while (true) {
+        cv_.wait(lock, stop, [this] { return reset_pending_ || !queue_.empty(); });
+        if (stop.stop_requested()) {
+            return;
+        }
+
+        if (reset_pending_) {
+            reset_pending_ = false;
+            const std::string query = std::move(pending_query_);
+            busy_ = true;
+            lock.unlock();
+            {
+                TraceSpan span("screen_begin");
+                std::unique_lock model_lock(engine_.mutex);
+                reset(query);
+            }
+            lock.lock();
+            busy_ = false;
+            cv_.notify_all();
+            continue;
+        }
+
+        auto batch = std::move(queue_.front());
+        queue_.pop_front();
+        busy_ = true;
+        lock.unlock();
+
+        {
+            TraceSpan span("screen_ingest", 0, static_cast<int64_t>(batch.size()));
+            std::unique_lock model_lock(engine_.mutex);
+            ingest(batch);
+        }
+
+        lock.lock();
+        spare_.push_back(std::move(batch));
+        busy_ = false;
+        cv_.notify_all();
+    }
+}
+
+void ScreenStream::reset(std::string_view query) {
+    tokens_.clear();
+    deferred_.clear();
+    ranked_ = !query.empty();
+    ranker_.reset(query);
+    batches_.clear();
+    recording_ = g_workload_recorder.recording();
+    signature_ = 0;
+    open_ = true;
+    complete_ = false;
+    error_.clear();
+
+    if (!residency().ensure_resident(engine_) || !apply_stage(engine_, {})) {
+        error_ = "Model not ready for screen stream";
+        return;
+    }
+    model_generation_ = engine_.model_generation;
+
+    const PromptLayout* layout = agent_prompt_layout(engine_);
+    if (!layout) {
+        error_ = "Prompt layout unavailable";
+        return;
+    }
+
+    tokens_.assign(layout->head_tokens.begin(), layout->head_tokens.end());
+    encoder_.reset(engine_.screen_encoding);
+}
+
+void ScreenStream::ingest(std::span<const std::byte> batch) {
+    if (!open_ || !error_.empty()) {
+        return;
+    }
+    if (!engine_.is_ready() || model_generation_ != engine_.model_generation) {
+        error_ = "Model changed during screen stream";
+        return;
+    }
+
+    if (recording_) {
+        batches_.append(reinterpret_cast<const char*>(batch.data()), batch.size());
+    }
+
+    auto snapshot = ScreenSnapshot::parse(batch);
+    if (!snapshot) {
+        error_ = snapshot.error();
+        return;
+    }
+
+    signature_ = structure_signature(*snapshot, signature_);
+
+    const std::size_t before = tokens_.size();
+    append_screen_tokens(*snapshot, encoder_, engine_.token_cache, tokens_, deferred_,
+        [this](const SnapshotElement& element) { return !ranked_ || ranker_.keep(element); });
+
+    if (tokens_.size() == before) {
+        return;
+    }
+
+    // prefill() reuses everything already decoded for this screen and only
+    // decodes the new lines, unless another request took the cache meanwhile
+    if (auto done = prefill(engine_, tokens_); !done) {
+        error_ = done.error();
+    }
+}
+
+} // namespace sentinel_native
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "llama.h"
+#include "native_encoding.hpp"
+#include "native_engine.hpp"
+#include "native_ranker.hpp"
+
+namespace sentinel_native {
+
+/**
+ * Incremental screen ingestion.
+ *
+ * Kotlin calls begin(), then append() with packed snapshot batches while it
+ * is still walking the accessibility tree, then end(). A worker thread
+ * renders, tokenizes and prefills each batch as it arrives, so traversal
+ * and prefill overlap. infer_streamed() then only decodes the query part.
+ * Given the query up front, each batch is pruned with a StreamRanker, the
+ * per-element form of rank_elements; without one, the first
+ * SCREEN_MAX_ELEMENTS interactive elements are kept.
+ *
+ * Each engine owns one stream. begin() and append() only queue work and
+ * never take the engine mutex, so they are safe on the UI thread while a
+ * request is generating: the worker does the model work, taking the
+ * engine's mutex per command. If another request reuses the KV cache in
+ * between, prefill() notices the mismatch and re-decodes, so a stream is
+ * never wrong, only slower. Volatile lines are held back until end() so
+ * only they are re-decoded when a clock or counter changes.
+ */
+class ScreenStream {
+public:
+    explicit ScreenStream(Engine& engine) : engine_(engine) {}
+    ~ScreenStream();
+
+    ScreenStream(const ScreenStream&) = delete;
+    ScreenStream& operator=(const ScreenStream&) = delete;
+
+    // Start a new screen for `query` (empty = unranked), discarding any
+    // previous one and its queued batches; returns immediately. The worker
+    // makes the model resident and lays out the prompt; if that fails,
+    // end() reports it.
+    void begin(std::string_view query = {});
+
+    // Queue a packed snapshot batch (copied) for the worker; returns immediately
+    [[nodiscard]] bool append(std::span<const std::byte> batch);
+
+    // Wait for queued batches to be prefilled. Takes the engine mutex.
+    // @return number of screen prompt tokens (head + screen)
+    [[nodiscard]] std::expected<std::size_t, std::string> end();
+
+    /**
+     * head + screen tokens of the last completed stream, valid while the
+     * model generation matches. Caller must hold the engine mutex.
+     */
+    [[nodiscard]] std::expected<std::span<const llama_token>, std::string> prompt_tokens() const;
+
+    // structure_signature of the streamed screen. Caller must hold the engine mutex.
+    [[nodiscard]] uint64_t signature() const noexcept { return signature_; }
+
+    /**
+     * The packed batches of the stream, back to back, if a workload
+     * recording was running when it began (see native_workload.hpp).
+     * Caller must hold the engine mutex.
+     */
+    [[nodiscard]] std::optional<std::string_view> recorded_batches() const noexcept;
+
+private:
+    void worker_loop(std::stop_token stop);
+
+    // Both run on the worker with the engine mutex held
+    void reset(std::string_view query);
+    void ingest(std::span<const std::byte> batch);
+
+    Engine& engine_;
+
+    // Queue state, guarded by mutex_
+    std::mutex mutex_;
+    std::condition_variable_any cv_;
+    std::deque<std::vector<std::byte>> queue_;
+    std::vector<std::vector<std::byte>> spare_;  // recycled batch buffers
+    bool reset_pending_ = false;  // begin() called; runs before any queued batch
+    std::string pending_query_;   // query of the pending reset
+    bool busy_ = false;
+    std::jthread worker_;
+
+    // Prompt state, guarded by the engine mutex
+    std::vector<llama_token> tokens_;
+    std::vector<llama_token> deferred_;  // volatile lines, appended by end()
+    ScreenEncoder encoder_;  // survives batches; Dense runs may span them
+    StreamRanker ranker_;
+    bool ranked_ = false;
+    uint64_t signature_ = 0;
+    std::string batches_;  // every batch, while recording_
+    bool recording_ = false;
+    uint64_t model_generation_ = 0;
+    bool open_ = false;
+    bool complete_ = false;
+    std::string error_;
+};
+
+} // namespace sentinel_native
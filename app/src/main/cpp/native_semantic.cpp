@@ -0,0 +1,235 @@
+#include "native_semantic.hpp"
+
+#include <algorithm>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "native_embedding.hpp"
+#include "native_logging.hpp"
+#include "native_macro.hpp"
+
+namespace sentinel_native {
+
+SemanticCache g_semantic_cache;
+
+namespace {
+
+// Embeddings are unit length, so the dot product is the cosine
+[[nodiscard]] float dot(const float* a, const float* b, std::size_t n) noexcept {
+    std::size_t i = 0;
+    float sum = 0.0f;
+#if defined(__aarch64__)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#else
+    float acc[4] = {};
+    for (; i + 4 <= n; i += 4) {
+        acc[0] += a[i] * b[i];
+        acc[1] += a[i + 1] * b[i + 1];
+        acc[2] += a[i + 2] * b[i + 2];
+        acc[3] += a[i + 3] * b[i + 3];
+    }
+    sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+#endif
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+} // namespace
+
+void SemanticCache::configure(float threshold, std::size_t capacity) {
+    std::lock_guard lock(mutex_);
+    threshold_ = threshold;
+    capacity = std::max<std::size_t>(capacity, 1);
+    if (capacity != capacity_) {
+        capacity_ = capacity;
+        entries_.clear();
+        vectors_.clear();
+        pending_.reset();
+        last_hit_.reset();
+    }
+}
+
+void SemanticCache::set_enabled(bool enabled) {
+    std::lock_guard lock(mutex_);
+    enabled_ = enabled;
+    if (!enabled) {
+        pending_.reset();
+        last_hit_.reset();
+    }
+}
+
+void SemanticCache::clear() {
+    std::lock_guard lock(mutex_);
+    entries_.clear();
+    vectors_.clear();
+    pending_.reset();
+    last_hit_.reset();
+}
+
+[[nodiscard]] std::optional<std::string> SemanticCache::lookup(std::string_view query, uint64_t fingerprint) {
+    std::vector<float> embedding;
+    {
+        std::lock_guard lock(mutex_);
+        if (!enabled_) {
+            return std::nullopt;
+        }
+        embedding = std::move(scratch_);
+    }
+
+    bool embedded = false;
+    {
+        Engine& embedder = embedding_engine();
+        std::unique_lock model_lock(embedder.mutex);
+        embedded = embedder.is_available() && embed_text(embedder, query, embedding);
+    }
+
+    std::lock_guard lock(mutex_);
+    if (!embedded) {
+        scratch_ = std::move(embedding);
+        return std::nullopt;
+    }
+    ++lookups_;
+    last_hit_.reset();
+
+    std::optional<std::size_t> best;
+    float best_score = threshold_;
+    if (embedding.size() == dim_) {
+        for (std::size_t i = 0; i < entries_.size(); ++i) {
+            const Entry& entry = entries_[i];
+            if (!entry.valid || entry.fingerprint != fingerprint) {
+                continue;
+            }
+            const float score = dot(embedding.data(), vectors_.data() + i * dim_, dim_);
+            if (score >= best_score) {
+                best_score = score;
+                best = i;
+            }
+        }
+    }
+
+    if (best) {
+        Entry& entry = entries_[*best];
+        entry.last_used = ++tick_;
+        last_hit_ = best;
+        ++hits_;
+        pending_.reset();
+        scratch_ = std::move(embedding);
+        LOGD("Semantic cache hit (%.3f)", best_score);
+        return entry.action_json;
+    }
+
+    ++misses_;
+    if (pending_) {
+        scratch_ = std::move(pending_->embedding);
+    }
+    pending_ = Pending{std::string(query), fingerprint, std::move(embedding)};
+    return std::nullopt;
+}
+
+void SemanticCache::record(std::string_view query, uint64_t fingerprint, std::string_view action_json) {
+    std::lock_guard lock(mutex_);
+    if (!enabled_ || !pending_ || pending_->query != query || pending_->fingerprint != fingerprint) {
+        return;
+    }
+    Pending pending = std::move(*pending_);
+    pending_.reset();
+    if (!is_replayable(action_json)) {
+        scratch_ = std::move(pending.embedding);
+        return;
+    }
+
+    // A different embedding model invalidates every stored vector
+    if (pending.embedding.size() != dim_) {
+        dim_ = pending.embedding.size();
+        entries_.clear();
+        vectors_.clear();
+        last_hit_.reset();
+    }
+
+    std::size_t slot = entries_.size();
+    if (slot < capacity_) {
+        entries_.emplace_back();
+        vectors_.resize(entries_.size() * dim_);
+    } else {
+        slot = victim_locked();
+        if (entries_[slot].valid) {
+            ++evictions_;
+        }
+        if (last_hit_ == slot) {
+            last_hit_.reset();
+        }
+    }
+
+    Entry& entry = entries_[slot];
+    entry.fingerprint = fingerprint;
+    entry.last_used = ++tick_;
+    entry.action_json = action_json;
+    entry.valid = true;
+    std::copy(pending.embedding.begin(), pending.embedding.end(), vectors_.begin() + slot * dim_);
+    scratch_ = std::move(pending.embedding);
+    ++inserts_;
+}
+
+void SemanticCache::report_false_positive() {
+    std::lock_guard lock(mutex_);
+    if (!last_hit_) {
+        return;
+    }
+    entries_[*last_hit_].valid = false;
+    last_hit_.reset();
+    ++false_positives_;
+}
+
+[[nodiscard]] std::size_t SemanticCache::victim_locked() const {
+    // Invalidated slots first, then the least recently used
+    std::size_t victim = 0;
+    for (std::size_t i = 0; i < entries_.size(); ++i) {
+        if (!entries_[i].valid) {
+            return i;
+        }
+        if (entries_[i].last_used < entries_[victim].last_used) {
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+[[nodiscard]] SemanticStats SemanticCache::stats() {
+    std::lock_guard lock(mutex_);
+    return {
+        .lookups = lookups_,
+        .hits = hits_,
+        .misses = misses_,
+        .inserts = inserts_,
+        .evictions = evictions_,
+        .false_positives = false_positives_,
+        .size = static_cast<std::size_t>(std::count_if(entries_.begin(), entries_.end(),
+            [](const Entry& e) { return e.valid; })),
+        .threshold = threshold_,
+    };
+}
+
+[[nodiscard]] std::size_t SemanticCache::memory_bytes() {
+    std::lock_guard lock(mutex_);
+    std::size_t bytes = (vectors_.capacity() + scratch_.capacity()) * sizeof(float) +
+                        entries_.capacity() * sizeof(Entry);
+    for (const Entry& e : entries_) {
+        bytes += e.action_json.capacity();
+    }
+    if (pending_) {
+        bytes += pending_->query.capacity() + pending_->embedding.capacity() * sizeof(float);
+    }
+    return bytes;
+}
+
+} // namespace sentinel_native
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sentinel_native {
+
+// Cosine similarity a cached query needs to answer a new one
+inline constexpr float SEMANTIC_DEFAULT_THRESHOLD = 0.92f;
+
+// Entries kept; the least recently used is replaced beyond this
+inline constexpr std::size_t SEMANTIC_DEFAULT_CAPACITY = 256;
+
+struct SemanticStats {
+    uint64_t lookups;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t inserts;
+    uint64_t evictions;
+    uint64_t false_positives;  // hits the app reported as wrong
+    std::size_t size;
+    float threshold;
+};
+
+/**
+ * Answers paraphrases of queries already answered on the same screen
+ * ("open settings" vs "go to the settings").
+ *
+ * Each entry is a query embedding (embedding_engine, L2-normalized), the
+ * structure fingerprint of the screen it was asked on and the model's
+ * action. A lookup embeds the query and scans the entries with the same
+ * fingerprint for the highest cosine similarity; a match above the
+ * threshold returns the stored action. Entries never match across
+ * fingerprints, so element ids in a returned action are valid.
+ *
+ * A miss keeps its embedding pending so record() can store the model's
+ * answer without embedding again. Disabled until an embedding model is
+ * loaded. Thread-safe; embedding runs outside the cache lock.
+ */
+class SemanticCache {
+public:
+    // Changing the capacity clears the cache
+    void configure(float threshold, std::size_t capacity);
+    void set_enabled(bool enabled);
+    void clear();
+
+    // Stored action for a query similar enough to `query`, or nothing
+    [[nodiscard]] std::optional<std::string> lookup(std::string_view query, uint64_t fingerprint);
+
+    // Store the model's action for the query the last lookup() missed
+    void record(std::string_view query, uint64_t fingerprint, std::string_view action_json);
+
+    // The last hit led to a wrong action: drop its entry and count it
+    void report_false_positive();
+
+    [[nodiscard]] SemanticStats stats();
+
+    // Heap bytes held by embeddings and stored actions
+    [[nodiscard]] std::size_t memory_bytes();
+
+private:
+    struct Entry {
+        uint64_t fingerprint = 0;
+        uint64_t last_used = 0;
+        std::string action_json;
+        bool valid = false;
+    };
+
+    struct Pending {
+        std::string query;
+        uint64_t fingerprint = 0;
+        std::vector<float> embedding;
+    };
+
+    [[nodiscard]] std::size_t victim_locked() const;
+
+    std::mutex mutex_;
+    bool enabled_ = true;
+    float threshold_ = SEMANTIC_DEFAULT_THRESHOLD;
+    std::size_t capacity_ = SEMANTIC_DEFAULT_CAPACITY;
+    std::size_t dim_ = 0;
+    std::vector<float> vectors_;  // [capacity][dim], row i belongs to entries_[i]
+    std::vector<Entry> entries_;
+    std::optional<Pending> pending_;
+    std::optional<std::size_t> last_hit_;
+    std::vector<float> scratch_;
+    uint64_t tick_ = 0;
+    uint64_t lookups_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t inserts_ = 0;
+    uint64_t evictions_ = 0;
+    uint64_t false_positives_ = 0;
+};
+
+extern SemanticCache g_semantic_cache;
+
+} // namespace sentinel_native
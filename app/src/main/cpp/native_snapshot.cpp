@@ -0,0 +1,199 @@
+#include "native_snapshot.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+
+#include "sentinel.hpp"
+
+namespace sentinel_native {
+
+static_assert(std::endian::native == std::endian::little, "snapshot format is little-endian");
+
+namespace {
+
+template <typename T>
+[[nodiscard]] T load(const std::byte* p) noexcept {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+constexpr std::size_t align4(std::size_t n) noexcept {
+    return (n + 3) & ~std::size_t{3};
+}
+
+// Labels arrive truncated to 60 chars by ElementRegistry; this only guards
+// against a hostile or corrupted buffer.
+constexpr std::size_t MAX_LABEL_BYTES = 512;
+
+} // namespace
+
+[[nodiscard]] std::expected<ScreenSnapshot, std::string> ScreenSnapshot::parse(std::span<const std::byte> data) {
+    if (data.size() < SNAPSHOT_HEADER_BYTES) {
+        return std::unexpected("Snapshot truncated");
+    }
+
+    const std::byte* base = data.data();
+    if (load<uint32_t>(base) != SNAPSHOT_MAGIC) {
+        return std::unexpected("Bad snapshot magic");
+    }
+    if (load<uint16_t>(base + 4) != SNAPSHOT_VERSION) {
+        return std::unexpected("Unsupported snapshot version");
+    }
+
+    const std::size_t count = load<uint32_t>(base + 8);
+    const std::size_t blob_size = load<uint32_t>(base + 12);
+
+    // 28 bytes of fixed-width fields plus one flag byte per element
+    const std::size_t arrays = count * 28 + align4(count);
+    if (count > (data.size() - SNAPSHOT_HEADER_BYTES) / 29 ||
+        SNAPSHOT_HEADER_BYTES + arrays + blob_size > data.size()) {
+        return std::unexpected("Snapshot size mismatch");
+    }
+
+    ScreenSnapshot snap;
+    snap.count_ = count;
+    snap.ids_ = base + SNAPSHOT_HEADER_BYTES;
+    snap.bounds_ = snap.ids_ + count * 4;
+    snap.offsets_ = snap.bounds_ + count * 16;
+    snap.lengths_ = snap.offsets_ + count * 4;
+    snap.flags_ = snap.lengths_ + count * 4;
+    snap.blob_ = reinterpret_cast<const char*>(snap.flags_ + align4(count));
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t offset = load<uint32_t>(snap.offsets_ + i * 4);
+        const std::size_t length = load<uint32_t>(snap.lengths_ + i * 4);
+        if (offset > blob_size || length > blob_size - offset) {
+            return std::unexpected("Snapshot label out of range");
+        }
+    }
+
+    return snap;
+}
+
+[[nodiscard]] std::size_t ScreenSnapshot::packed_size(std::span<const std::byte> data) noexcept {
+    if (data.size() < SNAPSHOT_HEADER_BYTES || load<uint32_t>(data.data()) != SNAPSHOT_MAGIC) {
+        return 0;
+    }
+    const std::size_t count = load<uint32_t>(data.data() + 8);
+    const std::size_t blob_size = load<uint32_t>(data.data() + 12);
+    return SNAPSHOT_HEADER_BYTES + count * 28 + align4(count) + blob_size;
+}
+
+[[nodiscard]] SnapshotElement ScreenSnapshot::element(std::size_t i) const noexcept {
+    const std::byte* b = bounds_ + i * 16;
+    return {
+        .id = load<int32_t>(ids_ + i * 4),
+        .left = load<int32_t>(b),
+        .top = load<int32_t>(b + 4),
+        .right = load<int32_t>(b + 8),
+        .bottom = load<int32_t>(b + 12),
+        .flags = static_cast<uint8_t>(flags_[i]),
+        .label = {blob_ + load<uint32_t>(offsets_ + i * 4), load<uint32_t>(lengths_ + i * 4)},
+    };
+}
+
+void render_element_line(const SnapshotElement& element, std::pmr::string& out) {
+    char id_buf[16];
+    auto [id_end, ec] = std::to_chars(id_buf, id_buf + sizeof(id_buf), element.id);
+
+    out += "  ";
+    out.append(id_buf, id_end);
+    out += ". [";
+
+    bool first = true;
+    auto flag = [&](uint8_t bit, std::string_view name) {
+        if (!(element.flags & bit)) return;
+        if (!first) out += '|';
+        out += name;
+        first = false;
+    };
+    flag(SNAPSHOT_FLAG_CLICKABLE, "click");
+    flag(SNAPSHOT_FLAG_EDITABLE, "edit");
+    flag(SNAPSHOT_FLAG_SCROLLABLE, "scroll");
+
+    out += "] ";
+    append_label(element.label, out);
+    out += '\n';
+}
+
+void append_label(std::string_view label, std::pmr::string& out) {
+    std::pmr::string clean(out.get_allocator());
+    sentinel::sanitize_into(label, clean, MAX_LABEL_BYTES);
+    // Labels are single-line in the prompt
+    for (char& c : clean) {
+        if (c == '\n') c = ' ';
+    }
+    out += clean;
+}
+
+[[nodiscard]] bool is_volatile(const SnapshotElement& element) noexcept {
+    const std::string_view label = element.label;
+    if (label.empty()) {
+        return false;
+    }
+
+    auto is_digit = [](char c) { return c >= '0' && c <= '9'; };
+
+    bool all_digits = true;
+    for (std::size_t i = 0; i < label.size(); ++i) {
+        const char c = label[i];
+        if (!is_digit(c)) {
+            all_digits = false;
+            continue;
+        }
+        // "9:41", "12:05"
+        if (i + 3 < label.size() && label[i + 1] == ':' && is_digit(label[i + 2]) && is_digit(label[i + 3])) {
+            return true;
+        }
+        // "85%", "5 %"
+        if (i + 1 < label.size() && (label[i + 1] == '%' ||
+            (label[i + 1] == ' ' && i + 2 < label.size() && label[i + 2] == '%'))) {
+            return true;
+        }
+    }
+    // Unread counters, badges
+    if (all_digits) {
+        return true;
+    }
+
+    auto contains = [label](std::string_view needle) {
+        return std::search(label.begin(), label.end(), needle.begin(), needle.end(),
+            [](char a, char b) {
+                return std::tolower(static_cast<unsigned char>(a)) == b;
+            }) != label.end();
+    };
+    return contains(" ago") || contains("notification") || contains("just now");
+}
+
+[[nodiscard]] uint64_t structure_signature(const ScreenSnapshot& snapshot, uint64_t seed) noexcept {
+    // FNV-1a, 64-bit
+    uint64_t h = seed ? seed : 14695981039346656037ull;
+    auto mix = [&h](const void* data, std::size_t size) {
+        const auto* p = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            h ^= p[i];
+            h *= 1099511628211ull;
+        }
+    };
+
+    for (std::size_t i = 0; i < snapshot.size(); ++i) {
+        const SnapshotElement element = snapshot.element(i);
+        if (is_volatile(element)) {
+            continue;
+        }
+        const int32_t fields[] = {
+            element.id, element.flags,
+            element.left >> 4, element.top >> 4, element.right >> 4, element.bottom >> 4,
+        };
+        mix(fields, sizeof(fields));
+        mix(element.label.data(), element.label.size());
+        mix("\0", 1);
+    }
+    return h;
+}
+
+} // namespace sentinel_native
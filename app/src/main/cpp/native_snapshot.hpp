@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace sentinel_native {
+
+/**
+ * Packed accessibility snapshot, written by ElementRegistry.writeSnapshot
+ * into a direct ByteBuffer. All fields little-endian:
+ *
+ *   u32 magic 'SNP1' | u16 version | u16 reserved | u32 count | u32 blob_size
+ *   i32 id[count]
+ *   i32 bounds[count][4]        left, top, right, bottom
+ *   u32 label_offset[count]     into blob
+ *   u32 label_length[count]     bytes
+ *   u8  flags[count]            SNAPSHOT_FLAG_*
+ *   pad to 4 bytes
+ *   u8  blob[blob_size]         UTF-8 labels
+ */
+inline constexpr uint32_t SNAPSHOT_MAGIC = 0x31504E53;  // "SNP1"
+inline constexpr uint16_t SNAPSHOT_VERSION = 1;
+inline constexpr std::size_t SNAPSHOT_HEADER_BYTES = 16;
+
+inline constexpr uint8_t SNAPSHOT_FLAG_CLICKABLE = 1 << 0;
+inline constexpr uint8_t SNAPSHOT_FLAG_EDITABLE = 1 << 1;
+inline constexpr uint8_t SNAPSHOT_FLAG_SCROLLABLE = 1 << 2;
+inline constexpr uint8_t SNAPSHOT_FLAG_INTERACTIVE =
+    SNAPSHOT_FLAG_CLICKABLE | SNAPSHOT_FLAG_EDITABLE | SNAPSHOT_FLAG_SCROLLABLE;
+
+struct SnapshotElement {
+    int32_t id;
+    int32_t left;
+    int32_t top;
+    int32_t right;
+    int32_t bottom;
+    uint8_t flags;
+    std::string_view label;
+
+    [[nodiscard]] constexpr bool is_interactive() const noexcept {
+        return (flags & SNAPSHOT_FLAG_INTERACTIVE) != 0;
+    }
+};
+
+/**
+ * Zero-copy view over a packed snapshot. Only valid while the underlying
+ * buffer is (i.e. for the duration of the JNI call that received it).
+ */
+class ScreenSnapshot {
+public:
+    [[nodiscard]] static std::expected<ScreenSnapshot, std::string> parse(std::span<const std::byte> data);
+
+    // Bytes of the snapshot that starts `data`, per its header; 0 if the
+    // header is missing or invalid. Does not check the rest.
+    [[nodiscard]] static std::size_t packed_size(std::span<const std::byte> data) noexcept;
+
+    [[nodiscard]] std::size_t size() const noexcept { return count_; }
+    [[nodiscard]] bool empty() const noexcept { return count_ == 0; }
+    [[nodiscard]] SnapshotElement element(std::size_t i) const noexcept;
+
+private:
+    ScreenSnapshot() = default;
+
+    std::size_t count_ = 0;
+    const std::byte* ids_ = nullptr;
+    const std::byte* bounds_ = nullptr;
+    const std::byte* offsets_ = nullptr;
+    const std::byte* lengths_ = nullptr;
+    const std::byte* flags_ = nullptr;
+    const char* blob_ = nullptr;
+};
+
+inline constexpr std::string_view SCREEN_EMPTY_TEXT = "[No interactive elements visible]";
+inline constexpr std::string_view SCREEN_LIST_HEADER = "Available UI elements (use element_id):\n";
+
+// Sanitized, single-line label text
+void append_label(std::string_view label, std::pmr::string& out);
+
+// One prompt line, same format as ElementRegistry.toPromptString:
+// "  <id>. [click|edit|scroll] <label>\n". The label is sanitized.
+void render_element_line(const SnapshotElement& element, std::pmr::string& out);
+
+/**
+ * Whether an element's label is likely to change between otherwise
+ * identical screens: clock times, percentages, relative times, counters
+ * and notification text. Volatile lines are placed after stable ones so a
+ * ticking clock does not invalidate the KV cache for the whole screen.
+ */
+[[nodiscard]] bool is_volatile(const SnapshotElement& element) noexcept;
+
+/**
+ * 64-bit hash of a screen's structure: ids, flags, labels and coarse
+ * (16 px) bounds of its non-volatile elements, in order. Equal signatures
+ * mean the same elements carry the same ids. Pass the previous result as
+ * `seed` to extend a signature over consecutive batches.
+ */
+[[nodiscard]] uint64_t structure_signature(const ScreenSnapshot& snapshot, uint64_t seed = 0) noexcept;
+
+} // namespace sentinel_native
@@ -0,0 +1,92 @@
+#include "native_trace.hpp"
+
+#include <format>
+#include <iterator>
+
+#include <unistd.h>
+
+namespace sentinel_native {
+
+Tracer g_tracer;
+
+namespace {
+
+[[nodiscard]] uint32_t current_tid() noexcept {
+    thread_local const auto tid = static_cast<uint32_t>(gettid());
+    return tid;
+}
+
+} // namespace
+
+void Tracer::set_enabled(bool enabled) {
+    if (enabled) {
+        std::call_once(allocate_once_, [this] {
+            slots_ = std::make_unique<Slot[]>(TRACE_CAPACITY);
+            ring_.store(slots_.get(), std::memory_order_release);
+        });
+    }
+    enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void Tracer::record(const char* name, uint64_t start_ns, uint64_t end_ns, uint64_t request, int64_t arg) noexcept {
+    Slot* ring = ring_.load(std::memory_order_acquire);
+    if (!ring) {
+        return;
+    }
+    const uint64_t index = next_.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = ring[index % TRACE_CAPACITY];
+
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start_ns.store(start_ns, std::memory_order_relaxed);
+    slot.dur_ns.store(end_ns - start_ns, std::memory_order_relaxed);
+    slot.request.store(request, std::memory_order_relaxed);
+    slot.arg.store(arg, std::memory_order_relaxed);
+    slot.tid.store(current_tid(), std::memory_order_relaxed);
+    slot.seq.store(index + 1, std::memory_order_release);
+}
+
+void Tracer::clear() noexcept {
+    cleared_.store(next_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+[[nodiscard]] std::string Tracer::to_json() const {
+    std::string out;
+    auto it = std::back_inserter(out);
+    const auto pid = static_cast<uint32_t>(getpid());
+    std::format_to(it, R"({{"displayTimeUnit":"ms","otherData":{{"clock":"CLOCK_MONOTONIC"}},"traceEvents":[)");
+
+    const Slot* ring = ring_.load(std::memory_order_acquire);
+    const uint64_t end = next_.load(std::memory_order_acquire);
+    uint64_t begin = cleared_.load(std::memory_order_relaxed);
+    if (end > TRACE_CAPACITY && begin < end - TRACE_CAPACITY) {
+        begin = end - TRACE_CAPACITY;
+    }
+
+    bool first = true;
+    for (uint64_t index = begin; ring && index < end; ++index) {
+        const Slot& slot = ring[index % TRACE_CAPACITY];
+        const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+        const char* name = slot.name.load(std::memory_order_relaxed);
+        const uint64_t start_ns = slot.start_ns.load(std::memory_order_relaxed);
+        const uint64_t dur_ns = slot.dur_ns.load(std::memory_order_relaxed);
+        const uint64_t request = slot.request.load(std::memory_order_relaxed);
+        const int64_t arg = slot.arg.load(std::memory_order_relaxed);
+        const uint32_t tid = slot.tid.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // Still being written, or already overwritten by a newer span
+        if (seq != index + 1 || slot.seq.load(std::memory_order_relaxed) != seq || !name) {
+            continue;
+        }
+
+        std::format_to(it, R"({}{{"name":"{}","ph":"X","ts":{}.{:03},"dur":{}.{:03},"pid":{},"tid":{},"args":{{"request":{},"arg":{}}}}})",
+            first ? "" : ",", name, start_ns / 1000, start_ns % 1000, dur_ns / 1000, dur_ns % 1000,
+            pid, tid, request, arg);
+        first = false;
+    }
+    out += "]}";
+    return out;
+}
+
+} // namespace sentinel_native
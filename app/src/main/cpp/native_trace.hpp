@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace sentinel_native {
+
+// Spans kept; the oldest are overwritten beyond this (64 bytes each)
+inline constexpr std::size_t TRACE_CAPACITY = std::size_t{1} << 15;
+
+// CLOCK_MONOTONIC, the clock Android app traces use
+[[nodiscard]] inline uint64_t monotonic_ns() noexcept {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * Span recorder for lining native work up with app traces.
+ *
+ * Spans are complete events (name, start, duration, thread, request id,
+ * one integer argument) written into a ring preallocated on first enable.
+ * record() claims a slot with one fetch_add and publishes it through a
+ * per-slot sequence number, so writers never block each other and a dump
+ * can run concurrently, skipping slots that are mid-write. While disabled
+ * a span costs one relaxed load.
+ *
+ * Names must be string literals (or otherwise outlive the tracer).
+ */
+class Tracer {
+public:
+    void set_enabled(bool enabled);
+    [[nodiscard]] bool enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+    void record(const char* name, uint64_t start_ns, uint64_t end_ns, uint64_t request, int64_t arg) noexcept;
+
+    // Drop recorded spans (not the buffer)
+    void clear() noexcept;
+
+    // Chrome trace-event JSON, loadable by Perfetto UI and chrome://tracing
+    [[nodiscard]] std::string to_json() const;
+
+    // Bytes of the span ring, 0 until tracing is first enabled
+    [[nodiscard]] std::size_t memory_bytes() const noexcept {
+        return ring_.load(std::memory_order_acquire) ? TRACE_CAPACITY * sizeof(Slot) : 0;
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> seq{0};  // index + 1 once written, 0 while writing
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t> start_ns{0};
+        std::atomic<uint64_t> dur_ns{0};
+        std::atomic<uint64_t> request{0};
+        std::atomic<int64_t> arg{0};
+        std::atomic<uint32_t> tid{0};
+    };
+
+    std::atomic<bool> enabled_{false};
+    std::once_flag allocate_once_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<Slot*> ring_{nullptr};
+    std::atomic<uint64_t> next_{0};
+    std::atomic<uint64_t> cleared_{0};  // spans below this index are dropped
+};
+
+extern Tracer g_tracer;
+
+// Records the enclosing scope as a span while tracing is enabled
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, uint64_t request = 0, int64_t arg = 0) noexcept
+        : name_(g_tracer.enabled() ? name : nullptr),
+          request_(request),
+          arg_(arg),
+          start_ns_(name_ ? monotonic_ns() : 0) {}
+    ~TraceSpan() {
+        if (name_) {
+            g_tracer.record(name_, start_ns_, monotonic_ns(), request_, arg_);
+        }
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name_;
+    uint64_t request_;
+    int64_t arg_;
+    uint64_t start_ns_;
+};
+
+} // namespace sentinel_native
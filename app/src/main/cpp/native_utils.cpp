@@ -1,49 +1,150 @@
 #include "native_utils.hpp"
 
-#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <sstream>
 
+#include "native_engine.hpp"
 #include "native_logging.hpp"
 
 namespace sentinel_native {
 
-[[nodiscard]] std::string jstring_to_string(JNIEnv* env, jstring jstr) {
-    if (!jstr) return "";
+namespace {
 
-    const char* chars = env->GetStringUTFChars(jstr, nullptr);
-    if (!chars) return "";
+constexpr char32_t REPLACEMENT_CHAR = 0xFFFD;
 
-    std::string result(chars);
-    env->ReleaseStringUTFChars(jstr, chars);
-    return result;
+std::mutex g_grammar_mutex;
+// Node-based map: references handed out stay valid as entries are added
+StringMap<std::string> g_grammars;
+
+void append_utf8(std::pmr::string& out, char32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
 }
 
-[[nodiscard]] jstring string_to_jstring(JNIEnv* env, const std::string& str) {
-    return env->NewStringUTF(str.c_str());
+} // namespace
+
+void utf16_to_utf8(const char16_t* src, std::size_t len, std::pmr::string& out) {
+    out.clear();
+    out.reserve(len);
+
+    for (std::size_t i = 0; i < len; ++i) {
+        char32_t cp = src[i];
+        if (cp < 0x80) {
+            out.push_back(static_cast<char>(cp));
+            continue;
+        }
+        if (cp >= 0xD800 && cp <= 0xDBFF) {
+            if (i + 1 < len && src[i + 1] >= 0xDC00 && src[i + 1] <= 0xDFFF) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (src[i + 1] - 0xDC00);
+                ++i;
+            } else {
+                cp = REPLACEMENT_CHAR;
+            }
+        } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+            cp = REPLACEMENT_CHAR;
+        }
+        append_utf8(out, cp);
+    }
 }
 
-[[nodiscard]] std::vector<llama_token> tokenize(const std::string& text, bool add_bos) {
-    std::vector<llama_token> tokens(text.length() + 64);
+void utf8_to_utf16(std::string_view src, std::pmr::u16string& out) {
+    out.clear();
+    out.reserve(src.size());
+
+    const auto* s = reinterpret_cast<const unsigned char*>(src.data());
+    const std::size_t len = src.size();
+    std::size_t i = 0;
+
+    while (i < len) {
+        const unsigned char lead = s[i];
+        if (lead < 0x80) {
+            out.push_back(lead);
+            ++i;
+            continue;
+        }
+
+        std::size_t extra;
+        char32_t cp;
+        char32_t min_cp;
+        if ((lead & 0xE0) == 0xC0) {
+            extra = 1; cp = lead & 0x1F; min_cp = 0x80;
+        } else if ((lead & 0xF0) == 0xE0) {
+            extra = 2; cp = lead & 0x0F; min_cp = 0x800;
+        } else if ((lead & 0xF8) == 0xF0) {
+            extra = 3; cp = lead & 0x07; min_cp = 0x10000;
+        } else {
+            out.push_back(static_cast<char16_t>(REPLACEMENT_CHAR));
+            ++i;
+            continue;
+        }
+
+        // Truncated or malformed sequences (e.g. output cut at max_tokens
+        // mid-character) become U+FFFD instead of aborting under CheckJNI.
+        std::size_t j = 1;
+        for (; j <= extra && i + j < len && (s[i + j] & 0xC0) == 0x80; ++j) {
+            cp = (cp << 6) | (s[i + j] & 0x3F);
+        }
+        if (j <= extra || cp < min_cp || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+            out.push_back(static_cast<char16_t>(REPLACEMENT_CHAR));
+            i += j;
+            continue;
+        }
+
+        if (cp >= 0x10000) {
+            cp -= 0x10000;
+            out.push_back(static_cast<char16_t>(0xD800 + (cp >> 10)));
+            out.push_back(static_cast<char16_t>(0xDC00 + (cp & 0x3FF)));
+        } else {
+            out.push_back(static_cast<char16_t>(cp));
+        }
+        i += extra + 1;
+    }
+}
+
+[[nodiscard]] std::pmr::vector<llama_token> tokenize(
+    const llama_vocab* vocab,
+    std::string_view text,
+    bool add_bos,
+    bool parse_special,
+    std::pmr::memory_resource* mr
+) {
+    std::pmr::vector<llama_token> tokens(text.length() + 64, mr);
 
     int n_tokens = llama_tokenize(
-        g_state.vocab,
-        text.c_str(),
+        vocab,
+        text.data(),
         static_cast<int>(text.length()),
         tokens.data(),
         static_cast<int>(tokens.size()),
         add_bos,
-        true
+        parse_special
     );
 
     if (n_tokens < 0) {
         tokens.resize(-n_tokens);
         n_tokens = llama_tokenize(
-            g_state.vocab,
-            text.c_str(),
+            vocab,
+            text.data(),
             static_cast<int>(text.length()),
             tokens.data(),
             static_cast<int>(tokens.size()),
             add_bos,
-            true
+            parse_special
         );
     }
 
@@ -51,48 +152,142 @@ namespace sentinel_native {
     return tokens;
 }
 
-[[nodiscard]] std::string apply_chat_template(
-    const std::string& system_prompt,
-    const std::string& user_message
+[[nodiscard]] std::pmr::string apply_chat_template(
+    std::string_view chat_template,
+    std::string_view system_prompt,
+    std::string_view user_message,
+    std::pmr::memory_resource* mr
 ) {
-    std::vector<llama_chat_message> messages;
+    // llama_chat_message wants NUL-terminated content
+    std::pmr::string template_z(chat_template, mr);
+    std::pmr::string system_z(system_prompt, mr);
+    std::pmr::string user_z(user_message, mr);
+
+    std::pmr::vector<llama_chat_message> messages(mr);
+    messages.reserve(2);
 
-    if (!system_prompt.empty()) {
-        messages.push_back({"system", system_prompt.c_str()});
+    if (!system_z.empty()) {
+        messages.push_back({"system", system_z.c_str()});
     }
-    messages.push_back({"user", user_message.c_str()});
+    messages.push_back({"user", user_z.c_str()});
+
+    const char* tmpl = template_z.empty() ? nullptr : template_z.c_str();
 
-    const char* tmpl = g_state.chat_template.empty() ? nullptr : g_state.chat_template.c_str();
+    // Templates add a few hundred bytes of markup; size for one pass in the
+    // common case and retry only if the template reports more.
+    std::pmr::string result(mr);
+    result.resize(system_z.size() + user_z.size() + 512);
 
-    int32_t buf_size = llama_chat_apply_template(
+    int32_t needed = llama_chat_apply_template(
         tmpl,
         messages.data(),
         messages.size(),
         true,
-        nullptr,
-        0
+        result.data(),
+        static_cast<int32_t>(result.size())
     );
 
-    if (buf_size <= 0) {
+    if (needed <= 0) {
         LOGW("Chat template failed, falling back to simple format");
-        if (system_prompt.empty()) {
-            return user_message;
+        result.clear();
+        if (!system_z.empty()) {
+            result += system_z;
+            result += "\n\n";
         }
-        return system_prompt + "\n\n" + user_message;
+        result += user_z;
+        return result;
     }
 
-    std::string result(static_cast<size_t>(buf_size) + 1, '\0');
-    llama_chat_apply_template(
-        tmpl,
-        messages.data(),
-        messages.size(),
-        true,
-        result.data(),
-        result.size()
-    );
+    if (static_cast<size_t>(needed) > result.size()) {
+        result.resize(static_cast<size_t>(needed));
+        llama_chat_apply_template(
+            tmpl,
+            messages.data(),
+            messages.size(),
+            true,
+            result.data(),
+            needed
+        );
+    }
 
-    result.resize(strlen(result.c_str()));
+    result.resize(static_cast<size_t>(needed));
     return result;
 }
 
+[[nodiscard]] const std::string& load_grammar_cached(std::string_view path) {
+    static const std::string no_grammar;
+    if (path.empty()) {
+        return no_grammar;
+    }
+
+    std::lock_guard lock(g_grammar_mutex);
+    if (auto it = g_grammars.find(path); it != g_grammars.end()) {
+        return it->second;
+    }
+
+    std::ifstream grammar_file{std::string(path)};
+    if (!grammar_file.is_open()) {
+        // Not cached: the asset may be copied out later
+        LOGW("Grammar file not found: %.*s", static_cast<int>(path.size()), path.data());
+        return no_grammar;
+    }
+
+    std::stringstream buffer;
+    buffer << grammar_file.rdbuf();
+    auto [it, inserted] = g_grammars.emplace(std::string(path), buffer.str());
+    LOGI("Grammar cached: %zu bytes", it->second.size());
+    return it->second;
+}
+
+[[nodiscard]] std::size_t grammar_cache_bytes() {
+    std::lock_guard lock(g_grammar_mutex);
+    std::size_t bytes = 0;
+    for (const auto& [path, text] : g_grammars) {
+        bytes += path.capacity() + text.capacity();
+    }
+    return bytes;
+}
+
+void normalize_text(std::string_view text, std::string& out) {
+    out.clear();
+    bool space = false;
+    for (char c : text) {
+        const auto u = static_cast<unsigned char>(c);
+        const bool word = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || u >= 0x80;
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        } else if (!word) {
+            space = !out.empty();
+            continue;
+        }
+        if (space) {
+            out += ' ';
+            space = false;
+        }
+        out += c;
+    }
+}
+
+void append_json_escaped(std::string_view text, std::string& out) {
+    static constexpr char HEX[] = "0123456789abcdef";
+    for (char c : text) {
+        const auto u = static_cast<unsigned char>(c);
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (u < 0x20) {
+                    out += "\\u00";
+                    out += HEX[u >> 4];
+                    out += HEX[u & 0xF];
+                } else {
+                    out += c;
+                }
+        }
+    }
+}
+
 } // namespace sentinel_native
@@ -1,22 +1,55 @@
 #pragma once
 
-#include <jni.h>
+#include <cstdint>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "llama.h"
-#include "native_state.hpp"
 
 namespace sentinel_native {
 
-[[nodiscard]] std::string jstring_to_string(JNIEnv* env, jstring jstr);
-[[nodiscard]] jstring string_to_jstring(JNIEnv* env, const std::string& str);
+// Standard UTF-8 <-> UTF-16 conversion. JNI's *StringUTF* family speaks
+// modified UTF-8, which splits supplementary characters (emoji) into
+// surrogate triplets and rejects the 4-byte form the model emits.
+void utf16_to_utf8(const char16_t* src, std::size_t len, std::pmr::string& out);
+void utf8_to_utf16(std::string_view src, std::pmr::u16string& out);
 
-[[nodiscard]] std::vector<llama_token> tokenize(const std::string& text, bool add_bos = true);
+// parse_special=false keeps control-token text (e.g. "<|im_start|>") in
+// untrusted input as plain text instead of mapping it to special tokens
+[[nodiscard]] std::pmr::vector<llama_token> tokenize(
+    const llama_vocab* vocab,
+    std::string_view text,
+    bool add_bos = true,
+    bool parse_special = true,
+    std::pmr::memory_resource* mr = std::pmr::get_default_resource()
+);
 
-[[nodiscard]] std::string apply_chat_template(
-    const std::string& system_prompt,
-    const std::string& user_message
+// chat_template empty = llama.cpp's default template
+[[nodiscard]] std::pmr::string apply_chat_template(
+    std::string_view chat_template,
+    std::string_view system_prompt,
+    std::string_view user_message,
+    std::pmr::memory_resource* mr = std::pmr::get_default_resource()
 );
 
+/**
+ * Grammar text for a .gbnf path, read once per process and shared by all
+ * engines. Returns an empty grammar (no constraint) if the file cannot be
+ * read. The reference stays valid for the life of the process.
+ */
+[[nodiscard]] const std::string& load_grammar_cached(std::string_view path);
+
+// Bytes of grammar text held by load_grammar_cached
+[[nodiscard]] std::size_t grammar_cache_bytes();
+
+// Lowercase ASCII, punctuation and whitespace runs to one space, trimmed.
+// UTF-8 bytes pass through unchanged.
+void normalize_text(std::string_view text, std::string& out);
+
+// Append `text` as the body of a JSON string: quotes, backslashes and
+// control characters escaped, UTF-8 passed through
+void append_json_escaped(std::string_view text, std::string& out);
+
 } // namespace sentinel_native
@@ -0,0 +1,438 @@
+#include "native_workload.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <random>
+
+#include "native_logging.hpp"
+#include "native_snapshot.hpp"
+#include "native_trace.hpp"
+
+namespace sentinel_native {
+
+static_assert(std::endian::native == std::endian::little, "workload format is little-endian");
+
+WorkloadRecorder g_workload_recorder;
+
+namespace {
+
+template <typename T>
+void store(std::string& out, T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+template <typename T>
+[[nodiscard]] T load(const char* p) noexcept {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+[[nodiscard]] uint32_t saturate_us(uint64_t ns) noexcept {
+    return static_cast<uint32_t>(std::min<uint64_t>(ns / 1000, UINT32_MAX));
+}
+
+// --- Redaction ---
+
+[[nodiscard]] uint64_t mix(uint64_t x) noexcept {
+    // splitmix64 finalizer
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// ASCII case-insensitive, so "Send" and "SEND" stay the same word
+[[nodiscard]] uint64_t word_hash(std::string_view word, uint64_t salt) noexcept {
+    uint64_t h = 0xCBF29CE484222325ull ^ salt;
+    for (char c : word) {
+        const char lower = c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+        h = (h ^ static_cast<unsigned char>(lower)) * 0x100000001B3ull;
+    }
+    return mix(h);
+}
+
+// Common words by length, so redacted text tokenizes like text
+constexpr std::size_t MAX_WORD = 10;
+constexpr std::array<std::string_view, MAX_WORD> WORDS = {
+    "a i",
+    "of to in it is on at by we go up no",
+    "the and for you new app tap set off now all see",
+    "open send back more home menu mode dark call edit find view",
+    "close share photo music allow start check reply store alarm",
+    "search camera delete select cancel update enable screen system volume",
+    "message contact display setting privacy battery storage account android network",
+    "settings location calendar download password keyboard language security notebook favorite",
+    "bluetooth clipboard documents wallpaper recording messaging translate assistant",
+    "connection navigation automation background brightness calculator screenshot restaurant",
+};
+
+// Words of the screen list format (SCREEN_LIST_HEADER, flags, SCREEN_EMPTY_TEXT)
+constexpr std::string_view KEPT_WORDS[] = {
+    "Available", "UI", "elements", "use", "element", "id", "click", "edit", "scroll", "No", "interactive", "visible",
+};
+
+[[nodiscard]] std::string_view pick_word(std::size_t length, uint64_t h) noexcept {
+    const std::string_view list = WORDS[length - 1];
+    const std::size_t count = (list.size() + 1) / (length + 1);
+    return list.substr((h % count) * (length + 1), length);
+}
+
+void redact_word(std::string_view word, uint64_t salt, std::string& out) {
+    if (std::find(std::begin(KEPT_WORDS), std::end(KEPT_WORDS), word) != std::end(KEPT_WORDS)) {
+        out += word;
+        return;
+    }
+    uint64_t h = word_hash(word, salt);
+    std::size_t pos = 0;
+    while (pos < word.size()) {
+        const std::size_t length = std::min(word.size() - pos, MAX_WORD);
+        const std::string_view pick = pick_word(length, h);
+        for (std::size_t i = 0; i < length; ++i) {
+            const char c = word[pos + i];
+            out += c >= 'A' && c <= 'Z' ? static_cast<char>(pick[i] - 'a' + 'A') : pick[i];
+        }
+        pos += length;
+        h = mix(h);
+    }
+}
+
+void redact_digits(std::string_view digits, uint64_t salt, std::string& out) {
+    uint64_t h = word_hash(digits, salt);
+    for (std::size_t i = 0; i < digits.size(); ++i) {
+        const bool keep_nonzero = i == 0 && digits[0] != '0';
+        out += static_cast<char>('0' + (keep_nonzero ? 1 + h % 9 : h % 10));
+        h = mix(h);
+    }
+}
+
+void append_code_point(std::string& out, char32_t cp, std::size_t length) {
+    switch (length) {
+    case 2:
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+        break;
+    case 3:
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+        break;
+    default:
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+        break;
+    }
+}
+
+// Every character is replaced within its 128-code-point block, which
+// keeps both its script and its UTF-8 length; invalid bytes become '?'
+void redact_non_ascii(std::string_view run, uint64_t salt, std::string& out) {
+    uint64_t h = word_hash(run, salt);
+    std::size_t i = 0;
+    while (i < run.size()) {
+        const auto lead = static_cast<unsigned char>(run[i]);
+        const std::size_t length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+        bool valid = length > 1 && i + length <= run.size();
+        char32_t cp = length == 2 ? lead & 0x1F : length == 3 ? lead & 0x0F : lead & 0x07;
+        for (std::size_t k = 1; valid && k < length; ++k) {
+            const auto next = static_cast<unsigned char>(run[i + k]);
+            valid = (next & 0xC0) == 0x80;
+            cp = (cp << 6) | (next & 0x3F);
+        }
+        if (!valid) {
+            out += '?';
+            ++i;
+            continue;
+        }
+        char32_t low = static_cast<char32_t>(h & 0x7F);
+        if ((cp & ~char32_t{0x7F}) == 0x80) {
+            low |= 0x40;  // C1 controls: stay in Latin-1 letters
+        }
+        append_code_point(out, (cp & ~char32_t{0x7F}) | low, length);
+        h = mix(h);
+        i += length;
+    }
+}
+
+enum class CharClass { Letter, Digit, NonAscii, Other };
+
+[[nodiscard]] CharClass classify(char c) noexcept {
+    const auto u = static_cast<unsigned char>(c);
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) return CharClass::Letter;
+    if (c >= '0' && c <= '9') return CharClass::Digit;
+    if (u >= 0x80) return CharClass::NonAscii;
+    return CharClass::Other;
+}
+
+} // namespace
+
+void redact_text(std::string_view text, uint64_t salt, std::string& out) {
+    out.clear();
+    out.reserve(text.size());
+    std::size_t i = 0;
+    while (i < text.size()) {
+        const CharClass cls = classify(text[i]);
+        if (cls == CharClass::Other) {
+            out += text[i++];
+            continue;
+        }
+        std::size_t end = i + 1;
+        while (end < text.size() && classify(text[end]) == cls) {
+            ++end;
+        }
+        const std::string_view run = text.substr(i, end - i);
+        switch (cls) {
+        case CharClass::Letter:
+            redact_word(run, salt, out);
+            break;
+        case CharClass::Digit:
+            redact_digits(run, salt, out);
+            break;
+        default:
+            redact_non_ascii(run, salt, out);
+            break;
+        }
+        i = end;
+    }
+}
+
+[[nodiscard]] bool redact_snapshot(std::span<const std::byte> snapshot, uint64_t salt, std::string& out) {
+    auto parsed = ScreenSnapshot::parse(snapshot);
+    if (!parsed) {
+        return false;
+    }
+    const auto* base = reinterpret_cast<const char*>(snapshot.data());
+    out.assign(base, snapshot.size());
+
+    std::string label;
+    for (std::size_t i = 0; i < parsed->size(); ++i) {
+        const std::string_view text = parsed->element(i).label;
+        redact_text(text, salt, label);
+        // Same length, so offsets and the rest of the layout stay valid
+        out.replace(static_cast<std::size_t>(text.data() - base), text.size(), label);
+    }
+    return true;
+}
+
+// --- WorkloadRecorder ---
+
+WorkloadRecorder::~WorkloadRecorder() {
+    std::lock_guard lock(mutex_);
+    close_locked();
+}
+
+bool WorkloadRecorder::start(std::string_view path_view, bool redact) {
+    const std::string path(path_view);
+    std::lock_guard lock(mutex_);
+    close_locked();
+
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) {
+        LOGE("Cannot write workload to %s", path.c_str());
+        return false;
+    }
+    start_ns_ = monotonic_ns();
+    salt_ = (static_cast<uint64_t>(std::random_device{}()) << 32) ^ std::random_device{}() ^ start_ns_;
+    redact_ = redact;
+    written_ = 0;
+
+    const auto now = std::chrono::system_clock::now().time_since_epoch();
+    std::string header;
+    store<uint32_t>(header, WORKLOAD_MAGIC);
+    store<uint16_t>(header, WORKLOAD_VERSION);
+    store<uint16_t>(header, redact ? WORKLOAD_FLAG_REDACTED : 0);
+    store<uint64_t>(header, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now).count()));
+    std::fwrite(header.data(), 1, header.size(), file_);
+
+    active_.store(true, std::memory_order_relaxed);
+    LOGI("Workload recording to %s%s", path.c_str(), redact ? " (redacted)" : "");
+    return true;
+}
+
+std::size_t WorkloadRecorder::stop() {
+    std::lock_guard lock(mutex_);
+    const std::size_t written = written_;
+    close_locked();
+    return written;
+}
+
+void WorkloadRecorder::close_locked() {
+    active_.store(false, std::memory_order_relaxed);
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+        LOGI("Workload recording stopped: %zu requests", written_);
+    }
+}
+
+void WorkloadRecorder::record(WorkloadRecord record, const RequestMetrics& metrics) {
+    std::lock_guard lock(mutex_);
+    if (!file_) {
+        return;
+    }
+    if (redact_) {
+        std::string redacted;
+        redact_text(record.query, salt_, redacted);
+        record.query.swap(redacted);
+        if (record.kind == WorkloadKind::Snapshot) {
+            const auto* data = reinterpret_cast<const std::byte*>(record.screen.data());
+            if (!redact_snapshot({data, record.screen.size()}, salt_, redacted)) {
+                redacted.assign(record.screen.size(), '\0');  // unparsable: only its size is kept
+            }
+        } else if (record.kind == WorkloadKind::Streamed) {
+            redacted.clear();
+            std::string batch;
+            for (const auto packed : streamed_batches(record.screen)) {
+                if (!redact_snapshot(packed, salt_, batch)) break;
+                redacted += batch;
+            }
+            if (redacted.size() != record.screen.size()) {
+                redacted.assign(record.screen.size(), '\0');
+            }
+        } else {
+            redact_text(record.screen, salt_, redacted);
+        }
+        record.screen.swap(redacted);
+    }
+
+    buffer_.clear();
+    const std::size_t size = WORKLOAD_RECORD_HEADER_BYTES + record.query.size() + record.screen.size() +
+                             record.grammar_path.size() + record.stage.size();
+    store<uint32_t>(buffer_, static_cast<uint32_t>(size));
+    store<uint8_t>(buffer_, static_cast<uint8_t>(record.kind));
+    store<uint8_t>(buffer_, static_cast<uint8_t>(record.mode));
+    store<uint8_t>(buffer_, static_cast<uint8_t>(record.grammar));
+    store<uint8_t>(buffer_, static_cast<uint8_t>(metrics.source));
+    store<uint8_t>(buffer_, static_cast<uint8_t>(metrics.error));
+    store<uint8_t>(buffer_, 0);
+    store<uint16_t>(buffer_, metrics.grammar_id);
+    store<uint64_t>(buffer_, metrics.start_ns > start_ns_ ? (metrics.start_ns - start_ns_) / 1000 : 0);
+    store<float>(buffer_, record.temperature);
+    store<float>(buffer_, record.top_p);
+    store<int32_t>(buffer_, record.max_tokens);
+    store<uint32_t>(buffer_, saturate_us(metrics.phase_ns[static_cast<std::size_t>(MetricPhase::Total)]));
+    store<uint32_t>(buffer_, saturate_us(metrics.first_token_ns));
+    store<uint32_t>(buffer_, metrics.prompt_tokens);
+    store<uint32_t>(buffer_, metrics.reused_tokens);
+    store<uint32_t>(buffer_, metrics.output_tokens);
+    for (const std::string* field : {&record.query, &record.screen, &record.grammar_path, &record.stage}) {
+        store<uint32_t>(buffer_, static_cast<uint32_t>(field->size()));
+    }
+    for (const std::string* field : {&record.query, &record.screen, &record.grammar_path, &record.stage}) {
+        buffer_ += *field;
+    }
+
+    if (std::fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size()) {
+        LOGE("Workload write failed, recording stopped");
+        close_locked();
+        return;
+    }
+    ++written_;
+}
+
+// --- Reading ---
+
+[[nodiscard]] std::vector<std::span<const std::byte>> streamed_batches(std::string_view screen) {
+    std::vector<std::span<const std::byte>> batches;
+    std::span<const std::byte> rest(reinterpret_cast<const std::byte*>(screen.data()), screen.size());
+    while (!rest.empty()) {
+        const std::size_t size = ScreenSnapshot::packed_size(rest);
+        if (size == 0 || size > rest.size()) {
+            return {};
+        }
+        batches.push_back(rest.first(size));
+        rest = rest.subspan(size);
+    }
+    return batches;
+}
+
+[[nodiscard]] std::expected<Workload, std::string> read_workload(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return std::unexpected("Cannot open " + path);
+    }
+    std::string data;
+    char chunk[65536];
+    std::size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.append(chunk, n);
+    }
+    std::fclose(file);
+
+    if (data.size() < WORKLOAD_HEADER_BYTES || load<uint32_t>(data.data()) != WORKLOAD_MAGIC) {
+        return std::unexpected("Not a workload file");
+    }
+    const uint16_t version = load<uint16_t>(data.data() + 4);
+    if (version == 0 || version > WORKLOAD_VERSION) {
+        return std::unexpected("Unsupported workload version");
+    }
+
+    Workload workload;
+    workload.redacted = (load<uint16_t>(data.data() + 6) & WORKLOAD_FLAG_REDACTED) != 0;
+    workload.start_ms = load<uint64_t>(data.data() + 8);
+
+    std::size_t pos = WORKLOAD_HEADER_BYTES;
+    while (pos < data.size()) {
+        if (data.size() - pos < WORKLOAD_RECORD_HEADER_BYTES) {
+            // A recording cut off mid-write: keep what is complete
+            LOGW("Workload truncated after %zu records", workload.records.size());
+            break;
+        }
+        const char* p = data.data() + pos;
+        const std::size_t size = load<uint32_t>(p);
+        const std::array<uint32_t, 4> lengths = {
+            load<uint32_t>(p + 52), load<uint32_t>(p + 56), load<uint32_t>(p + 60), load<uint32_t>(p + 64),
+        };
+        uint64_t payload = 0;
+        for (uint32_t length : lengths) {
+            payload += length;
+        }
+        if (size != WORKLOAD_RECORD_HEADER_BYTES + payload) {
+            return std::unexpected("Corrupt workload record " + std::to_string(workload.records.size()));
+        }
+        if (size > data.size() - pos) {
+            LOGW("Workload truncated after %zu records", workload.records.size());
+            break;
+        }
+
+        WorkloadRecord r;
+        r.kind = static_cast<WorkloadKind>(load<uint8_t>(p + 4));
+        r.mode = static_cast<PromptMode>(load<uint8_t>(p + 5));
+        r.grammar = static_cast<WorkloadGrammar>(load<uint8_t>(p + 6));
+        r.source = static_cast<ResponseSource>(std::min<uint8_t>(load<uint8_t>(p + 7), RESPONSE_SOURCES - 1));
+        r.error = static_cast<RequestError>(
+            std::min<uint8_t>(load<uint8_t>(p + 8), static_cast<uint8_t>(RequestError::Count) - 1));
+        r.grammar_id = load<uint16_t>(p + 10);
+        r.offset_us = load<uint64_t>(p + 12);
+        r.temperature = load<float>(p + 20);
+        r.top_p = load<float>(p + 24);
+        r.max_tokens = load<int32_t>(p + 28);
+        r.total_us = load<uint32_t>(p + 32);
+        r.first_token_us = load<uint32_t>(p + 36);
+        r.prompt_tokens = load<uint32_t>(p + 40);
+        r.reused_tokens = load<uint32_t>(p + 44);
+        r.output_tokens = load<uint32_t>(p + 48);
+
+        const char* field = p + WORKLOAD_RECORD_HEADER_BYTES;
+        r.query.assign(field, lengths[0]);
+        field += lengths[0];
+        r.screen.assign(field, lengths[1]);
+        field += lengths[1];
+        r.grammar_path.assign(field, lengths[2]);
+        field += lengths[2];
+        r.stage.assign(field, lengths[3]);
+
+        workload.records.push_back(std::move(r));
+        pos += size;
+    }
+    return workload;
+}
+
+} // namespace sentinel_native
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <expected>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "native_metrics.hpp"
+#include "native_request.hpp"
+
+namespace sentinel_native {
+
+/**
+ * Recorded request stream, for replaying real traffic through the engine
+ * (tools/replay.cpp). A file is a header followed by records, all fields
+ * little-endian:
+ *
+ *   u32 magic 'SNWL' | u16 version | u16 flags (WORKLOAD_FLAG_*) | u64 start, Unix ms
+ *
+ *   u32 record_bytes            whole record, this field included
+ *   u8  kind | u8 mode | u8 grammar | u8 source | u8 error | u8 pad | u16 grammar_id
+ *   u64 offset_us               arrival, since the recording started
+ *   f32 temperature | f32 top_p | i32 max_tokens
+ *   u32 total_us | u32 first_token_us
+ *   u32 prompt_tokens | u32 reused_tokens | u32 output_tokens
+ *   u32 query_bytes | u32 screen_bytes | u32 grammar_bytes | u32 stage_bytes
+ *   query | screen | grammar path | stage
+ *
+ * Snapshot requests store the packed snapshot as the screen, streamed
+ * requests the packed batches the stream received, back to back. A
+ * stream is pruned against the query it began with, which the app sets to
+ * the request's query; replay begins it with the recorded query.
+ *
+ * Version 2 added the Streamed kind; version 1 files still read.
+ */
+inline constexpr uint32_t WORKLOAD_MAGIC = 0x4C574E53;  // "SNWL"
+inline constexpr uint16_t WORKLOAD_VERSION = 2;
+inline constexpr std::size_t WORKLOAD_HEADER_BYTES = 16;
+inline constexpr std::size_t WORKLOAD_RECORD_HEADER_BYTES = 68;
+
+// Query and screen text were replaced by redact_text
+inline constexpr uint16_t WORKLOAD_FLAG_REDACTED = 1 << 0;
+
+enum class WorkloadKind : uint8_t {
+    Text,      // string screen (infer_locked)
+    Snapshot,  // packed snapshot (infer_snapshot_locked)
+    Streamed,  // packed batches (begin_screen ... infer_streamed_locked)
+};
+
+enum class WorkloadGrammar : uint8_t {
+    Engine,  // the engine's own grammar
+    None,
+    Path,    // grammar_path
+};
+
+struct WorkloadRecord {
+    uint64_t offset_us = 0;
+    WorkloadKind kind = WorkloadKind::Text;
+    PromptMode mode = PromptMode::Agent;
+    WorkloadGrammar grammar = WorkloadGrammar::Engine;
+    uint16_t grammar_id = 0;
+    float temperature = 0.0f;
+    float top_p = 0.0f;
+    int32_t max_tokens = 0;
+
+    // Outcome when recorded
+    ResponseSource source = ResponseSource::Model;
+    RequestError error = RequestError::None;
+    uint32_t total_us = 0;
+    uint32_t first_token_us = 0;
+    uint32_t prompt_tokens = 0;
+    uint32_t reused_tokens = 0;
+    uint32_t output_tokens = 0;
+
+    std::string query;
+    std::string screen;
+    std::string grammar_path;
+    std::string stage;
+};
+
+struct Workload {
+    bool redacted = false;
+    uint64_t start_ms = 0;
+    std::vector<WorkloadRecord> records;
+};
+
+/**
+ * Opt-in capture of request shapes to a local file. While stopped, a
+ * request pays one relaxed load. While recording, each request appends
+ * one record (its query and screen plus 68 bytes) to a buffered file
+ * under a mutex on the request thread.
+ *
+ * With redaction, query and screen text go through redact_text before
+ * they reach the file: lengths, word boundaries, repetition and script
+ * survive, content does not. The stage names an adapter and is kept. The
+ * salt is random per recording and never stored.
+ */
+class WorkloadRecorder {
+public:
+    WorkloadRecorder() = default;
+    WorkloadRecorder(const WorkloadRecorder&) = delete;
+    WorkloadRecorder& operator=(const WorkloadRecorder&) = delete;
+    ~WorkloadRecorder();
+
+    // Starts a new file at `path`, ending any recording in progress
+    bool start(std::string_view path, bool redact);
+
+    // @return records written since start
+    std::size_t stop();
+
+    [[nodiscard]] bool recording() const noexcept { return active_.load(std::memory_order_relaxed); }
+
+    // Append `record`; arrival and total time come from `metrics`, which
+    // must be closed (RequestScope::close) so the Total phase is set.
+    void record(WorkloadRecord record, const RequestMetrics& metrics);
+
+private:
+    void close_locked();
+
+    std::atomic<bool> active_{false};
+    std::mutex mutex_;
+    std::FILE* file_ = nullptr;
+    uint64_t start_ns_ = 0;
+    uint64_t salt_ = 0;
+    bool redact_ = false;
+    std::size_t written_ = 0;
+    std::string buffer_;
+};
+
+extern WorkloadRecorder g_workload_recorder;
+
+/**
+ * Content-free stand-in for `text` with the same byte length. ASCII words
+ * become common English words of the same length and case pattern, digit
+ * runs other digits, and non-ASCII characters other characters of the
+ * same Unicode block, so token counts stay close. Equal words map to equal
+ * words under one salt, which keeps cache behaviour. Punctuation,
+ * whitespace and the words of the screen list format are kept.
+ */
+void redact_text(std::string_view text, uint64_t salt, std::string& out);
+
+// Packed snapshot with every label passed through redact_text in place;
+// false if `snapshot` does not parse
+[[nodiscard]] bool redact_snapshot(std::span<const std::byte> snapshot, uint64_t salt, std::string& out);
+
+// The batches of a Streamed record's screen, in order; empty if the bytes
+// do not split into whole packed snapshots
+[[nodiscard]] std::vector<std::span<const std::byte>> streamed_batches(std::string_view screen);
+
+[[nodiscard]] std::expected<Workload, std::string> read_workload(const std::string& path);
+
+} // namespace sentinel_native
@@ -15,9 +15,11 @@ inline constexpr std::string_view INJECTION_PATTERNS[] = {
     "pretend to be", "jailbreak", "DAN mode", "developer mode"
 };
 
-// Input sanitizer - inline for simplicity
-inline std::string sanitize(std::string_view input, std::size_t max_len = 4096) {
-    std::string result;
+// Input sanitizer - writes into a caller-owned string (e.g. std::pmr::string
+// backed by the request arena) so the hot path does not allocate
+template <typename String>
+inline void sanitize_into(std::string_view input, String& result, std::size_t max_len = 4096) {
+    result.clear();
     result.reserve(std::min(input.size(), max_len));
     
     bool last_space = false;
@@ -32,21 +34,32 @@ inline std::string sanitize(std::string_view input, std::size_t max_len = 4096)
         }
     }
     
-    // Trim
+    // Trim in place
     auto start = result.find_first_not_of(" \n\t");
+    if (start == String::npos) {
+        result.clear();
+        return;
+    }
     auto end = result.find_last_not_of(" \n\t");
-    if (start == std::string::npos) return "";
-    return result.substr(start, end - start + 1);
+    result.erase(end + 1);
+    result.erase(0, start);
+}
+
+inline std::string sanitize(std::string_view input, std::size_t max_len = 4096) {
+    std::string result;
+    sanitize_into(input, result, max_len);
+    return result;
 }
 
+// Case-insensitive scan without building a lowered copy of the input
 inline bool contains_injection(std::string_view input) {
-    std::string lower;
-    lower.reserve(input.size());
-    for (char c : input) {
-        lower.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
-    }
+    auto lower = [](char c) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    };
     for (auto pattern : INJECTION_PATTERNS) {
-        if (lower.find(pattern) != std::string::npos) return true;
+        auto it = std::search(input.begin(), input.end(), pattern.begin(), pattern.end(),
+            [&](char a, char b) { return lower(a) == lower(b); });
+        if (it != input.end()) return true;
     }
     return false;
 }
@@ -0,0 +1,190 @@
+// sentinel-resolver-test: pinned vectors for the target resolver's edit
+// distances and match scores. Run through ctest on host builds.
+
+#include <cmath>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "native_resolver.hpp"
+#include "native_snapshot.hpp"
+
+using namespace sentinel_native;
+
+namespace {
+
+int g_failures = 0;
+
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            std::fprintf(stderr, "%s:%d: CHECK(%s)\n", __FILE__, __LINE__, #cond);  \
+            ++g_failures;                                                           \
+        }                                                                           \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                              \
+    do {                                                                            \
+        const auto va = (a);                                                        \
+        const auto vb = (b);                                                        \
+        if (va != vb) {                                                             \
+            std::fprintf(stderr, "%s:%d: %s == %s (%lld vs %lld)\n", __FILE__,      \
+                         __LINE__, #a, #b, static_cast<long long>(va),              \
+                         static_cast<long long>(vb));                               \
+            ++g_failures;                                                           \
+        }                                                                           \
+    } while (0)
+
+#define CHECK_NEAR(a, b)                                                            \
+    do {                                                                            \
+        const float va = (a);                                                       \
+        const float vb = (b);                                                       \
+        if (std::fabs(va - vb) > 1e-4f) {                                           \
+            std::fprintf(stderr, "%s:%d: %s ~= %s (%f vs %f)\n", __FILE__,          \
+                         __LINE__, #a, #b, va, vb);                                 \
+            ++g_failures;                                                           \
+        }                                                                           \
+    } while (0)
+
+template <typename T>
+void put(std::vector<std::byte>& out, T value) {
+    const auto* bytes = reinterpret_cast<const std::byte*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+// Snapshot in ElementRegistry.writeSnapshot format, every element clickable
+[[nodiscard]] std::vector<std::byte> pack(const std::vector<std::pair<int32_t, std::string_view>>& elements) {
+    std::string blob;
+    for (const auto& [id, label] : elements) blob += label;
+
+    std::vector<std::byte> out;
+    put(out, SNAPSHOT_MAGIC);
+    put(out, SNAPSHOT_VERSION);
+    put(out, uint16_t{0});
+    put(out, static_cast<uint32_t>(elements.size()));
+    put(out, static_cast<uint32_t>(blob.size()));
+    for (const auto& [id, label] : elements) put(out, id);
+    for (std::size_t i = 0; i < elements.size(); ++i) {
+        const auto top = static_cast<int32_t>(i * 100);
+        for (int32_t v : {0, top, 1080, top + 100}) put(out, v);
+    }
+    uint32_t offset = 0;
+    for (const auto& [id, label] : elements) {
+        put(out, offset);
+        offset += static_cast<uint32_t>(label.size());
+    }
+    for (const auto& [id, label] : elements) put(out, static_cast<uint32_t>(label.size()));
+    for (std::size_t i = 0; i < elements.size(); ++i) put(out, SNAPSHOT_FLAG_CLICKABLE);
+    while (out.size() % 4 != 0) out.push_back(std::byte{0});
+    const auto* bytes = reinterpret_cast<const std::byte*>(blob.data());
+    out.insert(out.end(), bytes, bytes + blob.size());
+    return out;
+}
+
+void test_myers_distance() {
+    CHECK_EQ(myers_distance("kitten", "sitting", 10), 3u);
+    CHECK_EQ(myers_distance("settings", "setings", 2), 1u);
+    CHECK_EQ(myers_distance("abc", "abc", 0), 0u);
+    CHECK_EQ(myers_distance("", "abc", 5), 3u);
+    CHECK_EQ(myers_distance("abc", "", 5), 3u);
+    // Over the bound: bound + 1, not the true distance (6)
+    CHECK_EQ(myers_distance("abcdef", "uvwxyz", 2), 3u);
+
+    // Full 64-bit word, one substitution and one deletion
+    const std::string pattern(64, 'a');
+    std::string text = pattern;
+    text[10] = 'b';
+    text.erase(40, 1);
+    CHECK_EQ(myers_distance(pattern, text, 5), 2u);
+}
+
+void test_dp_distance() {
+    std::vector<uint32_t> row;
+    CHECK_EQ(dp_distance("kitten", "sitting", row), 3u);
+    CHECK_EQ(dp_distance("flaw", "lawn", row), 2u);
+    CHECK_EQ(dp_distance("", "", row), 0u);
+    CHECK_EQ(dp_distance("abc", "", row), 3u);
+
+    // Longer than one word: the case myers_distance cannot take
+    std::string a;
+    for (int i = 0; i < 100; ++i) a += static_cast<char>('a' + i % 26);
+    std::string b = a;
+    b[5] = '#';
+    b[50] = '#';
+    b.insert(80, "xy");
+    CHECK_EQ(dp_distance(a, b, row), 4u);
+
+    // Agrees with myers_distance wherever both apply
+    const std::pair<std::string_view, std::string_view> pairs[] = {
+        {"wi fi settings", "wifi setting"}, {"send message", "send a message"}, {"search", "serch"},
+        {"camera", "a"}, {"navigate up", "navigate"},
+    };
+    for (const auto& [p, t] : pairs) {
+        CHECK_EQ(myers_distance(p, t, 64), dp_distance(p, t, row));
+    }
+}
+
+// Best match for `target`, {-1, 0} if none
+[[nodiscard]] TargetMatch best(TargetResolver& resolver, std::string_view target) {
+    TargetMatch out[4];
+    const std::size_t n = resolver.resolve(target, out);
+    return n ? out[0] : TargetMatch{-1, 0.0f};
+}
+
+void test_resolve() {
+    const auto bytes = pack({
+        {1, "Camera"},
+        {2, "Wi-Fi settings"},
+        {3, "Send message"},
+        {4, "Search"},
+        {5, "OK"},
+    });
+    auto snapshot = ScreenSnapshot::parse(bytes);
+    CHECK(snapshot.has_value());
+    if (!snapshot) return;
+
+    TargetResolver resolver;
+    resolver.load(*snapshot);
+    CHECK_EQ(resolver.size(), std::size_t{5});
+
+    CHECK_EQ(best(resolver, "3").id, 3);
+    CHECK_NEAR(best(resolver, "3").score, 1.0f);
+    CHECK_EQ(best(resolver, "Camera").id, 1);
+    CHECK_NEAR(best(resolver, "Camera").score, 1.0f);
+    CHECK_EQ(best(resolver, " \"wi fi SETTINGS\" ").id, 2);
+    CHECK_NEAR(best(resolver, " \"wi fi SETTINGS\" ").score, 0.95f);
+    CHECK_EQ(best(resolver, "ok").id, 5);
+    CHECK_NEAR(best(resolver, "ok").score, 0.95f);
+
+    // Substring: 0.7 + 0.2 * shorter / longer
+    CHECK_EQ(best(resolver, "settings").id, 2);
+    CHECK_NEAR(best(resolver, "settings").score, 0.7f + 0.2f * 8 / 14);
+    CHECK_EQ(best(resolver, "cam").id, 1);
+    CHECK_NEAR(best(resolver, "cam").score, 0.8f);
+
+    // One edit in six bytes: 0.9 * (1 - 1/6)
+    CHECK_EQ(best(resolver, "Serch").id, 4);
+    CHECK_NEAR(best(resolver, "Serch").score, 0.75f);
+
+    // Too short for substring credit: "a" is in "camera" and "search"
+    CHECK_EQ(best(resolver, "a").id, -1);
+    CHECK_EQ(best(resolver, "se").id, -1);
+    CHECK_EQ(best(resolver, "9").id, -1);
+}
+
+} // namespace
+
+int main() {
+    test_myers_distance();
+    test_dp_distance();
+    test_resolve();
+    if (g_failures) {
+        std::fprintf(stderr, "%d checks failed\n", g_failures);
+        return 1;
+    }
+    std::printf("resolver tests passed\n");
+    return 0;
+}
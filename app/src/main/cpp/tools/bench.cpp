@@ -0,0 +1,173 @@
+// sentinel-bench: end-to-end request latency of a GGUF model on the host,
+// through the same sentinel_core path the app calls (sanitize, chat
+// template, tokenize, prefill, grammar-constrained sampling; see harness.hpp).
+//
+//   sentinel-bench -m model.gguf [-q query] [--query-bytes n] [-s elements | -S screen.txt]
+//                  [-g grammar] [--assets dir] [--passthrough] [-n max_tokens] [-t threads]
+//                  [-c n_ctx] [-b n_batch] [--temp t] [--json] [-r runs] [-w warmup] [--warm] [--router]
+//
+// Reports time to first token, prefill and decode tokens/s and total
+// latency (p50/p95/p99 over the runs). Each run starts from an empty KV
+// cache unless --warm is given, which measures prompt prefix reuse
+// instead. The fast-path router is off unless --router is given, so every
+// run reaches the model.
+//
+// -g takes a .gbnf path or the name of a grammar in --assets (default
+// app/src/main/assets), e.g. -g agent. -s renders that many synthetic
+// elements the way ElementRegistry.toPromptString does; -S uses a real
+// screen dump instead. --query-bytes repeats the query up to that size.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "harness.hpp"
+
+using namespace sentinel_native;
+using namespace sentinel_tools;
+
+namespace {
+
+struct Options {
+    HarnessOptions harness;
+    int runs = 10;
+    int warmup = 1;
+    bool warm = false;
+};
+
+[[noreturn]] void usage(const char* argv0) {
+    std::fprintf(stderr, "usage: %s %s\n          [-r runs] [-w warmup] [--warm] [--router]\n", argv0,
+                 HARNESS_USAGE);
+    std::exit(2);
+}
+
+[[nodiscard]] Options parse_args(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        if (parse_harness_arg(opt.harness, argc, argv, i, usage)) {
+            continue;
+        }
+        const std::string_view arg = argv[i];
+        const auto value = [&]() -> const char* {
+            if (i + 1 >= argc) usage(argv[0]);
+            return argv[++i];
+        };
+        if (arg == "-r") {
+            opt.runs = std::max(std::atoi(value()), 1);
+        } else if (arg == "-w") {
+            opt.warmup = std::max(std::atoi(value()), 0);
+        } else if (arg == "--warm") {
+            opt.warm = true;
+        } else if (arg == "--router") {
+            opt.harness.router = true;
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (opt.harness.model.empty()) {
+        usage(argv[0]);
+    }
+    return opt;
+}
+
+struct Run {
+    double total_ms;
+    double first_token_ms;
+    uint32_t prompt_tokens;
+    uint32_t reused_tokens;
+    uint32_t output_tokens;
+    double prefill_tps;
+    double decode_tps;
+    ResponseSource source;
+    RequestError error;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const Options opt = parse_args(argc, argv);
+    const HarnessOptions& h = opt.harness;
+    const auto workload = build_workload(h);
+    if (!workload) {
+        return 1;
+    }
+
+    Engine engine;
+    if (!load_engine(engine, h, *workload)) {
+        return 1;
+    }
+    const InferCall call = workload->call();
+
+    std::vector<Run> runs;
+    runs.reserve(static_cast<std::size_t>(opt.runs));
+    for (int i = 0; i < opt.warmup + opt.runs; ++i) {
+        const RunResult run = run_request(engine, call, /*cold=*/!opt.warm);
+        if (i < opt.warmup) {
+            continue;
+        }
+
+        const RequestMetrics& m = run.metrics;
+        runs.push_back({
+            .total_ms = run.wall_ns / 1e6,
+            .first_token_ms = m.first_token_ns / 1e6,
+            .prompt_tokens = m.prompt_tokens,
+            .reused_tokens = m.reused_tokens,
+            .output_tokens = m.output_tokens,
+            .prefill_tps = m.prefill_tps(),
+            .decode_tps = m.decode_tps(),
+            .source = m.source,
+            .error = m.error,
+        });
+        if (m.source != ResponseSource::Model) {
+            std::fprintf(stderr, "run %d answered by %.*s: %s\n", i - opt.warmup,
+                         static_cast<int>(response_source_name(m.source).size()),
+                         response_source_name(m.source).data(), run.response.c_str());
+        }
+    }
+
+    const Summary total = summarize(runs, [](const Run& r) { return r.total_ms; });
+    const Summary first_token = summarize(runs, [](const Run& r) { return r.first_token_ms; });
+    const Summary prefill = summarize(runs, [](const Run& r) { return r.prefill_tps; });
+    const Summary decode = summarize(runs, [](const Run& r) { return r.decode_tps; });
+    const Run& last = runs.back();
+
+    if (h.json) {
+        std::printf(R"({"model":%s,"grammar":%s,"mode":"%s","threads":%d,"n_ctx":%d,"max_tokens":%d,)"
+                    R"("warm":%s,"query_bytes":%zu,"screen_bytes":%zu,"runs":%zu,"prompt_tokens":%u,)",
+                    json_string(h.model).c_str(), json_string(workload->grammar).c_str(),
+                    h.mode == PromptMode::Agent ? "agent" : "passthrough", h.n_threads, h.n_ctx, h.max_tokens,
+                    opt.warm ? "true" : "false", workload->query.size(), workload->screen.size(), runs.size(),
+                    last.prompt_tokens);
+        print_summary_json("total_ms", total, true);
+        print_summary_json("first_token_ms", first_token, false);
+        print_summary_json("prefill_tps", prefill, false);
+        print_summary_json("decode_tps", decode, false);
+        std::printf(R"(,"samples":[)");
+        for (std::size_t i = 0; i < runs.size(); ++i) {
+            const Run& r = runs[i];
+            std::printf(R"(%s{"total_ms":%.3f,"first_token_ms":%.3f,"prompt_tokens":%u,"reused_tokens":%u,)"
+                        R"("output_tokens":%u,"prefill_tps":%.1f,"decode_tps":%.1f,"source":"%.*s","error":"%.*s"})",
+                        i ? "," : "", r.total_ms, r.first_token_ms, r.prompt_tokens, r.reused_tokens,
+                        r.output_tokens, r.prefill_tps, r.decode_tps,
+                        static_cast<int>(response_source_name(r.source).size()), response_source_name(r.source).data(),
+                        static_cast<int>(request_error_name(r.error).size()), request_error_name(r.error).data());
+        }
+        std::printf("]}\n");
+    } else {
+        std::printf("model            %s\n", h.model.c_str());
+        std::printf("grammar          %s\n", workload->grammar.empty() ? "(none)" : workload->grammar.c_str());
+        std::printf("prompt           %u tokens (query %zu bytes, screen %zu bytes), %s KV cache\n",
+                    last.prompt_tokens, workload->query.size(), workload->screen.size(), opt.warm ? "warm" : "cold");
+        std::printf("runs             %zu (+%d warmup), %d threads, max_tokens %d\n", runs.size(), opt.warmup,
+                    h.n_threads, h.max_tokens);
+        std::printf("\n%-16s %10s %10s %10s %10s\n", "", "p50", "p95", "p99", "mean");
+        print_summary_row("total ms", total, 16);
+        print_summary_row("first token ms", first_token, 16);
+        print_summary_row("prefill tok/s", prefill, 16);
+        print_summary_row("decode tok/s", decode, 16);
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include "harness.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+
+#include "native_arena.hpp"
+#include "native_kv.hpp"
+#include "native_router.hpp"
+#include "native_trace.hpp"
+#include "native_utils.hpp"
+
+using namespace sentinel_native;
+
+namespace sentinel_tools {
+
+namespace {
+
+// Labels of a typical settings/messaging screen, cycled
+constexpr std::string_view LABELS[] = {
+    "Search settings", "Network & internet", "Connected devices", "Apps", "Notifications",
+    "Battery", "Storage", "Sound & vibration", "Display", "Dark theme", "Wallpaper & style",
+    "Accessibility", "Security & privacy", "Location", "Passwords & accounts", "System",
+    "Send message", "Type a message", "Attach file", "Back", "More options", "Navigate up",
+};
+
+[[nodiscard]] std::string synthetic_screen(int elements) {
+    if (elements == 0) {
+        return "[No interactive elements visible]";
+    }
+    std::string out = "Available UI elements (use element_id):\n";
+    for (int i = 0; i < elements; ++i) {
+        const std::string_view label = LABELS[static_cast<std::size_t>(i) % std::size(LABELS)];
+        const char* flags = i % 7 == 1 ? "click|edit" : i % 11 == 5 ? "scroll" : "click";
+        out += "  " + std::to_string(i + 1) + ". [" + flags + "] " + std::string(label) + "\n";
+    }
+    return out;
+}
+
+[[nodiscard]] std::string read_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    return buffer.str();
+}
+
+// A path as given, else <assets>/<name>.gbnf
+[[nodiscard]] std::string grammar_path(const HarnessOptions& opt) {
+    if (opt.grammar.empty() || std::filesystem::exists(opt.grammar)) {
+        return opt.grammar;
+    }
+    return (std::filesystem::path(opt.assets) / (opt.grammar + ".gbnf")).string();
+}
+
+} // namespace
+
+bool parse_harness_arg(HarnessOptions& opt, int argc, char** argv, int& i, void (*usage)(const char* argv0)) {
+    const std::string_view arg = argv[i];
+    const auto value = [&]() -> const char* {
+        if (i + 1 >= argc) usage(argv[0]);
+        return argv[++i];
+    };
+    if (arg == "-m") {
+        opt.model = value();
+    } else if (arg == "-q") {
+        opt.query = value();
+    } else if (arg == "--query-bytes") {
+        opt.query_bytes = static_cast<std::size_t>(std::max(std::atoi(value()), 0));
+    } else if (arg == "-s") {
+        opt.screen_elements = std::max(std::atoi(value()), 0);
+    } else if (arg == "-S") {
+        opt.screen_file = value();
+    } else if (arg == "-g") {
+        opt.grammar = value();
+    } else if (arg == "--assets") {
+        opt.assets = value();
+    } else if (arg == "--passthrough") {
+        opt.mode = PromptMode::Passthrough;
+    } else if (arg == "-n") {
+        opt.max_tokens = std::atoi(value());
+    } else if (arg == "-t") {
+        opt.n_threads = std::atoi(value());
+    } else if (arg == "-c") {
+        opt.n_ctx = std::atoi(value());
+    } else if (arg == "-b") {
+        opt.n_batch = std::atoi(value());
+    } else if (arg == "--temp") {
+        opt.temperature = static_cast<float>(std::atof(value()));
+    } else if (arg == "--json") {
+        opt.json = true;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::optional<Workload> build_workload(const HarnessOptions& opt) {
+    Workload workload;
+    workload.mode = opt.mode;
+
+    workload.query = opt.query;
+    while (opt.query_bytes > workload.query.size()) {
+        workload.query += ' ';
+        workload.query += opt.query;
+    }
+    if (opt.query_bytes > 0) {
+        workload.query.resize(opt.query_bytes);
+    }
+
+    workload.screen = opt.screen_file.empty() ? synthetic_screen(opt.screen_elements) : read_file(opt.screen_file);
+
+    workload.grammar = grammar_path(opt);
+    if (!workload.grammar.empty() && !std::filesystem::exists(workload.grammar)) {
+        std::fprintf(stderr, "grammar not found: %s\n", workload.grammar.c_str());
+        return std::nullopt;
+    }
+    return workload;
+}
+
+bool load_engine(Engine& engine, const HarnessOptions& opt, const Workload& workload, bool profile_ops) {
+    g_intent_router.set_enabled(opt.router);
+    {
+        std::unique_lock lock(engine.mutex);
+        engine.n_ctx = opt.n_ctx;
+        engine.n_batch = opt.n_batch;
+        engine.n_threads = opt.n_threads;
+        engine.set_profile_ops(profile_ops);
+    }
+    if (!init_engine(engine, opt.model, workload.grammar)) {
+        std::fprintf(stderr, "failed to load %s\n", opt.model.c_str());
+        return false;
+    }
+    // Tools drive the engine from one thread: its defaults are read unlocked
+    set_params(engine, opt.temperature < 0.0f ? engine.temperature : opt.temperature, engine.top_p,
+               opt.max_tokens);
+    return true;
+}
+
+void set_max_tokens(Engine& engine, int max_tokens) {
+    set_params(engine, engine.temperature, engine.top_p, max_tokens);
+}
+
+RunResult run_request(Engine& engine, const InferCall& call, bool cold) {
+    std::unique_lock lock(engine.mutex);
+    if (cold) {
+        invalidate_kv(engine);
+    }
+    ArenaScope arena(engine.arena);
+
+    RunResult run;
+    // Outer scope: the request's own scope nests into it, so the metrics
+    // are still at hand once infer_locked returns
+    RequestScope scope(engine);
+    const uint64_t start = monotonic_ns();
+    run.response = std::string(infer_locked(engine, call, arena.resource()));
+    run.wall_ns = monotonic_ns() - start;
+    if (const RequestMetrics* metrics = scope.close()) {
+        run.metrics = *metrics;
+    }
+    return run;
+}
+
+std::string json_string(std::string_view text) {
+    std::string out = "\"";
+    append_json_escaped(text, out);
+    out += '"';
+    return out;
+}
+
+double percentile(std::vector<double>& values, double q) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    const auto rank = static_cast<std::size_t>(std::ceil(q * static_cast<double>(values.size())));
+    return values[std::clamp<std::size_t>(rank, 1, values.size()) - 1];
+}
+
+void print_summary_json(const char* name, const Summary& s, bool first) {
+    std::printf(R"(%s"%s":{"p50":%.3f,"p95":%.3f,"p99":%.3f,"mean":%.3f})", first ? "" : ",", name, s.p50,
+                s.p95, s.p99, s.mean);
+}
+
+void print_summary_row(const char* name, const Summary& s, int name_width) {
+    std::printf("%-*s %10.2f %10.2f %10.2f %10.2f\n", name_width, name, s.p50, s.p95, s.p99, s.mean);
+}
+
+} // namespace sentinel_tools
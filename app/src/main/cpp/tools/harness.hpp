@@ -0,0 +1,125 @@
+#pragma once
+
+// Setup shared by the host tools: one Engine loaded the way the app loads
+// it (init_engine -> Engine::load) and requests sent through infer_locked,
+// so a tool measures the same path NativeBridge.infer runs rather than a
+// hand-rolled llama.cpp loop.
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "native_api.hpp"
+#include "native_engine.hpp"
+#include "native_metrics.hpp"
+
+namespace sentinel_tools {
+
+struct HarnessOptions {
+    std::string model;
+    std::string query = "Open the settings app and enable dark mode";
+    std::size_t query_bytes = 0;  // repeat the query up to this size, 0 = as given
+    int screen_elements = 20;
+    std::string screen_file;
+    std::string grammar;  // .gbnf path or a grammar name in `assets`
+    std::string assets = "app/src/main/assets";
+    sentinel_native::PromptMode mode = sentinel_native::PromptMode::Agent;
+    int max_tokens = 64;
+    int n_threads = 4;
+    int n_ctx = 4096;
+    int n_batch = 512;
+    float temperature = -1.0f;  // engine default
+    bool router = false;        // off so that every request reaches the model
+    bool json = false;
+};
+
+// Usage text of the flags parse_harness_arg accepts
+inline constexpr const char* HARNESS_USAGE =
+    "-m model.gguf [-q query] [--query-bytes n] [-s elements | -S screen.txt]\n"
+    "          [-g grammar] [--assets dir] [--passthrough] [-n max_tokens] [-t threads]\n"
+    "          [-c n_ctx] [-b n_batch] [--temp t] [--json]";
+
+/**
+ * Consume argv[i], plus its value, if it is a harness flag. `usage` is
+ * called when the value is missing and must not return.
+ *
+ * @return false if the flag is not a harness flag; the tool parses it
+ */
+[[nodiscard]] bool parse_harness_arg(HarnessOptions& opt, int argc, char** argv, int& i,
+                                     void (*usage)(const char* argv0));
+
+// The request every run sends. InferCall views into these strings.
+struct Workload {
+    std::string query;
+    std::string screen;
+    std::string grammar;  // resolved path, empty = no grammar
+    sentinel_native::PromptMode mode = sentinel_native::PromptMode::Agent;
+
+    [[nodiscard]] sentinel_native::InferCall call() const {
+        return {.user_query = query, .screen_context = screen, .mode = mode};
+    }
+};
+
+// Query, screen (synthetic like ElementRegistry.toPromptString, or -S) and
+// grammar for `opt`; nullopt with a message if the grammar is missing
+[[nodiscard]] std::optional<Workload> build_workload(const HarnessOptions& opt);
+
+// Apply the context settings and load the model with the workload's
+// grammar; false with a message if loading fails
+[[nodiscard]] bool load_engine(sentinel_native::Engine& engine, const HarnessOptions& opt, const Workload& workload,
+                               bool profile_ops = false);
+
+// Generation limit for the following requests
+void set_max_tokens(sentinel_native::Engine& engine, int max_tokens);
+
+struct RunResult {
+    std::string response;
+    sentinel_native::RequestMetrics metrics;  // closed: Total is set
+    uint64_t wall_ns = 0;
+};
+
+// One request through infer_locked. `cold` empties the KV cache first; a
+// warm request reuses the prefix the previous one left behind.
+[[nodiscard]] RunResult run_request(sentinel_native::Engine& engine, const sentinel_native::InferCall& call, bool cold);
+
+// `text` as a quoted JSON string
+[[nodiscard]] std::string json_string(std::string_view text);
+
+// Nearest-rank percentile of `values`, which it sorts
+[[nodiscard]] double percentile(std::vector<double>& values, double q);
+
+struct Summary {
+    double p50;
+    double p95;
+    double p99;
+    double mean;
+};
+
+// Percentiles and mean of `field` over `runs`
+template <typename Run, typename Field>
+[[nodiscard]] Summary summarize(const std::vector<Run>& runs, Field field) {
+    std::vector<double> values;
+    values.reserve(runs.size());
+    double sum = 0.0;
+    for (const Run& run : runs) {
+        values.push_back(field(run));
+        sum += values.back();
+    }
+    return {
+        .p50 = percentile(values, 0.50),
+        .p95 = percentile(values, 0.95),
+        .p99 = percentile(values, 0.99),
+        .mean = runs.empty() ? 0.0 : sum / static_cast<double>(runs.size()),
+    };
+}
+
+// `"name":{...}`, preceded by a comma unless `first`
+void print_summary_json(const char* name, const Summary& s, bool first);
+
+// One row of a p50/p95/p99/mean table, the name padded to `name_width`
+void print_summary_row(const char* name, const Summary& s, int name_width);
+
+} // namespace sentinel_tools
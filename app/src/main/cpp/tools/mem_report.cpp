@@ -0,0 +1,128 @@
+// sentinel-mem-report: memory footprint of a GGUF model on the host, using
+// the same probes as NativeBridge.getMemoryStats.
+//
+//   sentinel-mem-report -m model.gguf [-q query] [-s elements | -S screen.txt] [-g grammar]
+//                       [-n gen_tokens] [-t threads] [-c n_ctx] [-b n_batch] [--json] ...
+//
+// Reports the weights (tensor bytes, mapped and resident pages of the file)
+// after load, after prefill and after decode, the context allocation split
+// into KV cache and compute buffers, and the heap growth of one request.
+// Requests go through the app's request path (see harness.hpp); prefill
+// and decode are a cold request stopped at its first token and the same
+// request again on the warm KV cache. Run it once per n_ctx to size
+// contexts for a device tier.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "harness.hpp"
+#include "native_memory.hpp"
+#include "native_residency.hpp"
+
+using namespace sentinel_native;
+using namespace sentinel_tools;
+
+namespace {
+
+[[noreturn]] void usage(const char* argv0) {
+    std::fprintf(stderr, "usage: %s %s\n", argv0, HARNESS_USAGE);
+    std::exit(2);
+}
+
+[[nodiscard]] HarnessOptions parse_args(int argc, char** argv) {
+    HarnessOptions opt;
+    opt.max_tokens = 32;
+    for (int i = 1; i < argc; ++i) {
+        if (!parse_harness_arg(opt, argc, argv, i, usage)) {
+            usage(argv[0]);
+        }
+    }
+    if (opt.model.empty()) {
+        usage(argv[0]);
+    }
+    return opt;
+}
+
+[[nodiscard]] double mib(uint64_t bytes) noexcept {
+    return bytes / 1048576.0;
+}
+
+// The engine on `model`, as getMemoryStats reports it
+[[nodiscard]] EngineMemory engine_memory(const std::string& model) {
+    for (EngineMemory& m : residency().memory()) {
+        if (m.model_path == model) {
+            return std::move(m);
+        }
+    }
+    return {};
+}
+
+struct Stage {
+    const char* name;
+    EngineMemory engine;
+    uint64_t rss;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const HarnessOptions opt = parse_args(argc, argv);
+    const auto workload = build_workload(opt);
+    if (!workload) {
+        return 1;
+    }
+
+    Engine engine;
+    if (!load_engine(engine, opt, *workload)) {
+        return 1;
+    }
+    const InferCall call = workload->call();
+    std::vector<Stage> stages;
+    stages.push_back({"load", engine_memory(opt.model), process_rss_bytes()});
+
+    set_max_tokens(engine, 1);
+    const RunResult prefill = run_request(engine, call, /*cold=*/true);
+    stages.push_back({"prefill", engine_memory(opt.model), process_rss_bytes()});
+
+    set_max_tokens(engine, opt.max_tokens);
+    const RunResult decode = run_request(engine, call, /*cold=*/false);
+    stages.push_back({"decode", engine_memory(opt.model), process_rss_bytes()});
+
+    const EngineMemory& m = stages.back().engine;
+    const uint32_t prompt_tokens = prefill.metrics.prompt_tokens;
+    const uint32_t generated = decode.metrics.output_tokens;
+    const uint64_t heap_peak = std::max(prefill.metrics.heap_peak_bytes, decode.metrics.heap_peak_bytes);
+    if (opt.json) {
+        std::printf(R"({"model":%s,"n_ctx":%d,"prompt_tokens":%u,"output_tokens":%u,"weights_bytes":%llu,)"
+                    R"("context_bytes":%llu,"kv_bytes":%llu,"compute_bytes":%llu,"request_heap_peak_bytes":%llu,"stages":{)",
+                    json_string(opt.model).c_str(), m.n_ctx, prompt_tokens, generated,
+                    static_cast<unsigned long long>(m.weights_bytes), static_cast<unsigned long long>(m.context_bytes),
+                    static_cast<unsigned long long>(m.kv_bytes), static_cast<unsigned long long>(m.compute_bytes),
+                    static_cast<unsigned long long>(heap_peak));
+        for (std::size_t i = 0; i < stages.size(); ++i) {
+            const Stage& s = stages[i];
+            std::printf(R"(%s"%s":{"mapped_bytes":%llu,"mapped_resident_bytes":%llu,"rss_bytes":%llu})",
+                        i ? "," : "", s.name, static_cast<unsigned long long>(s.engine.mapped_bytes),
+                        static_cast<unsigned long long>(s.engine.mapped_resident_bytes),
+                        static_cast<unsigned long long>(s.rss));
+        }
+        std::printf("}}\n");
+    } else {
+        std::printf("model            %s\n", opt.model.c_str());
+        std::printf("n_ctx            %d (%u prompt + %u generated tokens)\n", m.n_ctx, prompt_tokens, generated);
+        std::printf("weights          %10.1f MiB\n", mib(m.weights_bytes));
+        std::printf("context          %10.1f MiB (kv %.1f, compute %.1f)\n", mib(m.context_bytes), mib(m.kv_bytes),
+                    mib(m.compute_bytes));
+        std::printf("request heap     %10.1f MiB peak growth\n", mib(heap_peak));
+        std::printf("\n%-8s %12s %12s %12s\n", "stage", "mapped MiB", "resident MiB", "rss MiB");
+        for (const Stage& s : stages) {
+            std::printf("%-8s %12.1f %12.1f %12.1f\n", s.name, mib(s.engine.mapped_bytes),
+                        mib(s.engine.mapped_resident_bytes), mib(s.rss));
+        }
+    }
+    return 0;
+}
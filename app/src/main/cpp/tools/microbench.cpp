@@ -0,0 +1,205 @@
+// sentinel-microbench: Google Benchmark suite for the per-request text
+// path: sanitize, contains_injection, build_prompt, apply_chat_template
+// and tokenize, over inputs from 256 bytes to 32 KiB.
+//
+//   sentinel-microbench [--benchmark_filter=regex] [--benchmark_format=json]
+//
+// Fixtures:
+//   screen     dense accessibility dump in the toPromptString format
+//   unicode    Cyrillic, CJK, Arabic and emoji labels mixed with ASCII
+//   injection  adversarial text: near misses of every INJECTION_PATTERNS
+//              entry, control tokens and control bytes, matching nothing
+//
+// Tokenize needs a vocabulary: set SENTINEL_MICROBENCH_MODEL to a GGUF
+// file (only its vocab is loaded), otherwise those benchmarks are skipped.
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdlib>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+#include "llama.h"
+#include "sentinel.hpp"
+
+#include "native_arena.hpp"
+#include "native_utils.hpp"
+
+using namespace sentinel_native;
+
+namespace {
+
+constexpr int64_t MIN_BYTES = 256;
+constexpr int64_t MAX_BYTES = 32 << 10;
+
+enum Fixture : int64_t {
+    Screen,
+    Unicode,
+    Injection,
+};
+
+constexpr std::string_view SCREEN_LABELS[] = {
+    "Search settings", "Network & internet", "Connected devices", "Apps", "Notifications",
+    "Battery", "Storage", "Sound & vibration", "Display", "Dark theme", "Wallpaper & style",
+    "Accessibility", "Security & privacy", "Location", "Passwords & accounts", "System",
+    "Send message", "Type a message", "Attach file", "Back", "More options", "Navigate up",
+};
+
+constexpr std::string_view UNICODE_LABELS[] = {
+    "Настройки", "Сообщения", "设置", "发送消息", "電話", "إعدادات", "Ελληνικά", "Café ☕",
+    "Ankündigung", "📷 Camera", "🔋 Battery 87%", "👍🏽 Like", "한국어 키보드", "Bluetooth ᛒ",
+};
+
+// Each shares a prefix with an INJECTION_PATTERNS entry but never matches,
+// so the scanner does the most work per byte
+constexpr std::string_view INJECTION_PIECES[] = {
+    "ignore previou", "ignore al", "disregar", "forget everythin", "new instruction",
+    "system promp", "you are no", "act a", "pretend to b", "jailbrea", "DAN mod",
+    "developer mod", "<|im_start|>", "<|system|>", "\x01\x02\x1b[0m", "\t\t  \n",
+};
+
+template <std::size_t N>
+[[nodiscard]] std::string screen_dump(const std::string_view (&labels)[N], std::size_t bytes) {
+    std::string out = "Available UI elements (use element_id):\n";
+    for (std::size_t i = 0; out.size() < bytes; ++i) {
+        const char* flags = i % 7 == 1 ? "click|edit" : i % 11 == 5 ? "scroll" : "click";
+        out += "  " + std::to_string(i + 1) + ". [" + flags + "] " + std::string(labels[i % N]) + "\n";
+    }
+    out.resize(bytes);
+    return out;
+}
+
+[[nodiscard]] std::string injection_text(std::size_t bytes) {
+    std::string out;
+    for (std::size_t i = 0; out.size() < bytes; ++i) {
+        out += INJECTION_PIECES[i % std::size(INJECTION_PIECES)];
+        out += ' ';
+    }
+    out.resize(bytes);
+    return out;
+}
+
+// Fixture of `kind` cut to `bytes`; cutting may split a UTF-8 sequence,
+// as truncation of real input does
+[[nodiscard]] std::string make_input(int64_t kind, int64_t bytes) {
+    const auto size = static_cast<std::size_t>(bytes);
+    switch (kind) {
+    case Screen:
+        return screen_dump(SCREEN_LABELS, size);
+    case Unicode:
+        return screen_dump(UNICODE_LABELS, size);
+    default:
+        return injection_text(size);
+    }
+}
+
+void input_args(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"fixture", "bytes"})
+        ->ArgsProduct({{Screen, Unicode, Injection}, benchmark::CreateRange(MIN_BYTES, MAX_BYTES, 4)});
+}
+
+void BM_Sanitize(benchmark::State& state) {
+    const std::string input = make_input(state.range(0), state.range(1));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sentinel::sanitize(input, input.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(input.size()));
+}
+BENCHMARK(BM_Sanitize)->Apply(input_args);
+
+// The request path: sanitize_into a string in the request arena
+void BM_SanitizeInto(benchmark::State& state) {
+    const std::string input = make_input(state.range(0), state.range(1));
+    RequestArena arena;
+    for (auto _ : state) {
+        ArenaScope scope(arena);
+        std::pmr::string out(scope.resource());
+        sentinel::sanitize_into(input, out, input.size());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(input.size()));
+}
+BENCHMARK(BM_SanitizeInto)->Apply(input_args);
+
+void BM_ContainsInjection(benchmark::State& state) {
+    const std::string input = make_input(state.range(0), state.range(1));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sentinel::contains_injection(input));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(input.size()));
+}
+BENCHMARK(BM_ContainsInjection)->Apply(input_args);
+
+void BM_BuildPrompt(benchmark::State& state) {
+    const std::string screen = make_input(state.range(0), state.range(1));
+    constexpr std::string_view query = "Open the settings app and enable dark mode";
+    // Bytes written: build_prompt truncates long screens
+    const auto prompt_bytes = static_cast<int64_t>(sentinel::build_prompt(query, screen).size());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sentinel::build_prompt(query, screen));
+    }
+    state.SetBytesProcessed(state.iterations() * prompt_bytes);
+}
+BENCHMARK(BM_BuildPrompt)->Apply(input_args);
+
+// Built-in llama.cpp templates by name; the screen is the system prompt,
+// as in passthrough requests
+constexpr std::array<const char*, 3> TEMPLATES = {"chatml", "llama3", "gemma"};
+
+void BM_ApplyChatTemplate(benchmark::State& state) {
+    const std::string screen = make_input(Screen, state.range(1));
+    const std::string_view chat_template = TEMPLATES[static_cast<std::size_t>(state.range(0))];
+    constexpr std::string_view query = "Open the settings app and enable dark mode";
+    RequestArena arena;
+    for (auto _ : state) {
+        ArenaScope scope(arena);
+        benchmark::DoNotOptimize(apply_chat_template(chat_template, screen, query, scope.resource()));
+    }
+    state.SetLabel(std::string(chat_template));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(screen.size() + query.size()));
+}
+BENCHMARK(BM_ApplyChatTemplate)
+    ->ArgNames({"template", "bytes"})
+    ->ArgsProduct({{0, 1, 2}, benchmark::CreateRange(MIN_BYTES, MAX_BYTES, 4)});
+
+// Vocabulary of SENTINEL_MICROBENCH_MODEL, loaded once; null if unset
+[[nodiscard]] const llama_vocab* bench_vocab() {
+    static const llama_vocab* vocab = [] () -> const llama_vocab* {
+        const char* path = std::getenv("SENTINEL_MICROBENCH_MODEL");
+        if (!path || !*path) {
+            return nullptr;
+        }
+        llama_backend_init();
+        llama_model_params params = llama_model_default_params();
+        params.vocab_only = true;
+        // Kept for the life of the process
+        llama_model* model = llama_model_load_from_file(path, params);
+        return model ? llama_model_get_vocab(model) : nullptr;
+    }();
+    return vocab;
+}
+
+// Untrusted screen and query text: no BOS, control tokens kept as text
+void BM_Tokenize(benchmark::State& state) {
+    const llama_vocab* vocab = bench_vocab();
+    if (!vocab) {
+        state.SkipWithError("set SENTINEL_MICROBENCH_MODEL to a GGUF file");
+        return;
+    }
+    const std::string input = make_input(state.range(0), state.range(1));
+    RequestArena arena;
+    std::size_t tokens = 0;
+    for (auto _ : state) {
+        ArenaScope scope(arena);
+        tokens = tokenize(vocab, input, false, false, scope.resource()).size();
+    }
+    state.counters["tokens"] = static_cast<double>(tokens);
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(input.size()));
+}
+BENCHMARK(BM_Tokenize)->Apply(input_args);
+
+} // namespace
+
+BENCHMARK_MAIN();
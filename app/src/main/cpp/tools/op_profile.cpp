@@ -0,0 +1,108 @@
+// sentinel-op-profile: per-op and per-layer compute breakdown of a GGUF
+// model on the host CPU, using the same eval-callback profiler as the app.
+//
+//   sentinel-op-profile -m model.gguf [-q query] [-s elements | -S screen.txt] [-g grammar]
+//                       [-n gen_tokens] [-t threads] [-c n_ctx] [-b n_batch] [--json] ...
+//
+// Prefill and decode are profiled separately: their op mix differs (large
+// matmuls vs. matrix-vector products and the recurrent scan). Both go
+// through the app's request path (see harness.hpp): prefill is a cold
+// request that stops at its first token, decode the same request again
+// with the prompt already in the KV cache.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "harness.hpp"
+#include "native_profiler.hpp"
+
+using namespace sentinel_native;
+using namespace sentinel_tools;
+
+namespace {
+
+[[noreturn]] void usage(const char* argv0) {
+    std::fprintf(stderr, "usage: %s %s\n", argv0, HARNESS_USAGE);
+    std::exit(2);
+}
+
+[[nodiscard]] HarnessOptions parse_args(int argc, char** argv) {
+    HarnessOptions opt;
+    opt.max_tokens = 32;
+    for (int i = 1; i < argc; ++i) {
+        if (!parse_harness_arg(opt, argc, argv, i, usage)) {
+            usage(argv[0]);
+        }
+    }
+    if (opt.model.empty()) {
+        usage(argv[0]);
+    }
+    return opt;
+}
+
+void print_table(const char* phase, const OpProfile& profile, uint64_t wall_ns, uint32_t tokens) {
+    std::printf("\n== %s: %u tokens, %.1f ms wall, %.1f ms in ops ==\n", phase, tokens,
+                wall_ns / 1e6, profile.total_ns / 1e6);
+    std::printf("%-16s %8s %10s %7s %12s\n", "op", "count", "ms", "share", "MiB in");
+    for (const auto& [name, t] : profile.ops) {
+        std::printf("%-16.*s %8llu %10.2f %6.1f%% %12.1f\n", static_cast<int>(name.size()), name.data(),
+                    static_cast<unsigned long long>(t.count), t.ns / 1e6,
+                    profile.total_ns ? 100.0 * t.ns / profile.total_ns : 0.0, t.bytes_in / 1048576.0);
+    }
+    std::printf("%-16s %8s %10s %7s\n", "layer", "nodes", "ms", "share");
+    for (const auto& [layer, t] : profile.layers) {
+        std::printf("%-16s %8llu %10.2f %6.1f%%\n", layer < 0 ? "-" : std::to_string(layer).c_str(),
+                    static_cast<unsigned long long>(t.count), t.ns / 1e6,
+                    profile.total_ns ? 100.0 * t.ns / profile.total_ns : 0.0);
+    }
+}
+
+[[nodiscard]] uint64_t phase_ns(const RequestMetrics& metrics, MetricPhase phase) noexcept {
+    return metrics.phase_ns[static_cast<std::size_t>(phase)];
+}
+
+void report(const HarnessOptions& opt, const char* phase, uint64_t wall_ns, uint32_t tokens, bool first) {
+    const OpProfile profile = g_op_profiler.snapshot();
+    if (opt.json) {
+        std::printf(R"(%s"%s":{"tokens":%u,"wall_us":%llu,"profile":%s})", first ? "" : ",", phase, tokens,
+                    static_cast<unsigned long long>(wall_ns / 1000), op_profile_json(profile).c_str());
+    } else {
+        print_table(phase, profile, wall_ns, tokens);
+    }
+    g_op_profiler.reset();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const HarnessOptions opt = parse_args(argc, argv);
+    const auto workload = build_workload(opt);
+    if (!workload) {
+        return 1;
+    }
+
+    Engine engine;
+    if (!load_engine(engine, opt, *workload, /*profile_ops=*/true)) {
+        return 1;
+    }
+    const InferCall call = workload->call();
+
+    if (opt.json) {
+        std::printf(R"({"model":%s,"threads":%d,)", json_string(opt.model).c_str(), opt.n_threads);
+    }
+
+    set_max_tokens(engine, 1);
+    g_op_profiler.reset();
+    const RunResult prefill = run_request(engine, call, /*cold=*/true);
+    report(opt, "prefill", phase_ns(prefill.metrics, MetricPhase::Prefill),
+           prefill.metrics.prompt_tokens - prefill.metrics.reused_tokens, true);
+
+    set_max_tokens(engine, opt.max_tokens);
+    const RunResult decode = run_request(engine, call, /*cold=*/false);
+    report(opt, "decode", phase_ns(decode.metrics, MetricPhase::Decode), decode.metrics.output_tokens, false);
+    if (opt.json) {
+        std::printf("}\n");
+    }
+    return 0;
+}
@@ -0,0 +1,274 @@
+// sentinel-replay: replay a workload recorded on a device
+// (NativeBridge.startWorkloadRecording) through sentinel_core on the host,
+// with the original arrival times, inputs and sampling params.
+//
+//   sentinel-replay -m model.gguf -w workload.snwl [-g grammar] [--assets dir]
+//                   [-e embedding.gguf] [--speed x | --asap] [-t threads]
+//                   [-c n_ctx] [--json]
+//
+// Requests run one at a time, as they do on the engine's lock. A request
+// whose arrival passed while the previous one ran starts late; that delay
+// is reported as queueing, so a slower build shows up as both longer
+// service times and growing lateness. --speed scales the gaps between
+// arrivals, --asap drops them. Streamed requests queue their recorded
+// batches on the stream, then run once it has prefilled them.
+//
+// -g is the engine grammar, a .gbnf path or the name of a grammar in
+// --assets (default app/src/main/assets). Requests that named their own
+// grammar use its recorded path if it exists on the host, else the file
+// of the same name in --assets. -e loads an embedding model, which turns
+// on the semantic cache as the app does.
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "harness.hpp"
+#include "native_embedding.hpp"
+#include "native_trace.hpp"
+#include "native_workload.hpp"
+
+using namespace sentinel_native;
+using namespace sentinel_tools;
+
+namespace {
+
+struct Options {
+    HarnessOptions harness;
+    std::string workload;
+    std::string embedding;
+    double speed = 1.0;  // 0 = as fast as possible
+};
+
+[[noreturn]] void usage(const char* argv0) {
+    std::fprintf(stderr,
+        "usage: %s -m model.gguf -w workload.snwl [-g grammar] [--assets dir]\n"
+        "          [-e embedding.gguf] [--speed x | --asap] [-t threads] [-c n_ctx] [--json]\n", argv0);
+    std::exit(2);
+}
+
+[[nodiscard]] Options parse_args(int argc, char** argv) {
+    Options opt;
+    // Recorded requests bring their own screen; the router stays on, as in
+    // the app, so fast-path answers replay as they were recorded
+    opt.harness.screen_elements = 0;
+    opt.harness.router = true;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const auto value = [&]() -> const char* {
+            if (i + 1 >= argc) usage(argv[0]);
+            return argv[++i];
+        };
+        if (arg == "-m") {
+            opt.harness.model = value();
+        } else if (arg == "-w") {
+            opt.workload = value();
+        } else if (arg == "-g") {
+            opt.harness.grammar = value();
+        } else if (arg == "--assets") {
+            opt.harness.assets = value();
+        } else if (arg == "-e") {
+            opt.embedding = value();
+        } else if (arg == "--speed") {
+            opt.speed = std::atof(value());
+            if (opt.speed <= 0.0) usage(argv[0]);
+        } else if (arg == "--asap") {
+            opt.speed = 0.0;
+        } else if (arg == "-t") {
+            opt.harness.n_threads = std::atoi(value());
+        } else if (arg == "-c") {
+            opt.harness.n_ctx = std::atoi(value());
+        } else if (arg == "--json") {
+            opt.harness.json = true;
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (opt.harness.model.empty() || opt.workload.empty()) {
+        usage(argv[0]);
+    }
+    return opt;
+}
+
+// A recorded device path, else the asset of the same file name
+[[nodiscard]] std::string request_grammar_path(const Options& opt, const std::string& recorded) {
+    if (std::filesystem::exists(recorded)) {
+        return recorded;
+    }
+    return (std::filesystem::path(opt.harness.assets) / std::filesystem::path(recorded).filename()).string();
+}
+
+struct Replayed {
+    double late_ms;         // start after the scheduled arrival
+    double total_ms;        // service time on the host
+    double first_token_ms;
+    double recorded_total_ms;
+    double recorded_first_token_ms;
+    ResponseSource source;
+    ResponseSource recorded_source;
+    RequestError error;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const Options opt = parse_args(argc, argv);
+
+    auto workload = read_workload(opt.workload);
+    if (!workload) {
+        std::fprintf(stderr, "%s: %s\n", opt.workload.c_str(), workload.error().c_str());
+        return 1;
+    }
+    if (workload->records.empty()) {
+        std::fprintf(stderr, "%s: no requests recorded\n", opt.workload.c_str());
+        return 1;
+    }
+    // Only the engine grammar of the harness workload is used: the requests
+    // come from the recording
+    const HarnessOptions& h = opt.harness;
+    const auto engine_workload = build_workload(h);
+    if (!engine_workload) {
+        return 1;
+    }
+
+    Engine engine;
+    if (!load_engine(engine, h, *engine_workload)) {
+        return 1;
+    }
+    if (!opt.embedding.empty() && !init_engine(embedding_engine(), opt.embedding, "")) {
+        std::fprintf(stderr, "failed to load %s\n", opt.embedding.c_str());
+        return 1;
+    }
+
+    std::vector<Replayed> runs;
+    runs.reserve(workload->records.size());
+    std::array<uint32_t, RESPONSE_SOURCES> sources{};
+    std::array<uint32_t, RESPONSE_SOURCES> recorded_sources{};
+    uint32_t errors = 0;
+
+    const uint64_t origin_ns = monotonic_ns();
+    for (const WorkloadRecord& r : workload->records) {
+        const auto due_ns = static_cast<uint64_t>(opt.speed > 0.0 ? r.offset_us * 1000.0 / opt.speed : 0.0);
+        const uint64_t now_ns = monotonic_ns() - origin_ns;
+        if (due_ns > now_ns) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(due_ns - now_ns));
+        }
+        const uint64_t start_ns = monotonic_ns() - origin_ns;
+
+        set_params(engine, r.temperature, r.top_p, r.max_tokens);
+        if (r.kind == WorkloadKind::Snapshot) {
+            const auto* data = reinterpret_cast<const std::byte*>(r.screen.data());
+            (void) infer_snapshot(engine, r.query, {data, r.screen.size()});
+        } else if (r.kind == WorkloadKind::Streamed) {
+            // Batches go in back to back: the traversal they overlapped on
+            // the device is not replayed, only the prefill they queue
+            begin_screen(engine, r.query);
+            for (const auto batch : streamed_batches(r.screen)) {
+                (void) append_screen(engine, batch);
+            }
+            (void) end_screen(engine);
+            (void) infer_streamed(engine, r.query);
+        } else {
+            std::string request_grammar;
+            InferCall call{
+                .user_query = r.query,
+                .screen_context = r.screen,
+                .mode = r.mode,
+                .stage = r.stage,
+            };
+            if (r.grammar == WorkloadGrammar::None) {
+                call.grammar_path = std::string_view{};
+            } else if (r.grammar == WorkloadGrammar::Path) {
+                request_grammar = request_grammar_path(opt, r.grammar_path);
+                call.grammar_path = request_grammar;
+            }
+            (void) infer(engine, call);
+        }
+
+        const auto recorded = g_metrics.recent(1);
+        if (recorded.empty()) {
+            std::fprintf(stderr, "no request metrics recorded\n");
+            return 1;
+        }
+        const RequestMetrics& m = recorded.front();
+        runs.push_back({
+            .late_ms = start_ns > due_ns ? (start_ns - due_ns) / 1e6 : 0.0,
+            .total_ms = m.phase(MetricPhase::Total) / 1e3,
+            .first_token_ms = m.first_token_ns / 1e6,
+            .recorded_total_ms = r.total_us / 1e3,
+            .recorded_first_token_ms = r.first_token_us / 1e3,
+            .source = m.source,
+            .recorded_source = r.source,
+            .error = m.error,
+        });
+        ++sources[static_cast<std::size_t>(m.source)];
+        ++recorded_sources[static_cast<std::size_t>(r.source)];
+        errors += m.error != RequestError::None;
+    }
+    const double elapsed_s = (monotonic_ns() - origin_ns) / 1e9;
+
+    const Summary late = summarize(runs, [](const Replayed& r) { return r.late_ms; });
+    const Summary total = summarize(runs, [](const Replayed& r) { return r.total_ms; });
+    const Summary first_token = summarize(runs, [](const Replayed& r) { return r.first_token_ms; });
+    const Summary recorded_total = summarize(runs, [](const Replayed& r) { return r.recorded_total_ms; });
+    const Summary recorded_first_token = summarize(runs, [](const Replayed& r) { return r.recorded_first_token_ms; });
+
+    if (h.json) {
+        std::printf(R"({"model":"%s","workload":"%s","redacted":%s,"speed":%.3f,"threads":%d,"n_ctx":%d,)"
+                    R"("requests":%zu,"errors":%u,"elapsed_s":%.3f,)",
+                    h.model.c_str(), opt.workload.c_str(), workload->redacted ? "true" : "false", opt.speed,
+                    h.n_threads, h.n_ctx, runs.size(), errors, elapsed_s);
+        print_summary_json("late_ms", late, true);
+        print_summary_json("total_ms", total, false);
+        print_summary_json("first_token_ms", first_token, false);
+        print_summary_json("recorded_total_ms", recorded_total, false);
+        print_summary_json("recorded_first_token_ms", recorded_first_token, false);
+        std::printf(R"(,"sources":{)");
+        for (std::size_t i = 0; i < RESPONSE_SOURCES; ++i) {
+            const std::string_view name = response_source_name(static_cast<ResponseSource>(i));
+            std::printf(R"(%s"%.*s":{"replayed":%u,"recorded":%u})", i ? "," : "", static_cast<int>(name.size()),
+                        name.data(), sources[i], recorded_sources[i]);
+        }
+        std::printf(R"(},"samples":[)");
+        for (std::size_t i = 0; i < runs.size(); ++i) {
+            const Replayed& r = runs[i];
+            const std::string_view source = response_source_name(r.source);
+            const std::string_view error = request_error_name(r.error);
+            std::printf(R"(%s{"late_ms":%.3f,"total_ms":%.3f,"first_token_ms":%.3f,"recorded_total_ms":%.3f,)"
+                        R"("source":"%.*s","error":"%.*s"})",
+                        i ? "," : "", r.late_ms, r.total_ms, r.first_token_ms, r.recorded_total_ms,
+                        static_cast<int>(source.size()), source.data(), static_cast<int>(error.size()), error.data());
+        }
+        std::printf("]}\n");
+    } else {
+        std::printf("model                  %s\n", h.model.c_str());
+        std::printf("workload               %s (%zu requests%s)\n", opt.workload.c_str(), runs.size(),
+                    workload->redacted ? ", redacted" : "");
+        if (opt.speed > 0.0) {
+            std::printf("pacing                 %.2fx recorded arrivals, %.1f s\n", opt.speed, elapsed_s);
+        } else {
+            std::printf("pacing                 back to back, %.1f s\n", elapsed_s);
+        }
+        std::printf("errors                 %u\n", errors);
+        std::printf("\n%-22s %10s %10s %10s %10s\n", "", "p50", "p95", "p99", "mean");
+        print_summary_row("late ms", late, 22);
+        print_summary_row("total ms", total, 22);
+        print_summary_row("first token ms", first_token, 22);
+        print_summary_row("recorded total ms", recorded_total, 22);
+        print_summary_row("recorded first tok ms", recorded_first_token, 22);
+        std::printf("\n%-22s %10s %10s\n", "source", "replayed", "recorded");
+        for (std::size_t i = 0; i < RESPONSE_SOURCES; ++i) {
+            const std::string_view name = response_source_name(static_cast<ResponseSource>(i));
+            std::printf("%-22.*s %10u %10u\n", static_cast<int>(name.size()), name.data(), sources[i],
+                        recorded_sources[i]);
+        }
+    }
+    return 0;
+}
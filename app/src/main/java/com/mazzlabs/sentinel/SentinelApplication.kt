@@ -49,6 +49,10 @@ class SentinelApplication : Application() {
                 val result = nativeBridge.initModel(modelPath, grammarPath)
                 isModelLoaded = result
                 Log.i(TAG, "Model initialization: ${if (result) "SUCCESS" else "FAILED"}")
+                // The semantic cache embeds with the same weights, plus a small context
+                if (result && !nativeBridge.loadEmbeddingModel(modelPath)) {
+                    Log.w(TAG, "Embedding model failed to load; semantic cache inactive")
+                }
                 onComplete(result)
             } catch (e: Exception) {
                 Log.e(TAG, "Model initialization error", e)
@@ -71,6 +75,20 @@ class SentinelApplication : Application() {
         }
     }
 
+    /**
+     * Let native memory follow system pressure instead of being killed
+     * with the model fully resident
+     */
+    override fun onTrimMemory(level: Int) {
+        super.onTrimMemory(level)
+        if (!isModelLoaded) return
+        try {
+            Log.i(TAG, "Memory pressure $level: ${nativeBridge.onMemoryPressure(level)}")
+        } catch (e: Exception) {
+            Log.e(TAG, "Error handling memory pressure", e)
+        }
+    }
+
     override fun onTerminate() {
         releaseModel()
         super.onTerminate()
@@ -4,6 +4,7 @@ import android.content.Context
 import android.util.Log
 import com.mazzlabs.sentinel.SentinelApplication
 import com.mazzlabs.sentinel.core.JsonExtractor
+import com.mazzlabs.sentinel.model.ActionType
 import com.mazzlabs.sentinel.model.AgentAction
 import com.mazzlabs.sentinel.tools.framework.ToolExecutor
 import com.mazzlabs.sentinel.tools.framework.ToolResponse
@@ -11,13 +12,15 @@ import com.mazzlabs.sentinel.tools.framework.Tools
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.withContext
 import org.json.JSONObject
+import java.nio.ByteBuffer
 
 /**
  * AgentController - Main orchestration layer
  * 
  * Routes user requests to either:
- * 1. Tool execution (calendar, clock, contacts, etc.)
- * 2. UI actions (tap, scroll, type via accessibility)
+ * 1. UI actions (tap, scroll, type via accessibility), chosen natively from
+ *    a packed screen snapshot
+ * 2. Tool execution (calendar, clock, contacts, etc.)
  * 
  * This is the brain that decides what to do with user input.
  */
@@ -25,6 +28,12 @@ class AgentController(private val context: Context) {
     
     companion object {
         private const val TAG = "AgentController"
+
+        // Actions that settle a request without consulting the tools
+        private val SCREEN_ACTIONS = setOf(
+            ActionType.CLICK, ActionType.SCROLL, ActionType.TYPE,
+            ActionType.HOME, ActionType.BACK, ActionType.WAIT
+        )
     }
     
     private val toolExecutor = Tools.getInstance(context)
@@ -40,24 +49,42 @@ class AgentController(private val context: Context) {
         data class Error(val message: String) : AgentResult()
     }
     
+    /**
+     * Packed screen for one request, in ElementRegistry.writeSnapshot format.
+     * [streamed] means the same elements were also handed to
+     * NativeBridge.appendElements during the traversal, so prefill has
+     * already started. [buffer] must not be reused while a request reads it.
+     */
+    data class ScreenSnapshot(
+        val buffer: ByteBuffer,
+        val length: Int,
+        val streamed: Boolean = false
+    )
+
     /**
      * Process a user query
      * 
      * @param query User's natural language request
-     * @param screenContext Current UI state (from accessibility service)
+     * @param screen Current UI state (from accessibility service), if any
      * @return AgentResult indicating what action was taken
      */
-    suspend fun process(query: String, screenContext: String = ""): AgentResult {
+    suspend fun process(query: String, screen: ScreenSnapshot? = null): AgentResult {
         return withContext(Dispatchers.IO) {
             try {
                 Log.d(TAG, "Processing query: $query")
+
+                // The screen gets the first say; NONE hands over to the tools
+                if (screen != null) {
+                    actOnScreen(query, screen)?.let { return@withContext AgentResult.UIAction(it) }
+                }
                 
                 // Build system prompt with tools
                 val systemPrompt = SystemPromptBuilder.build(context, includeTools = true)
+                val userPrompt = "User request: $query"
                 
                 // Run inference with grammar first
                 var response = nativeBridge.infer(
-                    userQuery = buildUserPrompt(query, screenContext),
+                    userQuery = userPrompt,
                     screenContext = systemPrompt
                 )
 
@@ -65,7 +92,7 @@ class AgentController(private val context: Context) {
                 if (shouldRetryWithoutGrammar(response)) {
                     Log.w(TAG, "Grammar inference failed, retrying without grammar constraint")
                     response = nativeBridge.inferWithoutGrammar(
-                        userQuery = buildUserPrompt(query, screenContext),
+                        userQuery = userPrompt,
                         screenContext = systemPrompt
                     )
                     Log.d(TAG, "Fallback inference result: $response")
@@ -82,20 +109,27 @@ class AgentController(private val context: Context) {
             }
         }
     }
-    
+
     /**
-     * Build user prompt with optional screen context
+     * Pick a UI action for [query] on [screen]. Native code ranks and
+     * encodes the elements itself and may answer from its router or caches
+     * without running the model.
+     *
+     * @return The action, or null if the model found nothing to do on screen
      */
-    private fun buildUserPrompt(query: String, screenContext: String): String {
-        return if (screenContext.isNotBlank()) {
-            buildString {
-                appendLine("User request: $query")
-                appendLine()
-                appendLine("Current screen elements:")
-                appendLine(screenContext.take(8000)) // Truncate for context window
+    suspend fun actOnScreen(query: String, screen: ScreenSnapshot): AgentAction? {
+        return withContext(Dispatchers.IO) {
+            val response = if (screen.streamed && nativeBridge.endScreen() >= 0) {
+                nativeBridge.inferStreamed(query)
+            } else {
+                nativeBridge.inferWithSnapshot(query, screen.buffer, screen.length)
             }
-        } else {
-            "User request: $query"
+            Log.d(TAG, "Screen response: $response")
+
+            // The native prompt names elements by id in "target"
+            AgentAction.fromJsonOrNull(response)
+                ?.takeIf { it.action in SCREEN_ACTIONS }
+                ?.let { it.copy(elementId = it.elementId ?: it.target?.toIntOrNull()) }
         }
     }
     
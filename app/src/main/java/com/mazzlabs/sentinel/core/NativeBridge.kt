@@ -1,6 +1,7 @@
 package com.mazzlabs.sentinel.core
 
 import android.util.Log
+import java.nio.ByteBuffer
 
 /**
  * NativeBridge - JNI Wrapper for llama.cpp Inference Engine
@@ -12,6 +13,11 @@ class NativeBridge {
 
     companion object {
         private const val TAG = "NativeBridge"
+
+        // Screen encodings for setScreenEncoding
+        const val SCREEN_ENCODING_VERBOSE = 0
+        const val SCREEN_ENCODING_COMPACT = 1
+        const val SCREEN_ENCODING_DENSE = 2
         
         init {
             try {
@@ -43,6 +49,90 @@ class NativeBridge {
      */
     external fun infer(userQuery: String, screenContext: String): String
 
+    /**
+     * Same as [infer], but writes the raw UTF-8 result into [out] instead of
+     * building a String, so no re-encoding or intermediate copy happens.
+     * If [out] is too small the result is kept natively: fetch it with
+     * [copyLastResult] into a buffer of the reported size.
+     *
+     * @param out Direct ByteBuffer receiving the result starting at offset 0
+     * @return Bytes written, or -(bytes required) if [out] is too small
+     */
+    external fun inferToBuffer(userQuery: String, screenContext: String, out: ByteBuffer): Int
+
+    /**
+     * Copy the result an [inferToBuffer] call could not fit, without
+     * running inference again. Released once copied.
+     *
+     * @param out Direct ByteBuffer receiving the result starting at offset 0
+     * @return Bytes written, -(bytes required) if [out] is still too small,
+     *   or 0 if no result is pending
+     */
+    external fun copyLastResult(out: ByteBuffer): Int
+
+    /**
+     * Same as [infer], but the screen is a packed snapshot written by
+     * ElementRegistry.writeSnapshot. The native side renders and tokenizes
+     * it directly, skipping the Kotlin prompt string and its JNI copy.
+     *
+     * @param snapshot Direct ByteBuffer holding the snapshot at offset 0
+     * @param length Snapshot size in bytes (writeSnapshot's return value)
+     */
+    external fun inferWithSnapshot(userQuery: String, snapshot: ByteBuffer, length: Int): String
+
+    /**
+     * Start streaming a screen into the native engine. Typical use:
+     *
+     *     beginScreen(query)
+     *     registry.rebuild(root, BatchSink { batch, length -> appendElements(batch, length) })
+     *     if (endScreen() >= 0) result = inferStreamed(query)
+     *
+     * Batches are tokenized and prefilled on a native worker while the
+     * traversal continues, so only the query is left to decode at the end.
+     * Only queues work for that worker, so it is safe on the main thread
+     * while another request is generating. If no model can be made
+     * resident or the template cannot be streamed, [endScreen] fails.
+     *
+     * @param query Elements are pruned against it batch by batch, like
+     *     [inferWithSnapshot] ranks them; "" keeps the first 60 unranked
+     */
+    external fun beginScreen(query: String)
+
+    /**
+     * Queue a packed snapshot batch (ElementRegistry format). The bytes are
+     * copied, so [batch] may be reused as soon as this returns.
+     */
+    external fun appendElements(batch: ByteBuffer, length: Int): Boolean
+
+    /**
+     * Wait until every queued batch has been prefilled
+     * @return Prompt tokens covered by the screen, or -1 on failure
+     */
+    external fun endScreen(): Int
+
+    /**
+     * Run grammar-constrained inference against the streamed screen
+     */
+    external fun inferStreamed(userQuery: String): String
+
+    /**
+     * Load the elements [resolveTarget] matches against (ElementRegistry
+     * snapshot format). Independent of the model; safe during inference.
+     *
+     * @return Number of elements loaded, or -1 if the snapshot is invalid
+     */
+    external fun loadTargetElements(snapshot: ByteBuffer, length: Int): Int
+
+    /**
+     * Match a target string from a model action to loaded element ids:
+     * literal id, exact, normalized, substring, then bounded edit distance.
+     *
+     * @param outIds Receives element ids, best match first
+     * @param outScores Receives match scores (0.5-1.0), parallel to [outIds]
+     * @return Number of matches written
+     */
+    external fun resolveTarget(target: String, outIds: IntArray, outScores: FloatArray): Int
+
     /**
      * Run inference with a specific grammar file path for this call.
      */
@@ -59,18 +149,21 @@ class NativeBridge {
     external fun inferWithoutGrammar(userQuery: String, screenContext: String): String
 
     /**
-     * Release model resources and free memory
+     * Release the model. It is kept resident while the [setMemoryBudget]
+     * budget allows, so re-initializing with the same path is instant;
+     * otherwise its memory is freed immediately.
      */
     external fun releaseModel()
 
     /**
      * Get current model status
-     * @return true if model is loaded and ready
+     * @return true if a model is loaded; it may be evicted and reload on the next call
      */
     external fun isModelReady(): Boolean
 
     /**
-     * Get model metadata (name, context size, etc.)
+     * Get model metadata: vocab and context sizes, weights_bytes,
+     * kv_bytes and context_bytes (KV cache plus compute buffers)
      * @return JSON string with model information
      */
     external fun getModelInfo(): String
@@ -82,4 +175,263 @@ class NativeBridge {
      * @param maxTokens Maximum tokens to generate
      */
     external fun setInferenceParams(temperature: Float, topP: Float, maxTokens: Int)
+
+    /**
+     * Select how snapshot screens are encoded into the prompt
+     * @param level SCREEN_ENCODING_VERBOSE, _COMPACT or _DENSE
+     * @param grid Quantize element positions to a grid x grid raster (0 = omit)
+     * @param screenWidth Display width in pixels, for position quantization
+     * @param screenHeight Display height in pixels
+     */
+    external fun setScreenEncoding(level: Int, grid: Int, screenWidth: Int, screenHeight: Int)
+
+    /**
+     * Start a repeatable task. The snapshot and streamed calls that follow
+     * with the same query are its steps. Each step's action is recorded with
+     * a hash of the screen structure it was chosen on. Optional: a call with
+     * a new query starts a task implicitly.
+     */
+    external fun beginMacroTask(query: String)
+
+    /**
+     * End the current task. On success its steps are stored, and the next
+     * run of the same query replays them without the LLM while each screen
+     * keeps its recorded structure. A failed replay invalidates the macro.
+     */
+    external fun endMacroTask(success: Boolean)
+
+    /**
+     * @param enabled false disables replay and recording
+     * @param clear Drop all stored macros
+     */
+    external fun setMacroCache(enabled: Boolean, clear: Boolean)
+
+    /**
+     * Macro counters: lookups, hits, drifts, failures, recorded, size
+     * @return JSON object
+     */
+    external fun getMacroStats(): String
+
+    /**
+     * Load the model the semantic cache embeds queries with. The main
+     * model's path works and shares its weights.
+     * @return true if loaded; the cache stays inactive until then
+     */
+    external fun loadEmbeddingModel(modelPath: String): Boolean
+
+    /**
+     * @param enabled false disables lookups and recording
+     * @param threshold Cosine similarity a cached query needs for a hit
+     * @param capacity Entries kept; changing it clears the cache
+     */
+    external fun setSemanticCache(enabled: Boolean, threshold: Float, capacity: Int)
+
+    /**
+     * The action from the last semantic cache hit was wrong: drop the entry
+     */
+    external fun reportCacheFalsePositive()
+
+    /**
+     * Semantic cache counters: lookups, hits, misses, inserts, evictions,
+     * false_positives, size, threshold
+     * @return JSON object
+     */
+    external fun getSemanticCacheStats(): String
+
+    /**
+     * Latency breakdown: p50/p95/p99 per phase (sanitize, template,
+     * tokenize, prefill, decode, sample, grammar, total), time to first
+     * token, prefill/decode tokens per second, response sources, and the
+     * newest requests with their timings and token counts.
+     * @param lastN Individual requests to include (at most 64)
+     * @return JSON object
+     */
+    external fun getMetrics(lastN: Int): String
+
+    /**
+     * Clear all histograms, counters and recorded requests
+     */
+    external fun resetMetrics()
+
+    /**
+     * Start or stop recording native trace spans (JNI calls, request
+     * phases, prefill chunks, decode steps). Near zero cost while off.
+     * @param clear Drop spans recorded so far
+     */
+    external fun setTracing(enabled: Boolean, clear: Boolean)
+
+    /**
+     * Write recorded spans as Chrome trace-event JSON, for Perfetto UI or
+     * chrome://tracing. Timestamps are CLOCK_MONOTONIC like app traces.
+     * @return true if the file was written
+     */
+    external fun dumpTrace(path: String): Boolean
+
+    /**
+     * Record [infer], [inferWithSnapshot] and [inferStreamed] requests
+     * (inputs, sampling params, arrival times and outcome) to a local file,
+     * for replaying real traffic with the host tool sentinel-replay. A
+     * streamed request is recorded with the batches its screen received,
+     * if the recording was already running at [beginScreen]. Off by default.
+     *
+     * @param redact Replace query and screen text with content-free
+     *   stand-ins of the same length and shape before writing
+     * @return true if the file was opened
+     */
+    external fun startWorkloadRecording(path: String, redact: Boolean): Boolean
+
+    /**
+     * @return Requests recorded since [startWorkloadRecording]
+     */
+    external fun stopWorkloadRecording(): Int
+
+    /**
+     * Last requests from the always-on flight recorder, for attaching to
+     * user reports: timestamps, phase timings, token counts, cache outcome,
+     * error code and grammar id. Contains no query, screen or output text.
+     * @return JSON object
+     */
+    external fun dumpFlightRecorder(): String
+
+    /**
+     * Profile every ggml op of the default engine. Slows inference down
+     * noticeably; toggling recreates the context (KV cache is lost).
+     * @param reset Clear the accumulated profile
+     */
+    external fun setOpProfiling(enabled: Boolean, reset: Boolean)
+
+    /**
+     * Accumulated time, node count and bytes per ggml op type and per layer
+     * @return JSON object
+     */
+    external fun getOpProfile(): String
+
+    /**
+     * Load the fast-path router model. Agent-mode calls ([infer],
+     * [inferWithSnapshot], [inferStreamed], ...) first try the router. Trivial
+     * commands ("go back", "scroll down a bit") are answered with a SCROLL,
+     * BACK, HOME or WAIT action without running the LLM. Built-in exact
+     * phrases route even without a model.
+     *
+     * @param path Text model file (format in native_router.hpp)
+     */
+    external fun loadRouterModel(path: String): Boolean
+
+    /**
+     * @param enabled false sends every query to the LLM
+     * @param threshold Minimum model probability to answer without the LLM (default 0.9)
+     */
+    external fun setRouterParams(enabled: Boolean, threshold: Float)
+
+    /**
+     * Router counters: queries, exact_hits, model_hits, hit_rate,
+     * model_loaded, by_intent
+     * @return JSON object
+     */
+    external fun getRouterStats(): String
+
+    /**
+     * Register a LoRA adapter for the model loaded by [initModel]. Adapters
+     * share the base weights, so each costs only its own file.
+     * Registrations are dropped when a different model is loaded.
+     *
+     * @param name Name used by [defineStage]
+     * @param path Absolute path to the adapter .gguf
+     */
+    external fun loadAdapter(name: String, path: String): Boolean
+
+    /**
+     * Define a pipeline stage ("intent", "plan", "risk", ...) as a set of
+     * adapters applied together. An empty set runs the stage on the base model.
+     *
+     * @param scales Scale per adapter, parallel to [adapterNames]
+     * @return false if an adapter name is not registered
+     */
+    external fun defineStage(stage: String, adapterNames: Array<String>, scales: FloatArray): Boolean
+
+    /**
+     * Stage used by calls that don't name one ([infer], [inferWithSnapshot],
+     * [inferStreamed], ...). "" selects the base model.
+     */
+    external fun setDefaultStage(stage: String): Boolean
+
+    /**
+     * Same as [inferWithGrammar], with the adapters of [stage] for this call.
+     * Switching stages drops the KV cache; repeated calls of one stage keep
+     * their shared prefix.
+     */
+    external fun inferStage(stage: String, userQuery: String, screenContext: String, grammarPath: String): String
+
+    /**
+     * Byte budget for all resident models (weights + KV cache), shared by
+     * every engine. When a load would exceed it, the least recently used
+     * engines are evicted and reloaded on their next request.
+     * Defaults to half of physical memory; 0 means unlimited.
+     */
+    external fun setMemoryBudget(bytes: Long)
+
+    /**
+     * Residency counters: budget_bytes, resident_bytes, engines,
+     * resident_engines, evictions, reloads
+     * @return JSON object
+     */
+    external fun getResidencyStats(): String
+
+    /**
+     * Native memory breakdown: process RSS and heap; per engine the
+     * weights (mapped vs resident pages), KV cache, compute buffers and
+     * engine caches; process-wide cache sizes; and percentiles of peak
+     * heap growth per request. Reads /proc/self/smaps, so call it for
+     * diagnostics rather than on every frame.
+     * @return JSON object
+     */
+    external fun getMemoryStats(): String
+
+    /**
+     * Shed native memory for a ComponentCallbacks2.onTrimMemory level.
+     * Graduated: caches first, then a smaller context, then the context
+     * itself, and at TRIM_MEMORY_COMPLETE the resident weight pages. The
+     * model stays loaded throughout, so the next request reloads quickly.
+     * Contexts are only freed here and rebuilt by the next request. The full
+     * context size comes back with the first request after a minute without
+     * pressure, or right away when 0 is passed. Never waits for a request in
+     * flight and allocates nothing; safe on the main thread.
+     * @return JSON with the step taken and heap/RSS before and after
+     */
+    external fun onMemoryPressure(level: Int): String
+
+    /**
+     * Create an engine independent of the one behind [initModel]. Engines
+     * that load the same file share its weights, so a second engine costs
+     * only its context and KV cache. Prefer [NativeEngine] over raw handles.
+     *
+     * @return Opaque engine handle, or 0 if loading failed
+     */
+    external fun createEngine(modelPath: String, grammarPath: String): Long
+
+    /**
+     * Release an engine created by [createEngine]. Calls already running on
+     * it finish first; the handle is invalid afterwards.
+     */
+    external fun destroyEngine(handle: Long)
+
+    /**
+     * [infer] on a specific engine
+     */
+    external fun inferEngine(handle: Long, userQuery: String, screenContext: String): String
+
+    /**
+     * [inferWithGrammar] on a specific engine; an empty [grammarPath] runs unconstrained
+     */
+    external fun inferEngineWithGrammar(
+        handle: Long,
+        userQuery: String,
+        screenContext: String,
+        grammarPath: String
+    ): String
+
+    /**
+     * [setInferenceParams] for a specific engine
+     */
+    external fun setEngineParams(handle: Long, temperature: Float, topP: Float, maxTokens: Int)
 }
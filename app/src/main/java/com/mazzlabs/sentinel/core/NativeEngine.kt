@@ -0,0 +1,51 @@
+package com.mazzlabs.sentinel.core
+
+/**
+ * NativeEngine - Owned handle to an independent native inference engine
+ *
+ * Each engine has its own context, sampler and KV cache and locks only
+ * itself, so several can run concurrently (e.g. a small router model next to
+ * the main model). Weights are shared between engines loading the same file.
+ */
+class NativeEngine private constructor(
+    private val bridge: NativeBridge,
+    private var handle: Long
+) : AutoCloseable {
+
+    companion object {
+        /**
+         * Load [modelPath] into a new engine
+         * @return null if the model or context could not be created
+         */
+        fun create(bridge: NativeBridge, modelPath: String, grammarPath: String = ""): NativeEngine? {
+            val handle = bridge.createEngine(modelPath, grammarPath)
+            return if (handle != 0L) NativeEngine(bridge, handle) else null
+        }
+    }
+
+    val isOpen: Boolean
+        @Synchronized get() = handle != 0L
+
+    fun infer(userQuery: String, screenContext: String): String =
+        bridge.inferEngine(checkOpen(), userQuery, screenContext)
+
+    fun inferWithGrammar(userQuery: String, screenContext: String, grammarPath: String): String =
+        bridge.inferEngineWithGrammar(checkOpen(), userQuery, screenContext, grammarPath)
+
+    fun setParams(temperature: Float, topP: Float, maxTokens: Int) =
+        bridge.setEngineParams(checkOpen(), temperature, topP, maxTokens)
+
+    @Synchronized
+    override fun close() {
+        if (handle != 0L) {
+            bridge.destroyEngine(handle)
+            handle = 0L
+        }
+    }
+
+    @Synchronized
+    private fun checkOpen(): Long {
+        check(handle != 0L) { "NativeEngine is closed" }
+        return handle
+    }
+}
@@ -1,5 +1,6 @@
 package com.mazzlabs.sentinel.graph
 
+import com.mazzlabs.sentinel.core.AgentController
 import com.mazzlabs.sentinel.model.AgentAction
 import com.mazzlabs.sentinel.model.UIElement
 import com.mazzlabs.sentinel.tools.ToolResult
@@ -16,6 +17,8 @@ data class AgentState(
     // Input
     val userQuery: String = "",
     val screenContext: String = "",
+    // Packed screen for UIActionNode; holds a direct buffer, never persisted
+    @Transient val screen: AgentController.ScreenSnapshot? = null,
     val conversationHistory: List<Message> = emptyList(),
     val plan: Plan? = null,
     val planStep: Int = 0,
@@ -2,13 +2,21 @@ package com.mazzlabs.sentinel.graph
 
 import android.content.Context
 import android.util.Log
+import com.mazzlabs.sentinel.core.AgentController
 import com.mazzlabs.sentinel.graph.nodes.*
+import com.mazzlabs.sentinel.model.AgentAction
 import com.mazzlabs.sentinel.tools.*
 
 /**
  * EnhancedAgentOrchestrator - stateful, session-based agent execution.
+ *
+ * [screenActor] picks UI actions from the packed screen passed to [process]
+ * (AgentController.actOnScreen); without it UI intents act on entities only.
  */
-class EnhancedAgentOrchestrator(private val context: Context) {
+class EnhancedAgentOrchestrator(
+    private val context: Context,
+    private val screenActor: (suspend (String, AgentController.ScreenSnapshot) -> AgentAction?)? = null
+) {
 
     companion object {
         private const val TAG = "EnhancedAgentOrchestrator"
@@ -78,7 +86,7 @@ class EnhancedAgentOrchestrator(private val context: Context) {
             .addNode("tool_selector", ToolSelectorNode(toolRegistry))
             .addNode("param_extractor", ParameterExtractorNode(toolRegistry))
             .addNode("tool_executor", ToolExecutorNode(toolRegistry, context))
-            .addNode("ui_action", UIActionNode())
+            .addNode("ui_action", UIActionNode(screenActor))
 
             // Response generation
             .addNode("response_generator", EnhancedResponseGeneratorNode())
@@ -143,7 +151,8 @@ class EnhancedAgentOrchestrator(private val context: Context) {
     suspend fun process(
         userQuery: String,
         sessionId: String = "default",
-        screenContext: String = ""
+        screenContext: String = "",
+        screen: AgentController.ScreenSnapshot? = null
     ): AgentState {
         val currentSession = sessionManager.getOrCreateSession(sessionId)
 
@@ -156,6 +165,7 @@ class EnhancedAgentOrchestrator(private val context: Context) {
             userQuery = userQuery,
             conversationHistory = updatedHistory,
             screenContext = screenContext,
+            screen = screen,
             isComplete = false,
             error = null,
             iteration = 0
@@ -164,6 +174,7 @@ class EnhancedAgentOrchestrator(private val context: Context) {
         val finalState = graph.invoke(initialState)
 
         val completeState = finalState.copy(
+            screen = null,
             conversationHistory = finalState.conversationHistory + Message(
                 role = Role.ASSISTANT,
                 content = finalState.response
@@ -5,6 +5,7 @@ import android.util.Log
 import com.google.gson.Gson
 import com.google.gson.reflect.TypeToken
 import com.mazzlabs.sentinel.SentinelApplication
+import com.mazzlabs.sentinel.core.AgentController
 import com.mazzlabs.sentinel.core.GrammarManager
 import com.mazzlabs.sentinel.graph.*
 import com.mazzlabs.sentinel.model.ActionType
@@ -324,15 +325,39 @@ class ResponseGeneratorNode : AgentNode {
 
 /**
  * UIActionNode - Generates UI actions when no tool is applicable
+ *
+ * Intents that target an element ask [screenActor] (AgentController.actOnScreen)
+ * to pick one on the packed screen first; the entities are the fallback.
  */
-class UIActionNode : AgentNode {
+class UIActionNode(
+    private val screenActor: (suspend (String, AgentController.ScreenSnapshot) -> AgentAction?)? = null
+) : AgentNode {
     
     companion object {
         private const val TAG = "UIActionNode"
+
+        private val SCREEN_INTENTS = setOf(
+            AgentIntent.CLICK_ELEMENT,
+            AgentIntent.SCROLL_SCREEN,
+            AgentIntent.TYPE_TEXT
+        )
     }
     
     override suspend fun process(state: AgentState): AgentState {
         val intent = state.intent ?: AgentIntent.UNKNOWN
+
+        val screen = state.screen
+        if (screenActor != null && screen != null && intent in SCREEN_INTENTS) {
+            val screenAction = screenActor.invoke(state.userQuery, screen)
+            Log.d(TAG, "Screen action for $intent: $screenAction")
+            if (screenAction != null) {
+                return state.copy(
+                    action = screenAction,
+                    isComplete = true,
+                    currentNode = "ui_action"
+                )
+            }
+        }
         
         val action = when (intent) {
             AgentIntent.GO_BACK -> AgentAction(ActionType.BACK, reasoning = "User requested to go back")
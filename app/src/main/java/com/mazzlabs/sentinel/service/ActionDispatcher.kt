@@ -21,7 +21,23 @@ import com.mazzlabs.sentinel.service.ElementRegistry
  * Security: Only executes actions that have passed firewall validation.
  * All actions are atomic and reversible where possible.
  */
-class ActionDispatcher(private val registry: ElementRegistry) {
+class ActionDispatcher(
+    private val registry: ElementRegistry,
+    private val targetResolver: TargetResolver? = null
+) {
+
+    /**
+     * Maps a free-text target from the model to a registry element id,
+     * e.g. [NativeTargetResolver]. Returns null when nothing matches.
+     */
+    fun interface TargetResolver {
+        fun resolve(target: String): Match?
+    }
+
+    /**
+     * Best element for a target; [score] runs from 0 (unrelated) to 1 (exact)
+     */
+    data class Match(val id: Int, val score: Float)
 
     companion object {
         private const val TAG = "ActionDispatcher"
@@ -31,6 +47,10 @@ class ActionDispatcher(private val registry: ElementRegistry) {
 
         // Maximum recursion depth to prevent stack overflow on deep UI hierarchies
         private const val MAX_TRAVERSAL_DEPTH = 50
+
+        // Weakest resolver match acted on: a substring or a near-miss typo.
+        // Bare trigram overlap scores lower and would click the wrong element.
+        private const val MIN_RESOLVE_SCORE = 0.7f
     }
 
     private val tempRect = Rect()
@@ -79,6 +99,7 @@ class ActionDispatcher(private val registry: ElementRegistry) {
     ): Boolean {
         val targetNode = action.elementId?.let { registry.getNode(it) }
             ?: action.target?.let { findNodeByTarget(root, it) }
+            ?: action.target?.let { resolveTarget(it) }
             ?: run {
                 Log.w(TAG, "CLICK action missing target/element_id")
                 return false
@@ -152,6 +173,7 @@ class ActionDispatcher(private val registry: ElementRegistry) {
         // Find by element_id, target, or focused editable field
         val targetNode = action.elementId?.let { registry.getNode(it) }
             ?: action.target?.let { findNodeByTarget(root, it) }
+            ?: action.target?.let { resolveTarget(it) }
             ?: findFocusedEditableNode(root)
 
         if (targetNode == null) {
@@ -192,6 +214,20 @@ class ActionDispatcher(private val registry: ElementRegistry) {
         return true
     }
 
+    /**
+     * Resolve the target against registered elements through [targetResolver].
+     * Only used once the tree search has found nothing.
+     */
+    private fun resolveTarget(target: String): AccessibilityNodeInfo? {
+        val match = targetResolver?.resolve(target) ?: return null
+        if (match.score < MIN_RESOLVE_SCORE) {
+            Log.d(TAG, "Rejected target '$target' -> element ${match.id} (score ${match.score})")
+            return null
+        }
+        Log.d(TAG, "Resolved target '$target' to element ${match.id} (score ${match.score})")
+        return registry.getNode(match.id)
+    }
+
     /**
      * Find a node matching the target description
      */
@@ -31,6 +31,7 @@ import kotlinx.coroutines.*
 import kotlinx.coroutines.flow.collectLatest
 import kotlinx.coroutines.suspendCancellableCoroutine
 import kotlin.coroutines.resume
+import java.nio.ByteBuffer
 import java.util.concurrent.atomic.AtomicLong
 import java.util.concurrent.atomic.AtomicReference
 
@@ -51,6 +52,9 @@ class AgentAccessibilityService : AccessibilityService(),
 
         private const val OCR_CONFIDENCE_THRESHOLD = 0.6f
 
+        // Fits a typical screen's packed snapshot; larger ones are resized
+        private const val SNAPSHOT_BUFFER_BYTES = 16 * 1024
+
         const val ACTION_SERVICE_CONNECTED = "com.mazzlabs.sentinel.SERVICE_CONNECTED"
         const val ACTION_CONFIRMATION_REQUIRED = "com.mazzlabs.sentinel.CONFIRMATION_REQUIRED"
         const val ACTION_EXECUTED = "com.mazzlabs.sentinel.ACTION_EXECUTED"
@@ -74,7 +78,12 @@ class AgentAccessibilityService : AccessibilityService(),
     private val actionFirewall = ActionFirewall()
     private val riskClassifier = ActionRiskClassifier()
     private val elementRegistry = ElementRegistry()
-    private val actionDispatcher = ActionDispatcher(elementRegistry)
+    private val actionDispatcher by lazy {
+        ActionDispatcher(
+            elementRegistry,
+            NativeTargetResolver(SentinelApplication.getInstance().nativeBridge, elementRegistry)
+        )
+    }
     private lateinit var enhancedOrchestrator: EnhancedAgentOrchestrator
     
     // Agent controller for tools + UI actions
@@ -102,7 +111,6 @@ class AgentAccessibilityService : AccessibilityService(),
      * and prevent race conditions when checking if the UI has changed.
      */
     private data class CachedScreenState(
-        val elementList: String = "",
         val packageName: String = "",
         val timestampMs: Long = 0L
     )
@@ -117,7 +125,7 @@ class AgentAccessibilityService : AccessibilityService(),
         
         // Initialize agent controller (tools + inference)
         agentController = AgentController(this)
-        enhancedOrchestrator = EnhancedAgentOrchestrator(this)
+        enhancedOrchestrator = EnhancedAgentOrchestrator(this, agentController::actOnScreen)
         
         // Initialize overlay and voice input
         overlayManager = OverlayManager(this)
@@ -224,31 +232,31 @@ class AgentAccessibilityService : AccessibilityService(),
 
         val requestId = requestCounter.incrementAndGet()
         currentAgentJob?.cancel()
+        // One macro task per request: its snapshot steps are recorded, or
+        // replayed if the same query succeeded before
+        SentinelApplication.getInstance().nativeBridge.beginMacroTask(userQuery)
         currentAgentJob = serviceScope.launch {
             try {
                 val startContentChangeCounter = uiContentChangeCounter.get()
                 // Atomically capture the screen state at the start
                 val startScreenState = cachedScreenState.get()
 
-                val screenContext = withContext(Dispatchers.Main) {
+                val (screen, screenContext) = withContext(Dispatchers.Main) {
                     rootInActiveWindow?.let { root ->
-                        elementRegistry.rebuild(root)
-                        elementRegistry.toPromptString()
-                    } ?: "[No screen content]"
-                }
-
-                // Atomically update the element list while preserving other cached state
-                cachedScreenState.updateAndGet { current ->
-                    current.copy(elementList = screenContext)
+                        captureScreen(root, userQuery) to elementRegistry.toPromptString()
+                    } ?: (null to "[No screen content]")
                 }
 
                 Log.d(TAG, "Processing query: $userQuery")
-                Log.d(TAG, "Screen context length: ${screenContext.length}")
+                Log.d(TAG, "Screen snapshot: ${screen?.length ?: 0} bytes, streamed=${screen?.streamed}")
 
+                // The graph's UI node picks actions from the packed snapshot;
+                // its other nodes read the rendered screen
                 val finalState = enhancedOrchestrator.process(
                     userQuery = userQuery,
                     sessionId = "main",
-                    screenContext = screenContext
+                    screenContext = screenContext,
+                    screen = screen
                 )
 
                 Log.d(TAG, "Enhanced agent state: $finalState")
@@ -273,17 +281,20 @@ class AgentAccessibilityService : AccessibilityService(),
 
                     withContext(Dispatchers.Main) {
                         when {
-                            uiChanged -> requestReconfirmationForStaleUi(action)
+                            uiChanged -> requestReconfirmationForStaleUi(action) {
+                                dispatchTaskAction(action, requestId)
+                            }
                             requiresConfirmation -> {
                                 pendingAction = action
                                 requestPhysicalConfirmation(action) {
-                                    dispatchAction(action)
+                                    dispatchTaskAction(action, requestId)
                                 }
                             }
-                            else -> dispatchAction(action)
+                            else -> dispatchTaskAction(action, requestId)
                         }
                     }
                 } else {
+                    SentinelApplication.getInstance().nativeBridge.endMacroTask(false)
                     withContext(Dispatchers.Main) {
                         handleAgentState(finalState)
                     }
@@ -291,6 +302,7 @@ class AgentAccessibilityService : AccessibilityService(),
 
             } catch (e: Exception) {
                 if (requestId == requestCounter.get()) {
+                    SentinelApplication.getInstance().nativeBridge.endMacroTask(false)
                     Log.e(TAG, "Error during agent processing", e)
                     broadcastError("Agent error: ${e.message}")
                 }
@@ -613,7 +625,7 @@ class AgentAccessibilityService : AccessibilityService(),
         Log.i(TAG, "Waiting for Volume Up confirmation for: ${action.action}")
     }
 
-    private fun requestReconfirmationForStaleUi(action: AgentAction) {
+    private fun requestReconfirmationForStaleUi(action: AgentAction, onConfirm: () -> Unit) {
         Log.w(TAG, "UI changed during inference; requesting confirmation for ${action.action}")
         pendingAction = action
         val augmented = action.copy(
@@ -622,18 +634,55 @@ class AgentAccessibilityService : AccessibilityService(),
                 action.reasoning
             ).joinToString(" ")
         )
-        requestPhysicalConfirmation(augmented) {
-            dispatchAction(action)
+        requestPhysicalConfirmation(augmented, onConfirm)
+    }
+
+    /**
+     * Rebuild the registry from [root] and pack it for native inference.
+     * Elements are also streamed to the native worker, which prunes them
+     * against [query] and prefills them in batches while the traversal is
+     * still running; beginScreen and appendElements only queue work, so
+     * this never waits for the engine. Each request gets its own buffer: a
+     * cancelled request may still be reading the previous one.
+     */
+    private fun captureScreen(root: AccessibilityNodeInfo, query: String): AgentController.ScreenSnapshot {
+        val nativeBridge = SentinelApplication.getInstance().nativeBridge
+        nativeBridge.beginScreen(query)
+        elementRegistry.rebuild(
+            root,
+            ElementRegistry.BatchSink { batch, length -> nativeBridge.appendElements(batch, length) }
+        )
+
+        var buffer = ByteBuffer.allocateDirect(SNAPSHOT_BUFFER_BYTES)
+        var length = elementRegistry.writeSnapshot(buffer)
+        if (length < 0) {
+            buffer = ByteBuffer.allocateDirect(-length)
+            length = elementRegistry.writeSnapshot(buffer)
+        }
+        return AgentController.ScreenSnapshot(buffer, length, streamed = true)
+    }
+
+    /**
+     * Dispatch the action of agent request [requestId] and end its macro
+     * task with the outcome, unless a newer request has started its own
+     */
+    private fun dispatchTaskAction(action: AgentAction, requestId: Long) {
+        val success = dispatchAction(action)
+        if (requestId == requestCounter.get()) {
+            SentinelApplication.getInstance().nativeBridge.endMacroTask(success)
         }
     }
 
     /**
      * Dispatch action through the Actuator
+     *
+     * @return Whether the action was performed
      */
-    private fun dispatchAction(action: AgentAction) {
+    private fun dispatchAction(action: AgentAction): Boolean {
+        var success = false
         rootInActiveWindow?.let { root ->
             try {
-                val success = actionDispatcher.dispatch(this, root, action)
+                success = actionDispatcher.dispatch(this, root, action)
                 Log.i(TAG, "Action ${action.action} executed: $success")
 
                 if (!success && action.elementId != null) {
@@ -652,6 +701,7 @@ class AgentAccessibilityService : AccessibilityService(),
         
         pendingAction = null
         volumeUpCallback = null
+        return success
     }
 
     private suspend fun requiresConfirmationForAction(
@@ -2,6 +2,8 @@ package com.mazzlabs.sentinel.service
 
 import android.graphics.Rect
 import android.view.accessibility.AccessibilityNodeInfo
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
 import java.util.concurrent.atomic.AtomicInteger
 
 /**
@@ -9,11 +11,43 @@ import java.util.concurrent.atomic.AtomicInteger
  */
 class ElementRegistry {
 
+    companion object {
+        // Packed snapshot layout, mirrored in native_snapshot.hpp
+        const val SNAPSHOT_MAGIC = 0x31504E53 // "SNP1"
+        const val SNAPSHOT_VERSION: Short = 1
+        const val SNAPSHOT_HEADER_BYTES = 16
+        const val SNAPSHOT_FLAG_CLICKABLE = 1
+        const val SNAPSHOT_FLAG_EDITABLE = 2
+        const val SNAPSHOT_FLAG_SCROLLABLE = 4
+
+        // Elements per streamed batch: small enough that the first prefill
+        // starts early, large enough to amortize the JNI call
+        const val STREAM_BATCH_SIZE = 16
+
+        private fun snapshotBytes(count: Int, blobSize: Int): Int =
+            SNAPSHOT_HEADER_BYTES + count * 28 + ((count + 3) and 3.inv()) + blobSize
+    }
+
+    /**
+     * Receives packed element batches while [rebuild] is still traversing,
+     * e.g. NativeBridge.appendElements. [batch] is reused after the call.
+     */
+    fun interface BatchSink {
+        fun onBatch(batch: ByteBuffer, length: Int)
+    }
+
     private val elements = mutableMapOf<Int, RegisteredElement>()
     private val nodeMap = mutableMapOf<Int, AccessibilityNodeInfo>()
     private val nextId = AtomicInteger(1)
     private var timestamp: Long = 0
 
+    /**
+     * Incremented by every [rebuild] and [clear]; lets snapshot consumers
+     * skip reloads and tell that ids they hold are stale
+     */
+    var generation: Int = 0
+        private set
+
     data class RegisteredElement(
         val id: Int,
         val label: String,
@@ -23,13 +57,46 @@ class ElementRegistry {
         val isScrollable: Boolean
     )
 
-    fun rebuild(root: AccessibilityNodeInfo): Int {
+    private var batchSink: BatchSink? = null
+    private var batchSize = STREAM_BATCH_SIZE
+    private val pendingBatch = mutableListOf<RegisteredElement>()
+    private var batchBuffer: ByteBuffer? = null
+
+    fun rebuild(root: AccessibilityNodeInfo): Int = rebuild(root, null)
+
+    /**
+     * Rebuild the registry, handing every [batchSize] registered elements to
+     * [sink] as a packed snapshot so native prefill overlaps the traversal.
+     */
+    fun rebuild(root: AccessibilityNodeInfo, sink: BatchSink?, batchSize: Int = STREAM_BATCH_SIZE): Int {
         clear()
         timestamp = System.currentTimeMillis()
-        traverse(root)
+        batchSink = sink
+        this.batchSize = batchSize.coerceAtLeast(1)
+        try {
+            traverse(root)
+            flushBatch()
+        } finally {
+            batchSink = null
+            pendingBatch.clear()
+        }
         return elements.size
     }
 
+    private fun flushBatch() {
+        val sink = batchSink ?: return
+        if (pendingBatch.isEmpty()) return
+
+        var buffer = batchBuffer ?: ByteBuffer.allocateDirect(4096).also { batchBuffer = it }
+        var written = packElements(pendingBatch, buffer)
+        if (written < 0) {
+            buffer = ByteBuffer.allocateDirect(-written * 2).also { batchBuffer = it }
+            written = packElements(pendingBatch, buffer)
+        }
+        pendingBatch.clear()
+        sink.onBatch(buffer, written)
+    }
+
     /**
      * Recursively traverse the accessibility tree and register interactive elements.
      * @return true if this node was stored in nodeMap, false otherwise
@@ -43,6 +110,10 @@ class ElementRegistry {
         if (nodeWasStored) {
             elements[element!!.id] = element
             nodeMap[element.id] = node
+            if (batchSink != null) {
+                pendingBatch.add(element)
+                if (pendingBatch.size >= batchSize) flushBatch()
+            }
         }
 
         for (i in 0 until node.childCount) {
@@ -124,6 +195,56 @@ class ElementRegistry {
         }
     }
 
+    /**
+     * Pack all registered elements into [out] for NativeBridge.inferWithSnapshot.
+     * The native side renders the same text as [toPromptString] from it.
+     *
+     * @return Bytes written, or -(bytes required) if [out] is too small
+     */
+    fun writeSnapshot(out: ByteBuffer): Int = packElements(elements.values.toList(), out)
+
+    private fun packElements(ordered: List<RegisteredElement>, out: ByteBuffer): Int {
+        val labels = ordered.map { it.label.toByteArray(Charsets.UTF_8) }
+        val blobSize = labels.sumOf { it.size }
+        val size = snapshotBytes(ordered.size, blobSize)
+        if (out.capacity() < size) return -size
+
+        out.clear()
+        out.order(ByteOrder.LITTLE_ENDIAN)
+
+        out.putInt(SNAPSHOT_MAGIC)
+        out.putShort(SNAPSHOT_VERSION)
+        out.putShort(0)
+        out.putInt(ordered.size)
+        out.putInt(blobSize)
+
+        ordered.forEach { out.putInt(it.id) }
+        ordered.forEach {
+            out.putInt(it.bounds.left)
+            out.putInt(it.bounds.top)
+            out.putInt(it.bounds.right)
+            out.putInt(it.bounds.bottom)
+        }
+        var offset = 0
+        labels.forEach {
+            out.putInt(offset)
+            offset += it.size
+        }
+        labels.forEach { out.putInt(it.size) }
+        ordered.forEach { element ->
+            var flags = 0
+            if (element.isClickable) flags = flags or SNAPSHOT_FLAG_CLICKABLE
+            if (element.isEditable) flags = flags or SNAPSHOT_FLAG_EDITABLE
+            if (element.isScrollable) flags = flags or SNAPSHOT_FLAG_SCROLLABLE
+            out.put(flags.toByte())
+        }
+        while (out.position() % 4 != 0) out.put(0)
+        labels.forEach { out.put(it) }
+
+        out.flip()
+        return size
+    }
+
     fun getAgeMs(): Long = System.currentTimeMillis() - timestamp
 
     fun clear() {
@@ -134,5 +255,7 @@ class ElementRegistry {
         elements.clear()
         nodeMap.clear()
         nextId.set(1)
+        // Ids restart at 1: snapshots packed before this no longer apply
+        generation++
     }
 }
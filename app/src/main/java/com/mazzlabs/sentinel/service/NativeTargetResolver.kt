@@ -0,0 +1,58 @@
+package com.mazzlabs.sentinel.service
+
+import android.util.Log
+import com.mazzlabs.sentinel.core.NativeBridge
+import java.nio.ByteBuffer
+
+/**
+ * NativeTargetResolver - Resolves action targets with the native fuzzy matcher.
+ *
+ * Pushes the registry to native code once per rebuild, then each lookup is
+ * a single JNI call that stays well under a millisecond on large screens.
+ */
+class NativeTargetResolver(
+    private val nativeBridge: NativeBridge,
+    private val registry: ElementRegistry
+) : ActionDispatcher.TargetResolver {
+
+    companion object {
+        private const val TAG = "NativeTargetResolver"
+        private const val MAX_MATCHES = 4
+        private const val INITIAL_BUFFER_BYTES = 16 * 1024
+    }
+
+    private var loadedGeneration = -1
+    private var buffer: ByteBuffer? = null
+    private val ids = IntArray(MAX_MATCHES)
+    private val scores = FloatArray(MAX_MATCHES)
+
+    @Synchronized
+    override fun resolve(target: String): ActionDispatcher.Match? {
+        if (!loadElements()) return null
+
+        val count = nativeBridge.resolveTarget(target, ids, scores)
+        if (count <= 0) return null
+
+        Log.d(TAG, "Target '$target' -> ${ids[0]} (score ${scores[0]}, $count candidates)")
+        return ActionDispatcher.Match(ids[0], scores[0])
+    }
+
+    private fun loadElements(): Boolean {
+        val generation = registry.generation
+        if (generation == loadedGeneration) return true
+
+        var out = buffer ?: ByteBuffer.allocateDirect(INITIAL_BUFFER_BYTES).also { buffer = it }
+        var written = registry.writeSnapshot(out)
+        if (written < 0) {
+            out = ByteBuffer.allocateDirect(-written * 2).also { buffer = it }
+            written = registry.writeSnapshot(out)
+        }
+
+        if (nativeBridge.loadTargetElements(out, written) < 0) {
+            Log.w(TAG, "Native resolver rejected element snapshot")
+            return false
+        }
+        loadedGeneration = generation
+        return true
+    }
+}
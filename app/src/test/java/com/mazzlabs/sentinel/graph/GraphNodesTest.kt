@@ -3,12 +3,14 @@ package com.mazzlabs.sentinel.graph
 import android.content.Context
 import android.content.pm.PackageManager
 import com.google.common.truth.Truth.assertThat
+import com.mazzlabs.sentinel.core.AgentController
 import com.mazzlabs.sentinel.graph.nodes.ParameterExtractorNode
 import com.mazzlabs.sentinel.graph.nodes.ResponseGeneratorNode
 import com.mazzlabs.sentinel.graph.nodes.ToolExecutorNode
 import com.mazzlabs.sentinel.graph.nodes.ToolSelectorNode
 import com.mazzlabs.sentinel.graph.nodes.UIActionNode
 import com.mazzlabs.sentinel.model.ActionType
+import com.mazzlabs.sentinel.model.AgentAction
 import com.mazzlabs.sentinel.model.ScrollDirection
 import com.mazzlabs.sentinel.tools.Tool
 import com.mazzlabs.sentinel.tools.ToolRegistry
@@ -19,6 +21,7 @@ import io.mockk.every
 import io.mockk.mockk
 import kotlinx.coroutines.test.runTest
 import org.junit.Test
+import java.nio.ByteBuffer
 
 class GraphNodesTest {
 
@@ -141,6 +144,46 @@ class GraphNodesTest {
         assertThat(result.action?.target).isEqualTo("submit")
     }
 
+    @Test
+    fun `UIActionNode takes the screen action for element intents`() = runTest {
+        val screen = AgentController.ScreenSnapshot(ByteBuffer.allocateDirect(16), 16)
+        var asked: String? = null
+        val node = UIActionNode { query, _ ->
+            asked = query
+            AgentAction(ActionType.CLICK, elementId = 7)
+        }
+        val state = AgentState(
+            userQuery = "open settings",
+            screen = screen,
+            intent = AgentIntent.CLICK_ELEMENT,
+            extractedEntities = mapOf("element_id" to "42")
+        )
+
+        val result = node.process(state)
+
+        assertThat(asked).isEqualTo("open settings")
+        assertThat(result.action?.elementId).isEqualTo(7)
+    }
+
+    @Test
+    fun `UIActionNode falls back to entities without a screen action`() = runTest {
+        val screen = AgentController.ScreenSnapshot(ByteBuffer.allocateDirect(16), 16)
+        var calls = 0
+        val node = UIActionNode { _, _ ->
+            calls++
+            null
+        }
+
+        val click = node.process(
+            AgentState(screen = screen, intent = AgentIntent.CLICK_ELEMENT, extractedEntities = mapOf("element_id" to "42"))
+        )
+        val back = node.process(AgentState(screen = screen, intent = AgentIntent.GO_BACK))
+
+        assertThat(click.action?.elementId).isEqualTo(42)
+        assertThat(back.action?.action).isEqualTo(ActionType.BACK)
+        assertThat(calls).isEqualTo(1)
+    }
+
     private class TestTool(
         override val name: String,
         private val validationResult: ValidationResult = ValidationResult.Valid
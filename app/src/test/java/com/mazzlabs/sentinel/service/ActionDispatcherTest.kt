@@ -63,6 +63,89 @@ class ActionDispatcherTest {
         assertThat(result).isTrue()
     }
 
+    @Test
+    fun dispatch_withClickTargetResolvedByResolver_clicksResolvedElement() {
+        val mockRoot = rootWithoutMatches()
+        val mockTarget = mockk<AccessibilityNodeInfo>(relaxed = true)
+
+        every { mockTarget.isClickable } returns true
+        every { mockTarget.performAction(AccessibilityNodeInfo.ACTION_CLICK) } returns true
+        every { mockElementRegistry.getNode(7) } returns mockTarget
+
+        val dispatcher = ActionDispatcher(mockElementRegistry) { target ->
+            if (target == "Sned mesage") ActionDispatcher.Match(7, 0.8f) else null
+        }
+        val action = AgentAction(
+            action = ActionType.CLICK,
+            target = "Sned mesage"
+        )
+
+        val result = dispatcher.dispatch(mockAccessibilityService, mockRoot, action)
+        assertThat(result).isTrue()
+        verify { mockTarget.performAction(AccessibilityNodeInfo.ACTION_CLICK) }
+    }
+
+    @Test
+    fun dispatch_withWeakResolverMatch_rejectsTarget() {
+        val mockRoot = rootWithoutMatches()
+        val mockTarget = mockk<AccessibilityNodeInfo>(relaxed = true)
+        every { mockElementRegistry.getNode(7) } returns mockTarget
+
+        val dispatcher = ActionDispatcher(mockElementRegistry) { ActionDispatcher.Match(7, 0.4f) }
+        val action = AgentAction(
+            action = ActionType.CLICK,
+            target = "Delete account"
+        )
+
+        val result = dispatcher.dispatch(mockAccessibilityService, mockRoot, action)
+        assertThat(result).isFalse()
+        verify(exactly = 0) { mockTarget.performAction(any()) }
+    }
+
+    @Test
+    fun dispatch_withTextMatch_skipsResolver() {
+        val mockRoot = mockk<AccessibilityNodeInfo>()
+        val mockTarget = mockk<AccessibilityNodeInfo>(relaxed = true)
+        var resolverCalls = 0
+
+        every { mockTarget.isClickable } returns true
+        every { mockTarget.performAction(AccessibilityNodeInfo.ACTION_CLICK) } returns true
+        every { mockRoot.findAccessibilityNodeInfosByText("Send") } returns listOf(mockTarget)
+
+        val dispatcher = ActionDispatcher(mockElementRegistry) {
+            resolverCalls++
+            ActionDispatcher.Match(7, 1.0f)
+        }
+        val action = AgentAction(
+            action = ActionType.CLICK,
+            target = "Send"
+        )
+
+        val result = dispatcher.dispatch(mockAccessibilityService, mockRoot, action)
+        assertThat(result).isTrue()
+        assertThat(resolverCalls).isEqualTo(0)
+        verify { mockTarget.performAction(AccessibilityNodeInfo.ACTION_CLICK) }
+    }
+
+    @Test
+    fun dispatch_withUnresolvedTarget_fallsBackToTextSearch() {
+        val mockRoot = mockk<AccessibilityNodeInfo>()
+        val mockTarget = mockk<AccessibilityNodeInfo>(relaxed = true)
+
+        every { mockTarget.isClickable } returns true
+        every { mockTarget.performAction(AccessibilityNodeInfo.ACTION_CLICK) } returns true
+        every { mockRoot.findAccessibilityNodeInfosByText("Button") } returns listOf(mockTarget)
+
+        val dispatcher = ActionDispatcher(mockElementRegistry) { null }
+        val action = AgentAction(
+            action = ActionType.CLICK,
+            target = "Button"
+        )
+
+        val result = dispatcher.dispatch(mockAccessibilityService, mockRoot, action)
+        assertThat(result).isTrue()
+    }
+
     @Test
     fun dispatch_withMissingElementRegistration_returnsFalse() {
         val mockRoot = mockk<AccessibilityNodeInfo>()
@@ -276,4 +359,16 @@ class ActionDispatcherTest {
         assertThat(result).isTrue()
         verify { mockAccessibilityService.dispatchGesture(any(), any(), any()) }
     }
+
+    // A window whose tree search finds nothing, so targets reach the resolver
+    private fun rootWithoutMatches(): AccessibilityNodeInfo {
+        val root = mockk<AccessibilityNodeInfo>()
+        every { root.findAccessibilityNodeInfosByText(any()) } returns emptyList()
+        every { root.findAccessibilityNodeInfosByViewId(any()) } returns emptyList()
+        every { root.text } returns null
+        every { root.contentDescription } returns null
+        every { root.viewIdResourceName } returns null
+        every { root.childCount } returns 0
+        return root
+    }
 }
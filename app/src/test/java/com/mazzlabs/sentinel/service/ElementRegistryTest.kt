@@ -4,6 +4,8 @@ import android.view.accessibility.AccessibilityNodeInfo
 import io.mockk.MockK
 import io.mockk.every
 import io.mockk.mockk
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
 import org.junit.Before
 import org.junit.Test
 import com.google.common.truth.Truth.assertThat
@@ -302,6 +304,24 @@ class ElementRegistryTest {
         assertThat(elementRegistry.getElement(1)).isNull()
     }
 
+    @Test
+    fun clear_incrementsGeneration() {
+        val mockRoot = mockk<AccessibilityNodeInfo>()
+        every { mockRoot.childCount } returns 0
+        every { mockRoot.text } returns null
+        every { mockRoot.contentDescription } returns null
+        every { mockRoot.isVisibleToUser } returns true
+
+        elementRegistry.rebuild(mockRoot)
+        val rebuilt = elementRegistry.generation
+
+        elementRegistry.clear()
+        assertThat(elementRegistry.generation).isEqualTo(rebuilt + 1)
+
+        elementRegistry.rebuild(mockRoot)
+        assertThat(elementRegistry.generation).isEqualTo(rebuilt + 2)
+    }
+
     @Test
     fun rebuild_withInvisibleElements_ignoresThem() {
         val mockInvisible = mockk<AccessibilityNodeInfo>()
@@ -368,4 +388,108 @@ class ElementRegistryTest {
 
         assertThat(element?.label?.length).isAtMost(60)
     }
+
+    @Test
+    fun writeSnapshot_packsHeaderFlagsAndLabels() {
+        val mockButton = mockk<AccessibilityNodeInfo>()
+        every { mockButton.childCount } returns 0
+        every { mockButton.text } returns "Wi-Fi ✓"
+        every { mockButton.contentDescription } returns null
+        every { mockButton.viewIdResourceName } returns null
+        every { mockButton.isClickable } returns true
+        every { mockButton.isEditable } returns false
+        every { mockButton.isScrollable } returns true
+        every { mockButton.isVisibleToUser } returns true
+        every { mockButton.getBoundsInScreen(any()) }.answers {
+            val rect = it.invocation.args[0] as android.graphics.Rect
+            rect.set(0, 0, 100, 100)
+        }
+
+        elementRegistry.rebuild(mockButton)
+        val buffer = ByteBuffer.allocateDirect(256)
+        val written = elementRegistry.writeSnapshot(buffer)
+
+        val label = "Wi-Fi ✓".toByteArray(Charsets.UTF_8)
+        assertThat(written).isEqualTo(ElementRegistry.SNAPSHOT_HEADER_BYTES + 28 + 4 + label.size)
+        assertThat(buffer.limit()).isEqualTo(written)
+
+        buffer.order(ByteOrder.LITTLE_ENDIAN)
+        assertThat(buffer.getInt(0)).isEqualTo(ElementRegistry.SNAPSHOT_MAGIC)
+        assertThat(buffer.getShort(4)).isEqualTo(ElementRegistry.SNAPSHOT_VERSION)
+        assertThat(buffer.getInt(8)).isEqualTo(1)
+        assertThat(buffer.getInt(12)).isEqualTo(label.size)
+
+        val flagsOffset = ElementRegistry.SNAPSHOT_HEADER_BYTES + 28
+        assertThat(buffer.get(flagsOffset).toInt()).isEqualTo(
+            ElementRegistry.SNAPSHOT_FLAG_CLICKABLE or ElementRegistry.SNAPSHOT_FLAG_SCROLLABLE
+        )
+
+        val blob = ByteArray(label.size)
+        buffer.position(flagsOffset + 4)
+        buffer.get(blob)
+        assertThat(blob).isEqualTo(label)
+    }
+
+    @Test
+    fun writeSnapshot_withSmallBuffer_returnsRequiredSize() {
+        val mockRoot = mockk<AccessibilityNodeInfo>()
+        every { mockRoot.childCount } returns 0
+        every { mockRoot.text } returns "Settings"
+        every { mockRoot.contentDescription } returns null
+        every { mockRoot.viewIdResourceName } returns null
+        every { mockRoot.isClickable } returns true
+        every { mockRoot.isEditable } returns false
+        every { mockRoot.isScrollable } returns false
+        every { mockRoot.isVisibleToUser } returns true
+        every { mockRoot.getBoundsInScreen(any()) }.answers {
+            val rect = it.invocation.args[0] as android.graphics.Rect
+            rect.set(0, 0, 100, 100)
+        }
+
+        elementRegistry.rebuild(mockRoot)
+        val written = elementRegistry.writeSnapshot(ByteBuffer.allocateDirect(8))
+
+        assertThat(written).isEqualTo(-(ElementRegistry.SNAPSHOT_HEADER_BYTES + 28 + 4 + "Settings".length))
+    }
+
+    @Test
+    fun rebuild_withBatchSink_streamsAllElementsInBatches() {
+        val children = (1..5).map { index ->
+            mockk<AccessibilityNodeInfo>().also { child ->
+                every { child.childCount } returns 0
+                every { child.text } returns "Item $index"
+                every { child.contentDescription } returns null
+                every { child.viewIdResourceName } returns null
+                every { child.isClickable } returns true
+                every { child.isEditable } returns false
+                every { child.isScrollable } returns false
+                every { child.isVisibleToUser } returns true
+                every { child.getBoundsInScreen(any()) }.answers {
+                    val rect = it.invocation.args[0] as android.graphics.Rect
+                    rect.set(0, 0, 100, 100)
+                }
+            }
+        }
+
+        val mockRoot = mockk<AccessibilityNodeInfo>()
+        every { mockRoot.childCount } returns children.size
+        children.forEachIndexed { index, child -> every { mockRoot.getChild(index) } returns child }
+        every { mockRoot.text } returns null
+        every { mockRoot.contentDescription } returns null
+        every { mockRoot.viewIdResourceName } returns null
+        every { mockRoot.isClickable } returns false
+        every { mockRoot.isEditable } returns false
+        every { mockRoot.isScrollable } returns false
+        every { mockRoot.isVisibleToUser } returns true
+
+        val batchCounts = mutableListOf<Int>()
+        val count = elementRegistry.rebuild(mockRoot, { batch, length ->
+            assertThat(batch.limit()).isEqualTo(length)
+            batch.order(ByteOrder.LITTLE_ENDIAN)
+            batchCounts.add(batch.getInt(8))
+        }, batchSize = 2)
+
+        assertThat(count).isEqualTo(5)
+        assertThat(batchCounts).containsExactly(2, 2, 1).inOrder()
+    }
 }